@@ -0,0 +1,451 @@
+#include "ata.h"
+#include "block.h"
+#include "pci.h"
+#include "outl.h"
+#include "process.h"
+#include "types.h"
+#include "lib.h"
+
+static ata_prd_t ata_prdts[ATA_NUM_CHANNELS][ATA_MAX_PRD] __attribute__ ((aligned (sizeof(ata_prd_t) * ATA_MAX_PRD)));
+
+static ata_channel_t ata_channels[ATA_NUM_CHANNELS] = {
+    { .io_base = ATA_PRIMARY_IO, .ctrl_base = ATA_PRIMARY_CTRL },
+    { .io_base = ATA_SECONDARY_IO, .ctrl_base = ATA_SECONDARY_CTRL }
+};
+static ata_drive_t ata_drives[ATA_NUM_CHANNELS * ATA_DRIVES_PER_CHANNEL];
+
+static int32_t ata_submit(block_dev_t * dev, block_request_t * reqs, int count);
+static void ata_wait(block_dev_t * dev);
+
+/* ata_insw / ata_outsw
+ *
+ * DESCRIPTION: Moves a run of words through the data register with one
+ *              string instruction
+ */
+static inline void ata_insw(uint16_t port, void * buf, uint32_t words) {
+    asm volatile ("rep insw"
+            : "+D"(buf), "+c"(words)
+            : "d"(port)
+            : "memory"
+    );
+}
+
+static inline void ata_outsw(uint16_t port, const void * buf, uint32_t words) {
+    asm volatile ("rep outsw"
+            : "+S"(buf), "+c"(words)
+            : "d"(port)
+            : "memory"
+    );
+}
+
+/* ata_delay
+ *
+ * DESCRIPTION: Waits the 400ns a drive needs before its status is valid,
+ *              by reading the alternate status register four times
+ *
+ * INPUTS: ch: the channel
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void ata_delay(ata_channel_t * ch) {
+    inb(ch->ctrl_base);
+    inb(ch->ctrl_base);
+    inb(ch->ctrl_base);
+    inb(ch->ctrl_base);
+}
+
+/* ata_poll
+ *
+ * DESCRIPTION: Waits for the selected drive to stop being busy
+ *
+ * INPUTS: ch: the channel
+ *         need_drq: 1 to also wait for the drive to be ready for data
+ * OUTPUTS: none
+ * RETURN VALUE: 0 when the drive is ready, -1 on error or timeout
+ * SIDE EFFECTS: none
+ */
+static int32_t ata_poll(ata_channel_t * ch, int need_drq) {
+    uint32_t status, tries;
+    for (tries = 0; tries < ATA_TIMEOUT; tries++) {
+        status = inb(ch->io_base + ATA_REG_STATUS);
+        if (status & ATA_SR_BSY) {
+            continue;
+        }
+        if (status & (ATA_SR_ERR | ATA_SR_DF)) {
+            return -1;
+        }
+        if (!need_drq || (status & ATA_SR_DRQ)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* ata_issue
+ *
+ * DESCRIPTION: Selects a drive and starts an LBA28 command
+ *
+ * INPUTS: drive: the drive
+ *         lba: first sector
+ *         count: number of sectors, at most ATA_MAX_SECTORS
+ *         cmd: ATA command
+ * OUTPUTS: none
+ * RETURN VALUE: 0 if the command was sent, -1 if the drive stayed busy
+ * SIDE EFFECTS: none
+ */
+static int32_t ata_issue(ata_drive_t * drive, uint32_t lba, uint32_t count, uint8_t cmd) {
+    ata_channel_t * ch = drive->channel;
+    uint32_t flags;
+
+    outb(ATA_DRIVE_LBA | (drive->slave ? ATA_DRIVE_SLAVE : 0) | ((lba >> 24) & 0x0F), ch->io_base + ATA_REG_DRIVE);
+    if (ch->selected != drive->slave) { // switching drives needs the drive to settle
+        ata_delay(ch);
+        ch->selected = drive->slave;
+    }
+    if (ata_poll(ch, 0)) {
+        return -1;
+    }
+
+    cli_and_save(flags); // the task file is written as one unit
+    outb(count & 0xFF, ch->io_base + ATA_REG_SECCOUNT);
+    outb(lba & 0xFF, ch->io_base + ATA_REG_LBA_LO);
+    outb((lba >> 8) & 0xFF, ch->io_base + ATA_REG_LBA_MID);
+    outb((lba >> 16) & 0xFF, ch->io_base + ATA_REG_LBA_HI);
+    outb(cmd, ch->io_base + ATA_REG_COMMAND);
+    ata_delay(ch);
+    restore_flags(flags);
+    return 0;
+}
+
+/* ata_lock / ata_unlock
+ *
+ * DESCRIPTION: Makes the caller the only one driving a channel. Transfers
+ *              run with interrupts on, so a process that finds the channel
+ *              busy lets the others run until it is free.
+ */
+static void ata_lock(ata_channel_t * ch) {
+    uint32_t flags;
+    cli_and_save(flags);
+    while (ch->busy) {
+        process_yield();
+    }
+    ch->busy = 1;
+    restore_flags(flags);
+}
+
+static void ata_unlock(ata_channel_t * ch) {
+    ch->busy = 0;
+}
+
+/* ata_complete
+ *
+ * DESCRIPTION: Sets the status of a run of requests
+ *
+ * INPUTS: reqs: first request
+ *         count: number of requests
+ *         status: BLOCK_DONE or BLOCK_ERROR
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void ata_complete(block_request_t * reqs, int count, int32_t status) {
+    int i;
+    for (i = 0; i < count; i++) {
+        reqs[i].status = status;
+    }
+}
+
+/* ata_pio
+ *
+ * DESCRIPTION: Transfers a run of requests covering adjacent sectors with a
+ *              single PIO command, one sector per DRQ
+ *
+ * INPUTS: drive: the drive
+ *         reqs: first request
+ *         count: number of requests
+ *         sectors: sum of the requests' sector counts
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: completes the requests
+ */
+static void ata_pio(ata_drive_t * drive, block_request_t * reqs, int count, uint32_t sectors) {
+    ata_channel_t * ch = drive->channel;
+    int write = reqs[0].write;
+    int i;
+    uint32_t s;
+
+    if (ata_issue(drive, reqs[0].lba, sectors, write ? ATA_CMD_WRITE_PIO : ATA_CMD_READ_PIO)) {
+        ata_complete(reqs, count, BLOCK_ERROR);
+        return;
+    }
+
+    for (i = 0; i < count; i++) {
+        for (s = 0; s < reqs[i].count; s++) {
+            if (ata_poll(ch, 1)) {
+                ata_complete(reqs + i, count - i, BLOCK_ERROR);
+                return;
+            }
+            if (write) {
+                ata_outsw(ch->io_base + ATA_REG_DATA, reqs[i].buf + (s << BLOCK_SECTOR_SHIFT), BLOCK_SECTOR_SIZE / 2);
+            } else {
+                ata_insw(ch->io_base + ATA_REG_DATA, reqs[i].buf + (s << BLOCK_SECTOR_SHIFT), BLOCK_SECTOR_SIZE / 2);
+            }
+        }
+    }
+
+    if (write) { // PIO writes may still sit in the drive's cache
+        if (ata_poll(ch, 0) || ata_issue(drive, 0, 0, ATA_CMD_CACHE_FLUSH) || ata_poll(ch, 0)) {
+            ata_complete(reqs, count, BLOCK_ERROR);
+            return;
+        }
+    }
+    ata_complete(reqs, count, BLOCK_DONE);
+}
+
+/* ata_dma_start
+ *
+ * DESCRIPTION: Starts a bus master DMA command for a run of requests
+ *              covering adjacent sectors, one PRD per request buffer
+ *
+ * INPUTS: drive: the drive
+ *         reqs: first request, must stay in memory until the command finishes
+ *         count: number of requests, at most ATA_MAX_PRD
+ *         sectors: sum of the requests' sector counts
+ * OUTPUTS: none
+ * RETURN VALUE: 0 if the command is running, -1 if DMA can't be used
+ * SIDE EFFECTS: makes the command the channel's in-flight command
+ */
+static int32_t ata_dma_start(ata_drive_t * drive, block_request_t * reqs, int count, uint32_t sectors) {
+    ata_channel_t * ch = drive->channel;
+    int write = reqs[0].write;
+    uint32_t addr, bytes;
+    int i;
+
+    if (ch->bm_base == 0) {
+        return -1;
+    }
+
+    for (i = 0; i < count; i++) {
+        addr = (uint32_t) reqs[i].buf;
+        bytes = reqs[i].count << BLOCK_SECTOR_SHIFT;
+        // a PRD can't cross a 64KB boundary, such buffers go through PIO
+        if ((addr & 0x1) || (addr & (PRD_MAX_BYTES - 1)) + bytes > PRD_MAX_BYTES) {
+            return -1;
+        }
+        ch->prdt[i].addr = addr; // kernel memory is identity mapped
+        ch->prdt[i].count = bytes & (PRD_MAX_BYTES - 1);
+        ch->prdt[i].flags = (i == count - 1) ? PRD_EOT : 0;
+    }
+
+    outl_asm((uint32_t) ch->prdt, ch->bm_base + BM_REG_PRDT);
+    outb(write ? 0 : BM_CMD_READ, ch->bm_base + BM_REG_COMMAND);
+    outb(BM_SR_ERR | BM_SR_IRQ, ch->bm_base + BM_REG_STATUS); // write 1 to clear
+    if (ata_issue(drive, reqs[0].lba, sectors, write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA)) {
+        return -1;
+    }
+    outb((write ? 0 : BM_CMD_READ) | BM_CMD_START, ch->bm_base + BM_REG_COMMAND);
+
+    ch->inflight_drive = drive;
+    ch->inflight = reqs;
+    ch->num_inflight = count;
+    return 0;
+}
+
+/* ata_dma_finish
+ *
+ * DESCRIPTION: Waits for the channel's in-flight DMA command. If the DMA
+ *              fails the requests are retried with PIO. The caller holds
+ *              the channel.
+ *
+ * INPUTS: ch: the channel
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: completes the in-flight requests, leaves the channel idle
+ */
+static void ata_dma_finish(ata_channel_t * ch) {
+    uint32_t bm_status = 0, tries, sectors;
+    int i, failed;
+    ata_drive_t * drive = ch->inflight_drive;
+    block_request_t * reqs = ch->inflight;
+    int count = ch->num_inflight;
+
+    if (reqs == NULL) {
+        return;
+    }
+    ch->inflight = NULL;
+    ch->inflight_drive = NULL;
+    ch->num_inflight = 0;
+
+    for (tries = 0; tries < ATA_TIMEOUT; tries++) {
+        bm_status = inb(ch->bm_base + BM_REG_STATUS);
+        if ((bm_status & (BM_SR_IRQ | BM_SR_ERR)) || !(bm_status & BM_SR_ACTIVE)) {
+            break;
+        }
+    }
+    outb(inb(ch->bm_base + BM_REG_COMMAND) & ~BM_CMD_START, ch->bm_base + BM_REG_COMMAND);
+    failed = (tries == ATA_TIMEOUT) || (bm_status & BM_SR_ERR) || ata_poll(ch, 0);
+    outb(BM_SR_ERR | BM_SR_IRQ, ch->bm_base + BM_REG_STATUS);
+
+    if (!failed) {
+        ata_complete(reqs, count, BLOCK_DONE);
+        return;
+    }
+    sectors = 0;
+    for (i = 0; i < count; i++) {
+        sectors += reqs[i].count;
+    }
+    ata_pio(drive, reqs, count, sectors);
+}
+
+/* ata_submit
+ *
+ * DESCRIPTION: Block layer submit function. Requests for adjacent sectors
+ *              in the same direction are merged into one command, using
+ *              DMA when the controller supports it. Every command but the
+ *              last completes before this returns. PIO transfers and the
+ *              polling run with the caller's interrupts on.
+ *
+ * INPUTS: dev: the drive's block device
+ *         reqs: requests to transfer
+ *         count: number of requests
+ * OUTPUTS: none
+ * RETURN VALUE: 0
+ * SIDE EFFECTS: the last command may still be running, see ata_wait
+ */
+static int32_t ata_submit(block_dev_t * dev, block_request_t * reqs, int count) {
+    ata_drive_t * drive = (ata_drive_t *) dev->priv;
+    ata_channel_t * ch = drive->channel;
+    uint32_t sectors;
+    int first, n;
+
+    ata_lock(ch);
+    for (first = 0; first < count; first += n) {
+        sectors = reqs[first].count;
+        for (n = 1; first + n < count && n < ATA_MAX_PRD; n++) {
+            block_request_t * prev = &reqs[first + n - 1];
+            block_request_t * next = &reqs[first + n];
+            if (next->write != prev->write || next->lba != prev->lba + prev->count ||
+                sectors + next->count > ATA_MAX_SECTORS) {
+                break;
+            }
+            sectors += next->count;
+        }
+
+        ata_dma_finish(ch); // one command per channel at a time
+        if (sectors > ATA_MAX_SECTORS || reqs[first].lba + sectors > ATA_LBA28_MAX) {
+            ata_complete(reqs + first, n, BLOCK_ERROR);
+        } else if (ata_dma_start(drive, reqs + first, n, sectors)) {
+            ata_pio(drive, reqs + first, n, sectors);
+        }
+    }
+    ata_unlock(ch);
+    return 0;
+}
+
+/* ata_wait
+ *
+ * DESCRIPTION: Block layer wait function
+ *
+ * INPUTS: dev: the drive's block device
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: completes the in-flight command of the drive's channel
+ */
+static void ata_wait(block_dev_t * dev) {
+    ata_drive_t * drive = (ata_drive_t *) dev->priv;
+
+    ata_lock(drive->channel);
+    ata_dma_finish(drive->channel);
+    ata_unlock(drive->channel);
+}
+
+/* ata_identify
+ *
+ * DESCRIPTION: Checks whether an ATA disk is attached at a position
+ *
+ * INPUTS: drive: the position to probe
+ * OUTPUTS: none
+ * RETURN VALUE: number of LBA28 sectors of the disk, 0 if there is no ATA
+ *               disk (nothing attached, or an ATAPI device like a CD drive)
+ * SIDE EFFECTS: none
+ */
+static uint32_t ata_identify(ata_drive_t * drive) {
+    ata_channel_t * ch = drive->channel;
+    uint16_t identify[ATA_IDENTIFY_WORDS];
+    uint32_t status;
+
+    if (inb(ch->io_base + ATA_REG_STATUS) == 0xFF) { // floating bus, no channel
+        return 0;
+    }
+    outb(ATA_DRIVE_LBA | (drive->slave ? ATA_DRIVE_SLAVE : 0), ch->io_base + ATA_REG_DRIVE);
+    ata_delay(ch);
+    ch->selected = drive->slave;
+    outb(0, ch->io_base + ATA_REG_SECCOUNT);
+    outb(0, ch->io_base + ATA_REG_LBA_LO);
+    outb(0, ch->io_base + ATA_REG_LBA_MID);
+    outb(0, ch->io_base + ATA_REG_LBA_HI);
+    outb(ATA_CMD_IDENTIFY, ch->io_base + ATA_REG_COMMAND);
+    ata_delay(ch);
+
+    status = inb(ch->io_base + ATA_REG_STATUS);
+    if (status == 0) {
+        return 0;
+    }
+    // ATAPI devices abort IDENTIFY and leave a signature in the LBA registers
+    if (inb(ch->io_base + ATA_REG_LBA_MID) || inb(ch->io_base + ATA_REG_LBA_HI)) {
+        return 0;
+    }
+    if (ata_poll(ch, 1)) {
+        return 0;
+    }
+    ata_insw(ch->io_base + ATA_REG_DATA, identify, ATA_IDENTIFY_WORDS);
+    return identify[ATA_IDENTIFY_SECTORS_LO] | ((uint32_t) identify[ATA_IDENTIFY_SECTORS_HI] << 16);
+}
+
+/* ata_init
+ *
+ * DESCRIPTION: Finds the IDE controller, enables bus mastering on it and
+ *              registers every ATA disk as a block device (hda to hdd)
+ *
+ * INPUTS: none
+ * OUTPUTS: prints the disks found
+ * RETURN VALUE: none
+ * SIDE EFFECTS: registers block devices
+ */
+void ata_init() {
+    uint8_t device, func;
+    uint32_t bar4, command, sectors;
+    int i;
+    ata_drive_t * drive;
+
+    if (pci_find_device(PCI_CLASS_STORAGE, PCI_SUBCLASS_IDE, &device, &func) == 0) {
+        bar4 = read_pci_conf(0, device, func, PCI_BAR4);
+        if (bar4 & PCI_BAR_IO_SPACE) { // bus master registers live in I/O space
+            command = read_pci_conf(0, device, func, PCI_COMMAND);
+            write_pci_conf(0, device, func, PCI_COMMAND, command | PCI_COMMAND_IO | PCI_COMMAND_BUS_MASTER);
+            ata_channels[0].bm_base = bar4 & PCI_BAR_IO_MASK;
+            ata_channels[1].bm_base = (bar4 & PCI_BAR_IO_MASK) + BM_CHANNEL_STRIDE;
+        }
+    }
+
+    for (i = 0; i < ATA_NUM_CHANNELS * ATA_DRIVES_PER_CHANNEL; i++) {
+        drive = &ata_drives[i];
+        drive->channel = &ata_channels[i / ATA_DRIVES_PER_CHANNEL];
+        drive->channel->prdt = ata_prdts[i / ATA_DRIVES_PER_CHANNEL];
+        drive->channel->selected = -1;
+        drive->slave = i % ATA_DRIVES_PER_CHANNEL;
+
+        if (0 == (sectors = ata_identify(drive))) {
+            continue;
+        }
+        strncpy(drive->dev.name, "hda", BLOCK_NAME_LEN);
+        drive->dev.name[2] += i;
+        drive->dev.num_sectors = sectors;
+        drive->dev.submit_func = ata_submit;
+        drive->dev.wait_func = ata_wait;
+        drive->dev.priv = drive;
+        block_register(&drive->dev);
+        printf("%s: %d sectors%s\n", drive->dev.name, sectors, drive->channel->bm_base ? ", DMA" : "");
+    }
+}
@@ -0,0 +1,96 @@
+#include "types.h"
+#include "block.h"
+
+#ifndef ATA_H
+#define ATA_H
+
+/* legacy (compatibility mode) ports of the two IDE channels */
+#define ATA_PRIMARY_IO 0x1F0
+#define ATA_PRIMARY_CTRL 0x3F6
+#define ATA_SECONDARY_IO 0x170
+#define ATA_SECONDARY_CTRL 0x376
+
+#define ATA_NUM_CHANNELS 2
+#define ATA_DRIVES_PER_CHANNEL 2
+
+/* task file registers, offsets from the channel's io port */
+#define ATA_REG_DATA 0
+#define ATA_REG_ERROR 1
+#define ATA_REG_SECCOUNT 2
+#define ATA_REG_LBA_LO 3
+#define ATA_REG_LBA_MID 4
+#define ATA_REG_LBA_HI 5
+#define ATA_REG_DRIVE 6
+#define ATA_REG_STATUS 7
+#define ATA_REG_COMMAND 7
+
+#define ATA_SR_ERR 0x01
+#define ATA_SR_DRQ 0x08
+#define ATA_SR_DF 0x20
+#define ATA_SR_BSY 0x80
+
+#define ATA_CMD_READ_PIO 0x20
+#define ATA_CMD_WRITE_PIO 0x30
+#define ATA_CMD_READ_DMA 0xC8
+#define ATA_CMD_WRITE_DMA 0xCA
+#define ATA_CMD_CACHE_FLUSH 0xE7
+#define ATA_CMD_IDENTIFY 0xEC
+
+#define ATA_DRIVE_LBA 0xE0 // LBA addressing, bits 0-3 hold LBA bits 24-27
+#define ATA_DRIVE_SLAVE 0x10
+#define ATA_LBA28_MAX 0x10000000
+
+#define ATA_MAX_SECTORS 256 // per command, a sector count of 0 means 256
+#define ATA_IDENTIFY_WORDS 256
+#define ATA_IDENTIFY_SECTORS_LO 60 // words 60-61 hold the LBA28 sector count
+#define ATA_IDENTIFY_SECTORS_HI 61
+#define ATA_TIMEOUT 10000000 // status polls before a command is given up on
+
+/* bus master IDE registers, offsets from BAR4 (+8 for the secondary channel) */
+#define BM_REG_COMMAND 0
+#define BM_REG_STATUS 2
+#define BM_REG_PRDT 4
+#define BM_CHANNEL_STRIDE 8
+
+#define BM_CMD_START 0x01
+#define BM_CMD_READ 0x08 // transfer direction is device to memory
+#define BM_SR_ACTIVE 0x01
+#define BM_SR_ERR 0x02
+#define BM_SR_IRQ 0x04
+
+#define ATA_MAX_PRD 32
+#define PRD_MAX_BYTES 0x10000
+#define PRD_EOT 0x8000 // last entry of the table
+
+#define PCI_CLASS_STORAGE 0x01
+#define PCI_SUBCLASS_IDE 0x01
+
+/* physical region descriptor, one scatter/gather element of a DMA transfer */
+typedef struct __attribute__ ((packed)) ata_prd {
+    uint32_t addr;
+    uint16_t count; // bytes, 0 means 64KB
+    uint16_t flags;
+} ata_prd_t;
+
+typedef struct ata_channel {
+    uint16_t io_base;
+    uint16_t ctrl_base;
+    uint16_t bm_base; // 0 if the controller can't bus master
+    int selected; // drive the last command went to, -1 if unknown
+    ata_prd_t * prdt;
+    // requests of the DMA command that is still running, NULL if idle
+    struct ata_drive * inflight_drive;
+    block_request_t * inflight;
+    int num_inflight;
+    int busy; // a process is driving the channel, others wait for it
+} ata_channel_t;
+
+typedef struct ata_drive {
+    ata_channel_t * channel;
+    int slave;
+    block_dev_t dev;
+} ata_drive_t;
+
+void ata_init();
+
+#endif // ATA_H
@@ -0,0 +1,288 @@
+#include "bcache.h"
+#include "block.h"
+#include "kstat.h"
+#include "process.h"
+#include "types.h"
+#include "lib.h"
+
+static uint8_t bcache_data[BCACHE_NUM_BUFS][BCACHE_BLOCK_SIZE] __attribute__ ((aligned (BCACHE_BLOCK_SIZE)));
+static bcache_buf_t bcache_bufs[BCACHE_NUM_BUFS];
+static bcache_buf_t * lru_head = NULL;
+static bcache_buf_t * lru_tail = NULL;
+
+/* the read-ahead batch that may still be running */
+static block_dev_t * ra_dev = NULL;
+static block_request_t ra_reqs[BCACHE_READAHEAD];
+static bcache_buf_t * ra_bufs[BCACHE_READAHEAD];
+static int ra_count = 0;
+static int ra_busy = 0; // the batch is being submitted or waited for
+
+/* bcache_init
+ *
+ * DESCRIPTION: Puts every buffer on the LRU list, empty
+ *
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void bcache_init() {
+    int i;
+    for (i = 0; i < BCACHE_NUM_BUFS; i++) {
+        bcache_bufs[i].dev = NULL;
+        bcache_bufs[i].valid = 0;
+        bcache_bufs[i].pending = 0;
+        bcache_bufs[i].busy = 0;
+        bcache_bufs[i].refcount = 0;
+        bcache_bufs[i].data = bcache_data[i];
+        bcache_bufs[i].prev = (i > 0) ? &bcache_bufs[i - 1] : NULL;
+        bcache_bufs[i].next = (i < BCACHE_NUM_BUFS - 1) ? &bcache_bufs[i + 1] : NULL;
+    }
+    lru_head = &bcache_bufs[0];
+    lru_tail = &bcache_bufs[BCACHE_NUM_BUFS - 1];
+}
+
+/* bcache_touch
+ *
+ * DESCRIPTION: Moves a buffer to the most recently used end of the LRU list
+ *
+ * INPUTS: buf: the buffer
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void bcache_touch(bcache_buf_t * buf) {
+    if (buf == lru_head) {
+        return;
+    }
+    // unlink, buf has a prev since it is not the head
+    buf->prev->next = buf->next;
+    if (buf->next != NULL) {
+        buf->next->prev = buf->prev;
+    } else {
+        lru_tail = buf->prev;
+    }
+    buf->prev = NULL;
+    buf->next = lru_head;
+    lru_head->prev = buf;
+    lru_head = buf;
+}
+
+/* bcache_find
+ *
+ * DESCRIPTION: Looks a block up in the cache
+ *
+ * INPUTS: dev: device of the block
+ *         block: block number, in BCACHE_BLOCK_SIZE units
+ * OUTPUTS: none
+ * RETURN VALUE: the buffer assigned to the block, NULL if it is not cached
+ * SIDE EFFECTS: none
+ */
+static bcache_buf_t * bcache_find(block_dev_t * dev, uint32_t block) {
+    bcache_buf_t * buf;
+    for (buf = lru_head; buf != NULL; buf = buf->next) {
+        if (buf->dev == dev && buf->block == block) {
+            return buf;
+        }
+    }
+    return NULL;
+}
+
+/* bcache_victim
+ *
+ * DESCRIPTION: Picks the least recently used buffer that can be reused and
+ *              assigns it to a block
+ *
+ * INPUTS: dev: device of the block
+ *         block: block number
+ * OUTPUTS: none
+ * RETURN VALUE: the buffer, NULL if every buffer is pinned or busy
+ * SIDE EFFECTS: forgets the block the buffer held before
+ */
+static bcache_buf_t * bcache_victim(block_dev_t * dev, uint32_t block) {
+    bcache_buf_t * buf;
+    for (buf = lru_tail; buf != NULL; buf = buf->prev) {
+        if (buf->refcount == 0 && !buf->pending && !buf->busy) {
+            buf->dev = dev;
+            buf->block = block;
+            buf->valid = 0;
+            bcache_touch(buf);
+            return buf;
+        }
+    }
+    return NULL;
+}
+
+/* bcache_reap
+ *
+ * DESCRIPTION: Waits for the running read-ahead batch, if any. Called with
+ *              interrupts off, the wait itself runs with them as they were
+ *              before.
+ *
+ * INPUTS: flags: the caller's flags from cli_and_save
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: read-ahead buffers become valid, or empty if the read failed
+ */
+static void bcache_reap(uint32_t flags) {
+    int i;
+    while (ra_busy) { // someone else is already on it
+        process_yield();
+    }
+    if (ra_count == 0) {
+        return;
+    }
+    ra_busy = 1;
+    restore_flags(flags);
+    block_wait(ra_dev);
+    cli();
+    for (i = 0; i < ra_count; i++) {
+        ra_bufs[i]->pending = 0;
+        ra_bufs[i]->valid = (ra_reqs[i].status == BLOCK_DONE);
+        if (!ra_bufs[i]->valid) {
+            ra_bufs[i]->dev = NULL;
+        }
+    }
+    ra_count = 0;
+    ra_busy = 0;
+}
+
+/* bcache_get
+ *
+ * DESCRIPTION: Gets a block through the cache, reading it on a miss
+ *
+ * INPUTS: dev: device of the block
+ *         block: block number, in BCACHE_BLOCK_SIZE units
+ * OUTPUTS: none
+ * RETURN VALUE: pinned buffer holding the block, NULL if the read failed or
+ *               every buffer is pinned
+ * SIDE EFFECTS: the buffer has to be given back with bcache_release
+ */
+bcache_buf_t * bcache_get(block_dev_t * dev, uint32_t block) {
+    bcache_buf_t * buf;
+    uint32_t flags;
+    int32_t ret;
+
+    // syscalls run with interrupts on, only the list work is done with
+    // them off, the read itself runs with the buffer marked busy
+    cli_and_save(flags);
+    buf = bcache_find(dev, block);
+    while (buf != NULL && (buf->busy || buf->pending)) {
+        if (buf->pending) {
+            bcache_reap(flags);
+        } else {
+            process_yield();
+        }
+        buf = bcache_find(dev, block);
+    }
+    if (buf != NULL && buf->valid) {
+        kstat.bcache_hits++;
+        buf->refcount++;
+        bcache_touch(buf);
+        restore_flags(flags);
+        return buf;
+    }
+
+    kstat.bcache_misses++;
+    if (buf == NULL && NULL == (buf = bcache_victim(dev, block))) {
+        restore_flags(flags);
+        return NULL;
+    }
+    if (buf->dev != dev) { // its read-ahead failed and left it empty, take it back
+        buf->dev = dev;
+        buf->block = block;
+        bcache_touch(buf);
+    }
+    buf->busy = 1;
+    restore_flags(flags);
+
+    ret = block_read(dev, block * BCACHE_BLOCK_SECTORS, BCACHE_BLOCK_SECTORS, buf->data);
+
+    cli_and_save(flags);
+    buf->busy = 0;
+    if (ret) {
+        buf->dev = NULL;
+        restore_flags(flags);
+        return NULL;
+    }
+    buf->valid = 1;
+    buf->refcount++;
+    restore_flags(flags);
+    return buf;
+}
+
+/* bcache_release
+ *
+ * DESCRIPTION: Unpins a buffer returned by bcache_get
+ *
+ * INPUTS: buf: the buffer
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void bcache_release(bcache_buf_t * buf) {
+    uint32_t flags;
+    cli_and_save(flags);
+    if (buf != NULL && buf->refcount > 0) {
+        buf->refcount--;
+    }
+    restore_flags(flags);
+}
+
+/* bcache_readahead
+ *
+ * DESCRIPTION: Starts reading blocks that are expected to be needed soon.
+ *              Blocks already cached are skipped and the rest go to the
+ *              driver as one batch, which runs while the caller continues.
+ *
+ * INPUTS: dev: device of the blocks
+ *         blocks: block numbers, in the order they will be read
+ *         count: number of blocks, at most BCACHE_READAHEAD are fetched
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: evicts least recently used buffers
+ */
+void bcache_readahead(block_dev_t * dev, const uint32_t * blocks, int count) {
+    bcache_buf_t * buf;
+    uint32_t flags;
+    int32_t ret;
+    int i;
+
+    cli_and_save(flags);
+    bcache_reap(flags); // one batch at a time, the buffers and requests are shared
+    for (i = 0; i < count && ra_count < BCACHE_READAHEAD; i++) {
+        if (blocks[i] >= dev->num_sectors / BCACHE_BLOCK_SECTORS || bcache_find(dev, blocks[i]) != NULL) {
+            continue;
+        }
+        if (NULL == (buf = bcache_victim(dev, blocks[i]))) {
+            break;
+        }
+        buf->pending = 1;
+        ra_bufs[ra_count] = buf;
+        ra_reqs[ra_count].lba = blocks[i] * BCACHE_BLOCK_SECTORS;
+        ra_reqs[ra_count].count = BCACHE_BLOCK_SECTORS;
+        ra_reqs[ra_count].buf = buf->data;
+        ra_reqs[ra_count].write = 0;
+        ra_count++;
+    }
+    if (ra_count == 0) {
+        restore_flags(flags);
+        return;
+    }
+
+    ra_dev = dev;
+    kstat.bcache_readahead_blocks += ra_count;
+    ra_busy = 1;
+    restore_flags(flags);
+    ret = block_submit(dev, ra_reqs, ra_count);
+    cli_and_save(flags);
+    if (ret) {
+        for (i = 0; i < ra_count; i++) {
+            ra_bufs[i]->pending = 0;
+            ra_bufs[i]->dev = NULL;
+        }
+        ra_count = 0;
+    }
+    ra_busy = 0;
+    restore_flags(flags);
+}
@@ -0,0 +1,31 @@
+#include "types.h"
+#include "block.h"
+
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#define BCACHE_NUM_BUFS 64
+#define BCACHE_BLOCK_SIZE 4096
+#define BCACHE_BLOCK_SECTORS (BCACHE_BLOCK_SIZE >> BLOCK_SECTOR_SHIFT)
+#define BCACHE_READAHEAD 8 // most blocks fetched by one read-ahead batch
+
+/* one cached 4KB block. Buffers with a refcount are pinned and never
+ * evicted, the rest are recycled least recently used first */
+typedef struct bcache_buf {
+    block_dev_t * dev; // NULL if the buffer holds nothing
+    uint32_t block;
+    int valid;
+    int pending; // a read-ahead into data is still running
+    int busy; // bcache_get is reading the block in, lookups wait for it
+    int refcount;
+    uint8_t * data;
+    struct bcache_buf * prev; // LRU list, most recently used first
+    struct bcache_buf * next;
+} bcache_buf_t;
+
+void bcache_init();
+bcache_buf_t * bcache_get(block_dev_t * dev, uint32_t block);
+void bcache_release(bcache_buf_t * buf);
+void bcache_readahead(block_dev_t * dev, const uint32_t * blocks, int count);
+
+#endif // BCACHE_H
@@ -0,0 +1,146 @@
+#include "block.h"
+#include "kstat.h"
+#include "types.h"
+#include "lib.h"
+
+static block_dev_t * block_devs[MAX_BLOCK_DEVS];
+static int num_block_devs = 0;
+
+/* block_register
+ *
+ * DESCRIPTION: Adds a disk to the list of block devices the filesystem can
+ *              be mounted from
+ *
+ * INPUTS: dev: the device, with name, size and driver functions filled in
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if the device is invalid or the list is full
+ * SIDE EFFECTS: none
+ */
+int32_t block_register(block_dev_t * dev) {
+    if (dev == NULL || dev->submit_func == NULL || dev->wait_func == NULL) {
+        return -1;
+    }
+    if (num_block_devs >= MAX_BLOCK_DEVS) {
+        return -1;
+    }
+    block_devs[num_block_devs++] = dev;
+    return 0;
+}
+
+/* block_get
+ *
+ * DESCRIPTION: Gets a registered block device
+ *
+ * INPUTS: index: registration order of the device
+ * OUTPUTS: none
+ * RETURN VALUE: pointer to the device, NULL if index is out of range
+ * SIDE EFFECTS: none
+ */
+block_dev_t * block_get(int index) {
+    if (index < 0 || index >= num_block_devs) {
+        return NULL;
+    }
+    return block_devs[index];
+}
+
+/* block_submit
+ *
+ * DESCRIPTION: Hands a batch of requests to the driver. Drivers merge
+ *              requests for adjacent sectors, so callers should pass
+ *              everything they need at once instead of one block at a time.
+ *
+ * INPUTS: dev: device to transfer with
+ *         reqs: requests to start, status is set to BLOCK_PENDING
+ *         count: number of requests
+ * OUTPUTS: none
+ * RETURN VALUE: 0 if the batch was started, -1 for invalid requests
+ * SIDE EFFECTS: requests may complete after this returns, see block_wait
+ */
+int32_t block_submit(block_dev_t * dev, block_request_t * reqs, int count) {
+    int i;
+    if (dev == NULL || reqs == NULL || count <= 0) {
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        if (reqs[i].buf == NULL || reqs[i].count == 0 || reqs[i].lba + reqs[i].count > dev->num_sectors) {
+            return -1;
+        }
+    }
+    for (i = 0; i < count; i++) {
+        reqs[i].status = BLOCK_PENDING;
+        if (reqs[i].write) {
+            kstat.block_write_sectors += reqs[i].count;
+        } else {
+            kstat.block_read_sectors += reqs[i].count;
+        }
+    }
+    kstat.block_requests += count;
+    return dev->submit_func(dev, reqs, count);
+}
+
+/* block_wait
+ *
+ * DESCRIPTION: Waits for every request submitted to a device to finish
+ *
+ * INPUTS: dev: the device
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void block_wait(block_dev_t * dev) {
+    if (dev != NULL) {
+        dev->wait_func(dev);
+    }
+}
+
+/* block_transfer
+ *
+ * DESCRIPTION: Submits a single request and waits for it
+ *
+ * INPUTS: dev: the device
+ *         lba: first sector
+ *         count: number of sectors
+ *         buf: identity mapped buffer of count sectors
+ *         write: 1 to write buf to the disk, 0 to read into it
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 on failure
+ * SIDE EFFECTS: none
+ */
+static int32_t block_transfer(block_dev_t * dev, uint32_t lba, uint32_t count, uint8_t * buf, int write) {
+    block_request_t req;
+    req.lba = lba;
+    req.count = count;
+    req.buf = buf;
+    req.write = write;
+    if (block_submit(dev, &req, 1) != 0) {
+        return -1;
+    }
+    block_wait(dev);
+    return (req.status == BLOCK_DONE) ? 0 : -1;
+}
+
+/* block_read
+ *
+ * DESCRIPTION: Synchronously reads sectors
+ *
+ * INPUTS: see block_transfer
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 on failure
+ * SIDE EFFECTS: fills buf
+ */
+int32_t block_read(block_dev_t * dev, uint32_t lba, uint32_t count, uint8_t * buf) {
+    return block_transfer(dev, lba, count, buf, 0);
+}
+
+/* block_write
+ *
+ * DESCRIPTION: Synchronously writes sectors
+ *
+ * INPUTS: see block_transfer
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 on failure
+ * SIDE EFFECTS: changes the disk
+ */
+int32_t block_write(block_dev_t * dev, uint32_t lba, uint32_t count, uint8_t * buf) {
+    return block_transfer(dev, lba, count, buf, 1);
+}
@@ -0,0 +1,50 @@
+#include "types.h"
+
+#ifndef BLOCK_H
+#define BLOCK_H
+
+#define MAX_BLOCK_DEVS 8
+#define BLOCK_NAME_LEN 8
+#define BLOCK_SECTOR_SIZE 512
+#define BLOCK_SECTOR_SHIFT 9
+
+/* block_request_t status values */
+#define BLOCK_DONE 0
+#define BLOCK_PENDING 1
+#define BLOCK_ERROR -1
+
+/* one transfer of count sectors starting at lba, to or from buf. buf has to
+ * be identity mapped kernel memory since drivers may DMA into it */
+typedef struct block_request {
+    uint32_t lba;
+    uint32_t count;
+    uint8_t * buf;
+    int write;
+    volatile int32_t status;
+} block_request_t;
+
+typedef struct block_dev block_dev_t;
+
+/* starts every request in reqs. Requests may still be BLOCK_PENDING on return
+ * and must stay in memory until wait_func returns */
+typedef int32_t (*block_submit_func_t)(block_dev_t * dev, block_request_t * reqs, int count);
+/* blocks until every submitted request is BLOCK_DONE or BLOCK_ERROR */
+typedef void (*block_wait_func_t)(block_dev_t * dev);
+
+struct block_dev {
+    int8_t name[BLOCK_NAME_LEN];
+    uint32_t num_sectors;
+    block_submit_func_t submit_func;
+    block_wait_func_t wait_func;
+    void * priv; // driver state
+};
+
+int32_t block_register(block_dev_t * dev);
+block_dev_t * block_get(int index);
+
+int32_t block_submit(block_dev_t * dev, block_request_t * reqs, int count);
+void block_wait(block_dev_t * dev);
+int32_t block_read(block_dev_t * dev, uint32_t lba, uint32_t count, uint8_t * buf);
+int32_t block_write(block_dev_t * dev, uint32_t lba, uint32_t count, uint8_t * buf);
+
+#endif // BLOCK_H
@@ -0,0 +1,324 @@
+#include "devfs.h"
+#include "file_driver.h"
+#include "types.h"
+#include "lib.h"
+
+static device_t devices[MAX_DEVICES];
+static int num_devices = 0;
+
+static uint32_t urandom_state = 0;
+
+static file_ops_t null_ops = {
+    .write_func = null_write,
+    .read_func = null_read,
+    .close_func = dev_close,
+    .open_func = dev_open
+};
+static file_ops_t zero_ops = {
+    .write_func = null_write,
+    .read_func = zero_read,
+    .close_func = dev_close,
+    .open_func = dev_open
+};
+static file_ops_t urandom_ops = {
+    .write_func = null_write,
+    .read_func = urandom_read,
+    .close_func = dev_close,
+    .open_func = dev_open
+};
+static file_ops_t dev_dir_ops = {
+    .write_func = NULL,
+    .read_func = dev_dir_read,
+    .close_func = dev_close,
+    .open_func = dev_open,
+    .getdents_func = dev_dir_getdents
+};
+
+/* devfs_init
+ *
+ * DESCRIPTION: Registers the devices that live in devfs itself (null, zero
+ *              and urandom) and seeds the urandom generator
+ *
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: adds entries to the device table
+ */
+void devfs_init() {
+    uint32_t tsc_low, tsc_high;
+    asm volatile ("rdtsc" : "=a"(tsc_low), "=d"(tsc_high));
+    urandom_state = tsc_low ^ tsc_high;
+    if (urandom_state == 0) { // xorshift can never leave the all-zero state
+        urandom_state = 0x2545F491;
+    }
+
+    dev_register((int8_t *) "null", &null_ops);
+    dev_register((int8_t *) "zero", &zero_ops);
+    dev_register((int8_t *) "urandom", &urandom_ops);
+}
+
+/* dev_register
+ *
+ * DESCRIPTION: Adds a character device to the device table so it can be
+ *              opened as "/dev/<name>"
+ *
+ * INPUTS: name: name of the device, at most DEV_NAME_LEN - 1 characters
+ *         ops: the file operations backing the device
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if the table is full, the name is invalid
+ *               or the name is already taken
+ * SIDE EFFECTS: none
+ */
+int32_t dev_register(const int8_t * name, file_ops_t * ops) {
+    if (name == NULL || ops == NULL || num_devices >= MAX_DEVICES) {
+        return -1;
+    }
+    if (strlen(name) == 0 || strlen(name) >= DEV_NAME_LEN) {
+        return -1;
+    }
+    if (dev_lookup(name) != NULL) { // names have to be unique
+        return -1;
+    }
+
+    strncpy(devices[num_devices].name, name, DEV_NAME_LEN);
+    devices[num_devices].ops = ops;
+    num_devices++;
+    return 0;
+}
+
+/* dev_lookup
+ *
+ * DESCRIPTION: Finds the file operations of a registered device
+ *
+ * INPUTS: name: name of the device, without the "/dev/" prefix
+ * OUTPUTS: none
+ * RETURN VALUE: pointer to the device's file operations, NULL if there is
+ *               no such device
+ * SIDE EFFECTS: none
+ */
+file_ops_t * dev_lookup(const int8_t * name) {
+    int i;
+    for (i = 0; i < num_devices; i++) {
+        if (!strncmp(devices[i].name, name, DEV_NAME_LEN)) {
+            return devices[i].ops;
+        }
+    }
+    return NULL;
+}
+
+/* dev_lookup_path
+ *
+ * DESCRIPTION: Resolves a path in the /dev namespace
+ *
+ * INPUTS: path: "/dev" for the device directory, or "/dev/<name>"
+ * OUTPUTS: none
+ * RETURN VALUE: pointer to the file operations for the path, NULL if the path
+ *               is not in /dev or names no registered device
+ * SIDE EFFECTS: none
+ */
+file_ops_t * dev_lookup_path(const int8_t * path) {
+    if (!strncmp(path, DEV_DIR_NAME, DEV_PREFIX_LEN)) {
+        return &dev_dir_ops;
+    }
+    if (strncmp(path, DEV_PREFIX, DEV_PREFIX_LEN)) {
+        return NULL;
+    }
+    return dev_lookup(path + DEV_PREFIX_LEN);
+}
+
+/* get_dev_name
+ *
+ * DESCRIPTION: copies the name of the device at index in the device table
+ *
+ * INPUTS: index: index into the device table
+ *         buf: the buffer to copy the name to
+ * OUTPUTS: none
+ * RETURN VALUE: length of the name, 0 if index is out of range
+ * SIDE EFFECTS: none
+ */
+int32_t get_dev_name(int index, void * buf) {
+    uint32_t size;
+    if (index < 0 || index >= num_devices) {
+        return 0;
+    }
+    size = strlen(devices[index].name);
+    memcpy(buf, devices[index].name, size);
+    return size;
+}
+
+/* null_read
+ *
+ * DESCRIPTION: /dev/null is always at end of file
+ *
+ * INPUTS: ignored
+ * OUTPUTS: none
+ * RETURN VALUE: 0
+ * SIDE EFFECTS: none
+ */
+int32_t null_read(int32_t fd, void * buf, int32_t nbytes) {
+    return 0;
+}
+
+/* null_write
+ *
+ * DESCRIPTION: Discards everything written without touching the buffer
+ *
+ * INPUTS: buf: data to discard
+ *         nbytes: number of bytes to discard
+ * OUTPUTS: none
+ * RETURN VALUE: nbytes, -1 for invalid arguments
+ * SIDE EFFECTS: none
+ */
+int32_t null_write(int32_t fd, const void * buf, int32_t nbytes) {
+    if (buf == NULL || nbytes < 0) {
+        return -1;
+    }
+    return nbytes;
+}
+
+/* zero_read
+ *
+ * DESCRIPTION: Fills the buffer with zeros in one memset
+ *
+ * INPUTS: buf: buffer to fill
+ *         nbytes: number of bytes to fill
+ * OUTPUTS: none
+ * RETURN VALUE: nbytes, -1 for invalid arguments
+ * SIDE EFFECTS: none
+ */
+int32_t zero_read(int32_t fd, void * buf, int32_t nbytes) {
+    if (buf == NULL || nbytes < 0) {
+        return -1;
+    }
+    memset(buf, 0, nbytes);
+    return nbytes;
+}
+
+/* urandom_read
+ *
+ * DESCRIPTION: Fills the buffer with pseudo random bytes from a xorshift
+ *              generator, four bytes per step. Not cryptographically secure,
+ *              meant as a cheap source of non-compressible data.
+ *
+ * INPUTS: buf: buffer to fill
+ *         nbytes: number of bytes to fill
+ * OUTPUTS: none
+ * RETURN VALUE: nbytes, -1 for invalid arguments
+ * SIDE EFFECTS: advances the generator state
+ */
+int32_t urandom_read(int32_t fd, void * buf, int32_t nbytes) {
+    uint32_t x = urandom_state;
+    uint32_t * words;
+    uint8_t * bytes;
+    int32_t i;
+
+    if (buf == NULL || nbytes < 0) {
+        return -1;
+    }
+
+    words = (uint32_t *) buf;
+    for (i = 0; i < (nbytes >> 2); i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        words[i] = x;
+    }
+
+    bytes = (uint8_t *) (words + i);
+    if (nbytes & 0x3) { // leftover bytes come from one more step
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        for (i = 0; i < (nbytes & 0x3); i++) {
+            bytes[i] = (uint8_t) (x >> (i << 3));
+        }
+    }
+
+    urandom_state = x;
+    return nbytes;
+}
+
+/* dev_open
+ *
+ * DESCRIPTION: Open for devices that keep no per-open state
+ *
+ * INPUTS: ignored
+ * OUTPUTS: none
+ * RETURN VALUE: 0
+ * SIDE EFFECTS: none
+ */
+int32_t dev_open(const uint8_t * filename) {
+    return 0;
+}
+
+/* dev_close
+ *
+ * DESCRIPTION: Close for devices that keep no per-open state
+ *
+ * INPUTS: ignored
+ * OUTPUTS: none
+ * RETURN VALUE: 0
+ * SIDE EFFECTS: none
+ */
+int32_t dev_close(int32_t fd) {
+    return 0;
+}
+
+/* dev_dir_read
+ *
+ * DESCRIPTION: Reads the /dev directory one device name at a time, like
+ *              dir_read does for the filesystem image
+ *
+ * INPUTS: fd: pointer to the file object of the open directory
+ *         buf: buffer we want to read the name into
+ *         nbytes: unused
+ * OUTPUTS: none
+ * RETURN VALUE: length of the name read, 0 once every device was listed
+ * SIDE EFFECTS: advances the file object's offset
+ */
+int32_t dev_dir_read(int32_t fd, void * buf, int32_t nbytes) {
+    file_object_t * file = (file_object_t *) fd;
+    int32_t read;
+
+    if (file == NULL || buf == NULL) {
+        return -1;
+    }
+
+    read = get_dev_name(file->curr_offset, buf);
+    file->curr_offset += 1;
+    return read;
+}
+
+/* dev_dir_getdents
+ *
+ * DESCRIPTION: Reads as many /dev entries as fit in the buffer, see
+ *              dir_getdents
+ *
+ * INPUTS: fd: pointer to the file object of the open directory
+ *         buf: buffer we want to read the entries into
+ *         nbytes: size of buf
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes read, 0 once every device was listed, -1 if
+ *               buf is too small for the next entry
+ * SIDE EFFECTS: advances the file object's offset
+ */
+int32_t dev_dir_getdents(int32_t fd, void * buf, int32_t nbytes) {
+    file_object_t * file = (file_object_t *) fd;
+    int32_t read = 0;
+    int32_t put;
+
+    if (file == NULL || buf == NULL) {
+        return -1;
+    }
+
+    while (file->curr_offset >= 0 && file->curr_offset < num_devices) {
+        put = put_dirent((uint8_t *) buf + read, nbytes - read, devices[file->curr_offset].name,
+                         strlen(devices[file->curr_offset].name), FILE_TYPE_DEV, 0, 0);
+        if (put == 0) {
+            return (read == 0) ? -1 : read;
+        }
+        read += put;
+        file->curr_offset += 1;
+    }
+    return read;
+}
@@ -0,0 +1,37 @@
+#include "types.h"
+#include "syscall.h"
+
+#ifndef DEVFS_H
+#define DEVFS_H
+
+#define MAX_DEVICES 16
+#define DEV_NAME_LEN 16
+
+/* every registered device is reachable as "/dev/<name>" */
+#define DEV_PREFIX "/dev/"
+#define DEV_PREFIX_LEN 5
+#define DEV_DIR_NAME "/dev"
+
+typedef struct device {
+    int8_t name[DEV_NAME_LEN];
+    file_ops_t * ops;
+} device_t;
+
+void devfs_init();
+
+int32_t dev_register(const int8_t * name, file_ops_t * ops);
+file_ops_t * dev_lookup(const int8_t * name);
+file_ops_t * dev_lookup_path(const int8_t * path);
+
+int32_t get_dev_name(int index, void * buf);
+
+int32_t null_read(int32_t fd, void * buf, int32_t nbytes);
+int32_t null_write(int32_t fd, const void * buf, int32_t nbytes);
+int32_t zero_read(int32_t fd, void * buf, int32_t nbytes);
+int32_t urandom_read(int32_t fd, void * buf, int32_t nbytes);
+int32_t dev_open(const uint8_t * filename);
+int32_t dev_close(int32_t fd);
+int32_t dev_dir_read(int32_t fd, void * buf, int32_t nbytes);
+int32_t dev_dir_getdents(int32_t fd, void * buf, int32_t nbytes);
+
+#endif // DEVFS_H
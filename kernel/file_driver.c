@@ -1,6 +1,7 @@
 #include "types.h"
 #include "file_driver.h"
 #include "paging.h"
+#include "syscall.h"
 #include "lib.h"
 
 #define MAX_FILE_OBJ_COUNT 8
@@ -46,6 +47,43 @@ int32_t fs_read (int32_t fd, void* buf, int32_t nbytes) {
     return read; // return number of return functions
 }
 
+/* fs_readv
+ * 
+ * DESCRIPTION: Reads a file into several buffers, filling each one before
+ *              moving on to the next
+ * 
+ * INPUTS: fd: file descriptor of file we want to read from
+ *         iov: the buffers
+ *         iovcnt: number of buffers
+ *         
+ * OUTPUTS: number of bytes successfully read
+ * RETURN VALUE: integer, total number of bytes read, -1 for a directory or
+ *               a disk error before anything was read
+ * SIDE EFFECTS: populates the buffers, modifies the file's current offset
+ */
+int32_t fs_readv (int32_t fd, const iovec_t* iov, int32_t iovcnt) {
+    file_object_t * file = (file_object_t *) fd;
+    int32_t total = 0;
+    int32_t read, i;
+
+    if (file == NULL || iov == NULL || file->inode == get_dir_inode()) {
+        return -1;
+    }
+
+    for (i = 0; i < iovcnt; i++) {
+        read = read_data(file->inode, file->curr_offset, iov[i].base, iov[i].len);
+        if (read == -1) {
+            return (total == 0) ? -1 : total;
+        }
+        file->curr_offset += read;
+        total += read;
+        if (read < iov[i].len) { // end of file
+            break;
+        }
+    }
+    return total;
+}
+
 /* dir_read
  * 
  * DESCRIPTION: Reads to a buffer from a directory given by file
@@ -71,6 +109,83 @@ int32_t dir_read (int32_t fd, void* buf, int32_t nbytes) {
     return read;
 }
 
+/* dir_getdents
+ * 
+ * DESCRIPTION: Reads as many directory entries as fit in the buffer, with
+ *              their type, inode and size, starting where the last read of
+ *              the directory stopped
+ * 
+ * INPUTS: fd: file descriptor of directory we want to read from
+ *         buf: buffer we want to read the entries into
+ *         nbytes: size of buf
+ *         
+ * OUTPUTS: number of bytes successfully read
+ * RETURN VALUE: integer, number of bytes read. 0 once every entry was read,
+ *               -1 if buf is too small for the next entry
+ * SIDE EFFECTS: advances the file object's offset by the entries read
+ */
+int32_t dir_getdents (int32_t fd, void* buf, int32_t nbytes) {
+    file_object_t * file = (file_object_t*) fd;
+    uint8_t name[FILENAME_LEN];
+    dentry_t dentry;
+    int32_t read = 0; // bytes filled in so far
+    int32_t put, size, name_len;
+
+    if (file == NULL || buf == NULL || nbytes < 0) {
+        return -1;
+    }
+
+    while (0 != (name_len = get_file_name(file->curr_offset, name))) {
+        if (read_dentry_by_index(file->curr_offset, &dentry)) {
+            return -1;
+        }
+        size = 0;
+        if (dentry.filetype == FILE_TYPE_FILE && -1 == (size = read_file_length(dentry.inode_num))) {
+            return -1;
+        }
+        put = put_dirent((uint8_t*) buf + read, nbytes - read, name, name_len, dentry.filetype,
+                         (dentry.filetype == FILE_TYPE_FILE) ? dentry.inode_num : 0, size);
+        if (put == 0) { // out of space, the entry is returned by the next call
+            break;
+        }
+        read += put;
+        file->curr_offset += 1;
+    }
+
+    if (read == 0 && name_len != 0) { // not even one entry fits
+        return -1;
+    }
+    return read;
+}
+
+/* put_dirent
+ * 
+ * DESCRIPTION: Appends one getdents record to a buffer
+ * 
+ * INPUTS: buf: where the record goes
+ *         nbytes: space left at buf
+ *         name: name of the entry, does not need a '\0'
+ *         name_len: length of the name
+ *         type, inode, size: the dirent_t fields
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: size of the record, 0 if it does not fit
+ * SIDE EFFECTS: none
+ */
+int32_t put_dirent (void* buf, int32_t nbytes, const void* name, uint32_t name_len, uint32_t type, uint32_t inode, uint32_t size) {
+    dirent_t * dirent = (dirent_t*) buf;
+
+    if (nbytes < 0 || sizeof(dirent_t) + name_len > nbytes) {
+        return 0;
+    }
+    dirent->inode = inode;
+    dirent->size = size;
+    dirent->type = type;
+    dirent->name_len = name_len;
+    memcpy(dirent + 1, name, name_len);
+    return sizeof(dirent_t) + name_len;
+}
+
 /* fs_write
  * 
  * DESCRIPTION: Does nothing
@@ -142,6 +257,7 @@ int32_t fs_load_exe(const uint8_t* filename, uint32_t program_num) {
     page_directory[PROGRAM_PAGE_INDEX].page_table_base_addr = BASE_ADDR_4M * (program_num + USER_PROGRAM_START_COUNT);
     page_directory[PROGRAM_PAGE_INDEX].page_size = 1; // this is a 4 MB page    
     page_directory[PROGRAM_PAGE_INDEX].user_supervisor = 1; 
+    set_mmap_table(program_num); // file mappings of this process
     flush_tlb(); // flushes tlb
 
     int32_t fd = fs_open(filename);
@@ -188,6 +304,7 @@ int32_t fs_reload_exe(uint32_t program_num) {
         page_directory[PROGRAM_PAGE_INDEX].page_size = 0;
         page_directory[PROGRAM_PAGE_INDEX].user_supervisor = 0;
     }
+    set_mmap_table(program_num); // file mappings of this process
     flush_tlb(); // flushes tlb
 
     return 0;
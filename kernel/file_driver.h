@@ -10,11 +10,29 @@ typedef struct file_object {
     int32_t filetype;
 } file_object_t;
 
+/* header of one record filled in by getdents, name_len bytes of name
+ * follow it without a '\0', then the next record */
+typedef struct __attribute__ ((packed)) dirent {
+    uint32_t inode; // 0 if the file is not in the filesystem
+    uint32_t size; // bytes, 0 for anything but regular files
+    uint8_t type; // FILE_TYPE_* in syscall.h
+    uint8_t name_len;
+} dirent_t;
+
+/* one buffer of a readv or writev */
+typedef struct iovec {
+    void* base;
+    int32_t len;
+} iovec_t;
+
 int32_t fs_read (int32_t fd, void* buf, int32_t nbytes);
 int32_t fs_write (int32_t fd, const void* buf, int32_t nbytes);
 int32_t fs_open (const uint8_t* filename);
 int32_t fs_close (int32_t fd);
 int32_t dir_read (int32_t fd, void* buf, int32_t nbytes);
+int32_t dir_getdents (int32_t fd, void* buf, int32_t nbytes);
+int32_t fs_readv (int32_t fd, const iovec_t* iov, int32_t iovcnt);
+int32_t put_dirent (void* buf, int32_t nbytes, const void* name, uint32_t name_len, uint32_t type, uint32_t inode, uint32_t size);
 int32_t fs_load_exe(const uint8_t* filename, uint32_t program_num);
 int32_t fs_reload_exe(uint32_t program_num);
 #endif
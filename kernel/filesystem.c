@@ -1,12 +1,23 @@
 #include "filesystem.h"
 #include "types.h"
 #include "lib.h"
+#include "kstat.h"
+#include "block.h"
+#include "bcache.h"
 
 static boot_block_t* fs_boot_block;
 
 static int curr_dir_inode = -1;
 
-#define FOUR_KILO 4096
+// disk the filesystem was mounted from, NULL while it is the boot module
+static block_dev_t* fs_dev = NULL;
+
+// end of the last read_data, to detect sequential reads
+static uint32_t last_read_inode = -1;
+static uint32_t last_read_end = 0;
+
+#define FOUR_KILO FS_BLOCK_SIZE
+#define DIR_FILETYPE 1
 
 /* fs_init
  * 
@@ -41,6 +52,126 @@ void fs_init(uint32_t fs_start) {
     // }
 }
 
+/* fs_get_block
+ * 
+ * DESCRIPTION: Gets a 4KB block of the filesystem, from the boot module or
+ *              through the buffer cache
+ * 
+ * INPUTS: block: block index, 0 is the boot block
+ *         handle: set to the cache buffer to give back with fs_put_block
+ * OUTPUTS: none
+ * RETURN VALUE: pointer to the block, NULL if it could not be read
+ * SIDE EFFECTS: may read the disk
+ */
+static void* fs_get_block(uint32_t block, bcache_buf_t** handle) {
+    *handle = NULL;
+    if (fs_dev == NULL) {
+        return fs_boot_block + block;
+    }
+    if (NULL == (*handle = bcache_get(fs_dev, block))) {
+        return NULL;
+    }
+    return (*handle)->data;
+}
+
+/* fs_put_block
+ * 
+ * DESCRIPTION: Gives back a block from fs_get_block
+ * 
+ * INPUTS: handle: the handle fs_get_block returned
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void fs_put_block(bcache_buf_t* handle) {
+    if (handle != NULL) {
+        bcache_release(handle);
+    }
+}
+
+/* fs_valid
+ * 
+ * DESCRIPTION: Sanity checks a boot block read from a disk
+ * 
+ * INPUTS: boot: the boot block
+ *         num_blocks: size of the disk in 4KB blocks
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if the disk holds a filesystem, 0 otherwise
+ * SIDE EFFECTS: none
+ */
+static int fs_valid(boot_block_t* boot, uint32_t num_blocks) {
+    if (boot->dir_count == 0 || boot->dir_count > MAX_DENTRIES) {
+        return 0;
+    }
+    if (boot->inode_count == 0 || boot->inode_count >= num_blocks || boot->data_count >= num_blocks) {
+        return 0;
+    }
+    if (1 + boot->inode_count + boot->data_count > num_blocks) {
+        return 0;
+    }
+    // the first entry of every image is the directory itself
+    return !strncmp((int8_t*) boot->dentries[0].filename, ".", FILENAME_LEN) &&
+        boot->dentries[0].filetype == DIR_FILETYPE;
+}
+
+/* fs_mount
+ * 
+ * DESCRIPTION: Switches the filesystem over to the first disk that holds a
+ *              valid image, so files are read on demand instead of from the
+ *              boot module
+ * 
+ * INPUTS: none
+ * OUTPUTS: prints the disk that was mounted
+ * RETURN VALUE: 0 if a disk was mounted, -1 if the boot module stays in use
+ * SIDE EFFECTS: the boot block stays pinned in the buffer cache
+ */
+int32_t fs_mount() {
+    block_dev_t* dev;
+    bcache_buf_t* buf;
+    int i;
+
+    for (i = 0; NULL != (dev = block_get(i)); i++) {
+        if (NULL == (buf = bcache_get(dev, 0))) {
+            continue;
+        }
+        if (fs_valid((boot_block_t*) buf->data, dev->num_sectors / BCACHE_BLOCK_SECTORS)) {
+            fs_dev = dev;
+            fs_boot_block = (boot_block_t*) buf->data;
+            printf("filesystem mounted from %s\n", dev->name);
+            return 0;
+        }
+        bcache_release(buf);
+    }
+    return -1;
+}
+
+/* fs_readahead
+ * 
+ * DESCRIPTION: Starts reading the data blocks of a file that follow a
+ *              sequential read
+ * 
+ * INPUTS: inode_ptr: inode of the file
+ *         next_block: index of the first file block to fetch
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: evicts least recently used blocks from the cache
+ */
+static void fs_readahead(inode_t* inode_ptr, uint32_t next_block) {
+    uint32_t blocks[BCACHE_READAHEAD];
+    uint32_t num_file_blocks = (inode_ptr->length + FOUR_KILO - 1) / FOUR_KILO;
+    int n = 0;
+
+    for (; next_block < num_file_blocks && n < BCACHE_READAHEAD; next_block++) {
+        if (inode_ptr->data_block_num[next_block] >= fs_boot_block->data_count) {
+            break;
+        }
+        blocks[n++] = 1 + fs_boot_block->inode_count + inode_ptr->data_block_num[next_block];
+    }
+    if (n > 0) {
+        bcache_readahead(fs_dev, blocks, n);
+    }
+}
+
 
 /* read_dentry_by_name
  * 
@@ -71,6 +202,10 @@ int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry) {
     }
     // idx is corrent, call read_by_index from here
     int32_t retval = read_dentry_by_index(idx, dentry);
+    kstat.fs_lookups++;
+    if (retval != 0) {
+        kstat.fs_lookup_misses++;
+    }
     if(dir_flag) curr_dir_inode = dentry->inode_num;
     return retval;
 }
@@ -122,11 +257,17 @@ int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry) {
  * SIDE EFFECTS: populates buf with bytes read from the file
  */
 int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length) {
+    bcache_buf_t* inode_handle;
+    bcache_buf_t* data_handle;
     // pointer to the inode we want to read from, +1 to skip boot block
-    inode_t* inode_ptr = (inode_t*)(fs_boot_block + (inode + 1)); 
+    inode_t* inode_ptr;
 
+    if (inode >= fs_boot_block->inode_count || NULL == (inode_ptr = fs_get_block(inode + 1, &inode_handle))) {
+        return -1;
+    }
 
     if (offset >= inode_ptr->length) {
+        fs_put_block(inode_handle);
         return 0;
     }
     if (offset + length >= inode_ptr->length) {
@@ -156,19 +297,95 @@ int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length
             copy_end = FOUR_KILO;
         }
         uint32_t copy_length = copy_end - copy_start;
+        if (copy_length == 0) { // read ends on a block boundary, don't fetch the next block
+            break;
+        }
         // pointer to the start of data we want to read
-        uint8_t* data_start_pointer = 
-            ((uint8_t*)( //cast
-            (fs_boot_block + 1 + fs_boot_block->inode_count) // boot block + 1 is first inode, plus inode_count to skip inodes
-            + (inode_ptr->data_block_num[i]))) // start at the first data block according to the inode
-            + copy_start; // add the offset we want to start reading from
-        memcpy(buf + length_copied, data_start_pointer, copy_length);
+        uint8_t* data_start_pointer = fs_get_block(
+            1 + fs_boot_block->inode_count // boot block + 1 is first inode, plus inode_count to skip inodes
+            + inode_ptr->data_block_num[i], &data_handle); // start at the first data block according to the inode
+        if (data_start_pointer == NULL) {
+            break;
+        }
+        memcpy(buf + length_copied, data_start_pointer + copy_start, copy_length); // add the offset we want to start reading from
+        fs_put_block(data_handle);
         length_copied += copy_length;
     }
 
+    // a sequential read that reached a new block fetches the blocks after it
+    // while the caller works on this one
+    if (fs_dev != NULL && (offset == 0 || (inode == last_read_inode && offset == last_read_end)) &&
+        (start_offset == 0 || start_block != end_block)) {
+        fs_readahead(inode_ptr, end_block + 1);
+    }
+    last_read_inode = inode;
+    last_read_end = offset + length_copied;
+    fs_put_block(inode_handle);
+
+    kstat.fs_reads++;
+    kstat.fs_read_bytes += length_copied;
+
+    if (length_copied == 0 && length != 0) { // the disk failed
+        return -1;
+    }
     return length_copied; // return number of bytes read
 }
 
+/* read_file_length
+ * 
+ * DESCRIPTION: gets the size of a file
+ * 
+ * INPUTS: inode: index node of the file
+ * OUTPUTS: none
+ * RETURN VALUE: length of the file in bytes, -1 for an invalid inode or a
+ *               disk error
+ * SIDE EFFECTS: none
+ */
+int32_t read_file_length(uint32_t inode) {
+    bcache_buf_t* inode_handle;
+    inode_t* inode_ptr;
+    int32_t length;
+
+    if (inode >= fs_boot_block->inode_count || NULL == (inode_ptr = fs_get_block(inode + 1, &inode_handle))) {
+        return -1;
+    }
+    length = inode_ptr->length;
+    fs_put_block(inode_handle);
+    return length;
+}
+
+/* read_block_addr
+ * 
+ * DESCRIPTION: gets the physical address of a data block of a file, so it
+ *              can be mapped instead of copied. Only possible while the
+ *              filesystem is the page aligned boot module, disk blocks live
+ *              in the buffer cache and can be evicted.
+ * 
+ * INPUTS: inode: index node of the file
+ *         index: index of the 4KB block within the file
+ *         addr: set to the address of the block
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if the block can't be mapped
+ * SIDE EFFECTS: none
+ */
+int32_t read_block_addr(uint32_t inode, uint32_t index, uint32_t* addr) {
+    inode_t* inode_ptr;
+
+    if (fs_dev != NULL || ((uint32_t) fs_boot_block & (FOUR_KILO - 1))) {
+        return -1;
+    }
+    if (inode >= fs_boot_block->inode_count) {
+        return -1;
+    }
+    inode_ptr = (inode_t*)(fs_boot_block + inode + 1);
+    if (index >= (inode_ptr->length + FOUR_KILO - 1) / FOUR_KILO ||
+        inode_ptr->data_block_num[index] >= fs_boot_block->data_count) {
+        return -1;
+    }
+    *addr = (uint32_t)(fs_boot_block + 1 + fs_boot_block->inode_count + inode_ptr->data_block_num[index]);
+    return 0;
+}
+
 /* list_filesystem
  * 
  * DESCRIPTION: prints out the filename, file size, file type of every
@@ -183,6 +400,8 @@ void list_filesystem() {
     int i, j; // loop vars
     dentry_t * dentry;
     uint32_t size;
+    inode_t * inode_ptr;
+    bcache_buf_t * inode_handle;
 
     for (i = 0; i < fs_boot_block->dir_count; i++) { // loop through dentries
         dentry = &(fs_boot_block->dentries[i]); // get ptr to dentry for current file
@@ -202,7 +421,11 @@ void list_filesystem() {
         puts(", file_type: ");
         printf("%d", dentry->filetype); // access filetype through dentry
 
-        size = ((inode_t*)(fs_boot_block + dentry->inode_num + 1))->length; // accesses size of file from inode
+        size = 0;
+        if (NULL != (inode_ptr = fs_get_block(dentry->inode_num + 1, &inode_handle))) {
+            size = inode_ptr->length; // accesses size of file from inode
+            fs_put_block(inode_handle);
+        }
         puts(", file_size: ");
         printf("%d", size);
 
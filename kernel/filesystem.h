@@ -4,6 +4,8 @@
 #define FILE_SYSTEM_H
 
 #define FILENAME_LEN 32
+#define MAX_DENTRIES 63
+#define FS_BLOCK_SIZE 4096
 
 typedef struct __attribute__ ((packed)) dentry {
     uint8_t filename[FILENAME_LEN];
@@ -17,7 +19,7 @@ typedef struct __attribute__ ((packed)) boot_block {
     uint32_t inode_count;
     uint32_t data_count;
     uint8_t reserved[52];
-    dentry_t dentries[63];
+    dentry_t dentries[MAX_DENTRIES];
 } boot_block_t;
 
 typedef struct __attribute__ ((packed)) inode {
@@ -29,8 +31,11 @@ int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry);
 int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry);
 int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length);
 int32_t get_file_name(int index, void* buf);
+int32_t read_file_length(uint32_t inode);
+int32_t read_block_addr(uint32_t inode, uint32_t index, uint32_t* addr);
 
 void fs_init(uint32_t fs_start);
+int32_t fs_mount();
 
 void list_filesystem();
 
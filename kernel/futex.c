@@ -0,0 +1,119 @@
+#include "futex.h"
+#include "types.h"
+#include "lib.h"
+
+static futex_bucket_t buckets[FUTEX_BUCKETS];
+
+/* futex_bucket
+ *
+ * DESCRIPTION: Finds the bucket of a word
+ *
+ * INPUTS: key: physical address of the word
+ * OUTPUTS: none
+ * RETURN VALUE: the bucket
+ * SIDE EFFECTS: none
+ */
+static futex_bucket_t * futex_bucket(uint32_t key) {
+    return &buckets[(key >> 2) & (FUTEX_BUCKETS - 1)];
+}
+
+/* futex_queue
+ *
+ * DESCRIPTION: Puts a process to sleep on a word, the scheduler skips it
+ *              until futex_wake_key wakes it. Interrupts have to be off
+ *              from checking the word until the process is queued.
+ *
+ * INPUTS: pcb: the process
+ *         key: physical address of the word
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void futex_queue(pcb_t * pcb, uint32_t key) {
+    futex_bucket_t * b = futex_bucket(key);
+
+    pcb->futex_key = key;
+    pcb->futex_next = NULL;
+    if (b->tail != NULL) {
+        b->tail->futex_next = pcb;
+    } else {
+        b->head = pcb;
+    }
+    b->tail = pcb;
+}
+
+/* futex_wake_key
+ *
+ * DESCRIPTION: Wakes the processes that sleep on a word, in the order they
+ *              went to sleep
+ *
+ * INPUTS: key: physical address of the word
+ *         n: most processes to wake
+ * OUTPUTS: none
+ * RETURN VALUE: number of processes woken
+ * SIDE EFFECTS: none
+ */
+int32_t futex_wake_key(uint32_t key, int32_t n) {
+    futex_bucket_t * b = futex_bucket(key);
+    pcb_t * prev = NULL;
+    pcb_t * pcb;
+    pcb_t * next;
+    uint32_t flags;
+    int32_t woken = 0;
+
+    cli_and_save(flags);
+    for (pcb = b->head; pcb != NULL && woken < n; pcb = next) {
+        next = pcb->futex_next;
+        if (pcb->futex_key != key) {
+            prev = pcb;
+            continue;
+        }
+        if (prev != NULL) {
+            prev->futex_next = next;
+        } else {
+            b->head = next;
+        }
+        if (b->tail == pcb) {
+            b->tail = prev;
+        }
+        pcb->futex_next = NULL;
+        pcb->futex_key = 0;
+        woken++;
+    }
+    restore_flags(flags);
+    return woken;
+}
+
+/* futex_cancel
+ *
+ * DESCRIPTION: Takes a sleeping process out of its bucket without waking
+ *              the others on the same word, for a thread that is ended
+ *              while it sleeps
+ *
+ * INPUTS: pcb: the process, its futex_key has to be set
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: interrupts have to be off
+ */
+void futex_cancel(pcb_t * pcb) {
+    futex_bucket_t * b = futex_bucket(pcb->futex_key);
+    pcb_t * prev = NULL;
+    pcb_t * cur;
+
+    for (cur = b->head; cur != NULL && cur != pcb; cur = cur->futex_next) {
+        prev = cur;
+    }
+    if (cur == NULL) {
+        return;
+    }
+    if (prev != NULL) {
+        prev->futex_next = pcb->futex_next;
+    } else {
+        b->head = pcb->futex_next;
+    }
+    if (b->tail == pcb) {
+        b->tail = prev;
+    }
+    pcb->futex_next = NULL;
+    pcb->futex_key = 0;
+}
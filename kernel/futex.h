@@ -0,0 +1,22 @@
+#include "types.h"
+#include "syscall.h"
+
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#define FUTEX_BUCKETS 32 // a power of two
+
+/* processes sleeping in futex_wait, hashed by the physical address of the
+ * word they wait on so processes that map the same page at different
+ * addresses meet in one queue. A bucket is a FIFO list linked through
+ * pcb->futex_next, pcb->futex_key tells the waiters of one word apart. */
+typedef struct futex_bucket {
+    pcb_t * head;
+    pcb_t * tail;
+} futex_bucket_t;
+
+void futex_queue(pcb_t * pcb, uint32_t key);
+int32_t futex_wake_key(uint32_t key, int32_t n);
+void futex_cancel(pcb_t * pcb);
+
+#endif // FUTEX_H
@@ -4,6 +4,8 @@
 #include "linkage.h"
 #include "terminal.h"
 #include "syscall.h"
+#include "kstat.h"
+#include "paging.h"
 
 
 static void (*interrupt_pointers[NUM_IRQS]) ();
@@ -127,6 +129,29 @@ exception_handler(int32_t num, int32_t eflags, registers_t regs){
     sys_halt(256);
 }
 
+/* Handler for page faults
+*  Inputs:
+*          num: the exception vector number
+*          int32_t eflags: value of the eflags register
+*          registeres_t regs: struct containing values of the big 7 registers
+*  Outputs: None
+*  Side Effects: A fault on a demand-zero page of the running process maps a
+*                zeroed page and returns so the access is retried, anything
+*                else halts the process like the other exceptions
+*/
+void
+page_fault_handler(int32_t num, int32_t eflags, registers_t regs){
+    uint32_t addr;
+    pcb_t * pcb = get_current_pcb();
+
+    asm volatile ("mov %%cr2, %0" : "=r" (addr));
+    if (pcb != NULL && mmap_fault(pcb->process->pid, addr) == 0) {
+        kstat.demand_zero_faults++;
+        return;
+    }
+    exception_handler(num, eflags, regs);
+}
+
 /* Gets pointer to interrupt linkage according to its index in IDT
 *  Inputs:
 *          int32_t num: the exception/interrupt vector number
@@ -230,13 +255,15 @@ void init_interrupt_pointers() {
 *  Inputs: int32_t num: the interrupt vector corresponding to the IRQ we are to install
 *                       e.g. 0x21 for the keyboard
 *  Outputs: None
-*  Side Effects: if the interrupt function pointer corresponding to the IRQ line is not null,
-*                execute the handler function. Otherwise, do nothing
+*  Side Effects: counts the interrupt in kstat. If the interrupt function pointer
+*                corresponding to the IRQ line is not null, execute the handler
+*                function. Otherwise, do nothing
 */
 void common_irq_handler(int32_t num) {
     if (num < IRQ_0 || num >= IRQ_0 + NUM_IRQS) {
         return;
     }
+    kstat.irq_count[num - IRQ_0]++;
     if (interrupt_pointers[num - IRQ_0] != NULL) {
         (*interrupt_pointers[num - IRQ_0])();
     }
@@ -21,6 +21,9 @@ extern void default_interrupt_handler(int32_t eflags, registers_t regs);
 // handles all exceptions. output to screen and hangs
 extern void exception_handler(int32_t num, int32_t eflags, registers_t regs);
 
+// maps demand-zero pages, other page faults go to exception_handler
+extern void page_fault_handler(int32_t num, int32_t eflags, registers_t regs);
+
 // gets the pointer to handlers given their IDT index
 extern void* get_exception_pointer(int32_t num);
 
@@ -17,6 +17,13 @@
 #include "terminal.h"
 #include "pit.h"
 #include "networking.h"
+#include "devfs.h"
+#include "pty.h"
+#include "shm.h"
+#include "bcache.h"
+#include "ata.h"
+#include "virtio_blk.h"
+#include "palloc.h"
 
 #define RUN_TESTS
 
@@ -180,11 +187,23 @@ void entry(unsigned long magic, unsigned long addr) {
 
     init_paging();
     enable_paging();
+    palloc_init();
+    shm_init();
     
+    devfs_init();
+    pty_init();
     initialize_keyboard();
+    terminal_init();
     initialize_rtc();
     init_ethernet_config_from_pci();
 
+    // files come from a disk with a filesystem image if there is one,
+    // virtio disks are registered first so they are preferred over IDE
+    bcache_init();
+    virtio_blk_init();
+    ata_init();
+    fs_mount();
+
     install_interrupt_pointer(terminal_driver, KEYBOARD_INTERRUPT);
     install_interrupt_pointer(rtc_handler, RTC_INTERRUPT);
     //install_interrupt_pointer(pit_handler, PIT_INTERRUPT);
@@ -15,6 +15,15 @@ static volatile uint8_t ctrl_held = 0;
 static volatile uint8_t alt_held = 0;
 static volatile uint8_t esc_held = 0;
 
+/* Key presses go from the keyboard interrupt to the terminal through a ring with
+ * one producer and one consumer. Each side only moves its own index, so the
+ * interrupt never has to wait for the consumer. The indices run freely and are
+ * masked when used.
+ */
+static key_event_t key_queue[KEY_QUEUE_SIZE];
+static volatile uint32_t key_head = 0; //next key to take out, only moved by the consumer
+static volatile uint32_t key_tail = 0; //next free slot, only moved by the producer
+
 /* alt_is_held
  * Description: gets current state of alt key on keyboard.
  * Return Value: current state of alt key (1 if pressed, 0 if not pressed) 
@@ -100,18 +109,18 @@ char to_uppercase(char input){
         }
     }
 }
-/* get_char
+/* decode_char
  * 
- * DESCRIPTION: Gets the character value of a keyboard scan input. 
- *              This is needed since keyboard returns which button was pressed/released, not what letter.
- *              Also returns uppercase/shifted values based on state of caps lock/shift.
+ * DESCRIPTION: Gets the character value of a keyboard scan input with the given state of shift and caps lock.
  * 
  * INPUTS: value -- Keyboard scan value.
+ *         shift -- 1 if shift is held
+ *         caps  -- 1 if caps lock is on
  * OUTPUTS: none
- * RETURN VALUE: Character value of input, if it evaluates to one. Otherwise returns the input.
+ * RETURN VALUE: Character value of input, 0 if it is not a character.
  * SIDE EFFECTS: None.
  */
-char get_char(uint8_t value){
+static char decode_char(uint8_t value, uint8_t shift, uint8_t caps){
     char output = 0;
     if(value>=NUM_ROW_START && value <= NUM_ROW_END){
         output = num_row[value-NUM_ROW_START];
@@ -131,15 +140,91 @@ char get_char(uint8_t value){
         output = '`';
     }
     if('a'<=output && output<='z'){ //if the character is in the alphabet
-        if(caps_on^shift_held){
+        if(caps^shift){
             output = to_uppercase(output);
         }
-    }else if(shift_held){
+    }else if(shift){
         output = to_uppercase(output);
     }
     return output;
 }
 
+/* get_char
+ * 
+ * DESCRIPTION: Gets the character value of a keyboard scan input. 
+ *              This is needed since keyboard returns which button was pressed/released, not what letter.
+ *              Also returns uppercase/shifted values based on state of caps lock/shift.
+ * 
+ * INPUTS: value -- Keyboard scan value.
+ * OUTPUTS: none
+ * RETURN VALUE: Character value of input, if it evaluates to one. Otherwise returns the input.
+ * SIDE EFFECTS: None.
+ */
+char get_char(uint8_t value){
+    return decode_char(value, shift_held, caps_on);
+}
+
+/* key_event_char
+ * 
+ * DESCRIPTION: Gets the character a queued key press typed, using the shift and caps lock
+ *              state from when the key was pressed.
+ * 
+ * INPUTS: ev -- the key press
+ * OUTPUTS: none
+ * RETURN VALUE: Character value of the key, 0 if it is not a character.
+ * SIDE EFFECTS: None.
+ */
+char key_event_char(const key_event_t * ev){
+    return decode_char(ev->value, (ev->mods & KEY_MOD_SHIFT) != 0, (ev->mods & KEY_MOD_CAPS) != 0);
+}
+
+/* key_queue_put
+ * 
+ * DESCRIPTION: Queues a key press along with the modifiers held right now. Only the keyboard
+ *              interrupt calls this.
+ * 
+ * INPUTS: value -- Keyboard scan value.
+ *         tag   -- stored with the key for the consumer
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if the queue is full and the key was dropped
+ * SIDE EFFECTS: None.
+ */
+int key_queue_put(uint8_t value, uint8_t tag){
+    key_event_t * ev;
+
+    if(key_tail - key_head == KEY_QUEUE_SIZE){
+        return -1;
+    }
+    ev = &key_queue[key_tail & (KEY_QUEUE_SIZE - 1)];
+    ev->value = value;
+    ev->mods = (shift_held ? KEY_MOD_SHIFT : 0) | (ctrl_held ? KEY_MOD_CTRL : 0) |
+               (alt_held ? KEY_MOD_ALT : 0) | (caps_on ? KEY_MOD_CAPS : 0);
+    ev->tag = tag;
+    asm volatile ("" : : : "memory"); //the key has to be written before it is published
+    key_tail++;
+    return 0;
+}
+
+/* key_queue_get
+ * 
+ * DESCRIPTION: Takes the oldest key press off the queue. There can only be one consumer
+ *              at a time, callers keep each other out by disabling interrupts.
+ * 
+ * INPUTS: ev -- filled in with the key press
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if the queue is empty
+ * SIDE EFFECTS: None.
+ */
+int key_queue_get(key_event_t * ev){
+    if(key_head == key_tail){
+        return -1;
+    }
+    *ev = key_queue[key_head & (KEY_QUEUE_SIZE - 1)];
+    asm volatile ("" : : : "memory"); //the key has to be read before its slot is given back
+    key_head++;
+    return 0;
+}
+
 
 /* read_key_press
  * 
@@ -43,8 +43,21 @@
 
 #define BACKSPACE_PRESSED 0x0E
 
+#define PAGE_UP_PRESSED 0x49
+#define PAGE_DOWN_PRESSED 0x51
+
 #define UPPER_TO_LOWER 0x20
 
+#define KEY_RELEASED 0x80 // set in the scan value of a released key
+
+/* modifiers held when a key was pressed */
+#define KEY_MOD_SHIFT 0x1
+#define KEY_MOD_CTRL 0x2
+#define KEY_MOD_ALT 0x4
+#define KEY_MOD_CAPS 0x8
+
+#define KEY_QUEUE_SIZE 256 // key presses waiting to be handled, a power of two
+
 /*https://wiki.osdev.org/PS2_Keyboard*/
 #define FN1 0x3B
 #define FN2 0x3C
@@ -59,8 +72,19 @@
 #define F11 0x57
 #define F12 0x58
 
+/* a key press, queued by the keyboard interrupt */
+typedef struct key_event {
+    uint8_t value; // scan value
+    uint8_t mods; // KEY_MOD_* at the time of the press
+    uint8_t tag; // chosen by whoever queued the key
+} key_event_t;
+
 void initialize_keyboard();
 
+int key_queue_put(uint8_t value, uint8_t tag);
+int key_queue_get(key_event_t * ev);
+char key_event_char(const key_event_t * ev);
+
 uint8_t read_key_press();
 
 uint8_t ctrl_is_held();
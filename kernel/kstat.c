@@ -0,0 +1,34 @@
+#include "kstat.h"
+#include "types.h"
+
+kstat_t kstat;
+uint32_t syscall_calls[KSTAT_MAX_SYSCALLS];
+uint32_t tlb_flush_count = 0;
+
+/* syscall_account
+ * 
+ * DESCRIPTION: Records the latency of a system call that returned. Called
+ *              from SYSCALL_LINKAGE with the timestamp taken at entry.
+ * 
+ * INPUTS: index: the syscall's index in the syscall table
+ *         tsc_low: low 32 bits of the entry timestamp
+ *         tsc_high: high 32 bits of the entry timestamp
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: updates kstat
+ */
+void syscall_account(uint32_t index, uint32_t tsc_low, uint32_t tsc_high) {
+    uint32_t now_low, now_high;
+    uint64_t start, now;
+
+    if (index >= KSTAT_MAX_SYSCALLS) {
+        return;
+    }
+
+    asm volatile ("rdtsc" : "=a"(now_low), "=d"(now_high));
+    start = ((uint64_t) tsc_high << 32) | tsc_low;
+    now = ((uint64_t) now_high << 32) | now_low;
+
+    kstat.syscall_returns[index]++;
+    kstat.syscall_cycles[index] += now - start;
+}
@@ -0,0 +1,58 @@
+#include "types.h"
+#include "exception_numbers.h"
+
+#ifndef KSTAT_H
+#define KSTAT_H
+
+/* size of the per-syscall tables, has to cover NUM_SYSCALLS in linkage.S */
+#define KSTAT_MAX_SYSCALLS 64
+
+/* counters maintained by the kernel and exported through procfs */
+typedef struct kstat {
+    uint32_t ticks;                 // PIT interrupts since the scheduler started
+    uint32_t context_switches;
+    uint32_t irq_count[NUM_IRQS];
+    uint32_t syscall_returns[KSTAT_MAX_SYSCALLS];
+    uint64_t syscall_cycles[KSTAT_MAX_SYSCALLS]; // summed entry to exit TSC deltas
+    uint32_t fs_lookups;
+    uint32_t fs_lookup_misses;
+    uint32_t fs_reads;
+    uint32_t fs_read_bytes;
+    uint32_t bcache_hits;
+    uint32_t bcache_misses;
+    uint32_t bcache_readahead_blocks;
+    uint32_t block_requests;
+    uint32_t block_read_sectors;
+    uint32_t block_write_sectors;
+    uint32_t vblk_requests;         // virtio requests, after merging adjacent block requests
+    uint32_t vblk_kicks;            // notifies actually sent to the device
+    uint32_t vblk_completions;
+    uint32_t vblk_queue_depth;      // requests currently on the ring
+    uint32_t vblk_max_queue_depth;
+    uint64_t vblk_latency_cycles;   // summed submit to reap TSC deltas
+    uint32_t pages_used;            // pages currently handed out by palloc
+    uint32_t demand_zero_faults;    // heap and anonymous mmap pages allocated on first touch
+    uint32_t nic_tx_packets;
+    uint32_t nic_tx_bytes;
+    uint32_t nic_rx_packets;
+    uint32_t nic_rx_bytes;
+    uint32_t term_writes;           // write and writev calls on terminals
+    uint32_t term_chars;            // characters they wrote
+    uint64_t term_cycles;           // summed TSC deltas of those writes
+    uint32_t term_switches;         // changes of the displayed terminal
+    uint32_t term_switch_cycles;    // TSC delta of the last one
+    uint32_t term_flushes;          // screen updates from the terminal shadow buffers
+    uint32_t term_flushed_rows;     // rows they copied to VGA memory
+    uint32_t keys;                  // key presses queued by the keyboard interrupt
+    uint32_t keys_dropped;          // key presses and typed input lost to full queues
+} kstat_t;
+
+extern kstat_t kstat;
+
+/* these two are bumped straight from assembly (SYSCALL_LINKAGE, flush_tlb) */
+extern uint32_t syscall_calls[KSTAT_MAX_SYSCALLS];
+extern uint32_t tlb_flush_count;
+
+void syscall_account(uint32_t index, uint32_t tsc_low, uint32_t tsc_high);
+
+#endif // KSTAT_H
@@ -147,11 +147,9 @@ int32_t puts(int8_t* s) {
 /* void putc(uint8_t c);
  * Inputs: uint_8* c = character to print
  * Return Value: void
- * Side Effects: Clears the terminal buffer.
  * Function: Output a character to the console */
 void putc(uint8_t c) {
     terminal_print_char((char)c);
-    buffer_clear();
 }
 
 /* int8_t* itoa(uint32_t value, int8_t* buf, int32_t radix);
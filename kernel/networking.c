@@ -5,6 +5,8 @@
 #include "outl.h"
 #include "i8259.h"
 #include "paging.h"
+#include "devfs.h"
+#include "kstat.h"
 
 static volatile ethernet_card_t card;
 static  uint32_t next_avail_mem;
@@ -12,6 +14,14 @@ static uint32_t flag[3];
 static uint32_t terminal_idx = 0;
 static uint8_t * eth_buffers[3];
 
+static file_ops_t eth_ops = {
+    .write_func = eth_write,
+    .read_func = eth_read,
+    .close_func = eth_close,
+    .open_func = eth_open,
+    .writev_func = eth_writev
+};
+
 static ethernet_frame_t test_packet = {
     .preamble = {10,10,10,10,10,10,10},
     .sfd = 0xAB,
@@ -81,6 +91,8 @@ int init_ethernet_config_from_pci() {
     receiver_init();
     trasmitter_init();
 
+    dev_register((int8_t *) "eth", &eth_ops);
+
     return 0;
 
 }
@@ -292,6 +304,8 @@ int send_packet(const void * p_data, uint16_t p_len)
     while(!(card.t_desc_ptrs[old_cur]->status & 1)) {
        // printf("%d", (card.t_desc_ptrs[old_cur]->status));
     }    
+    kstat.nic_tx_packets++;
+    kstat.nic_tx_bytes += p_len;
     return 0;
 }
 
@@ -320,6 +334,8 @@ void handle_receive() {
             uint8_t *buf = (uint8_t *)card.r_desc_ptrs[card.r_cur]->address;
             uint16_t len = card.r_desc_ptrs[card.r_cur]->length;
             // Here you should inject the received packet into your network stack
+            kstat.nic_rx_packets++;
+            kstat.nic_rx_bytes += len;
             card.r_desc_ptrs[card.r_cur]->status = 0;
             old_cur = card.r_cur;
             card.r_cur = (card.r_cur + 1) % E1000_NUM_RX_DESC;
@@ -347,6 +363,28 @@ int eth_write(int fd, const void * buf, int nbytes) {
     flag[terminal_idx] = 2;
     return 0;
 }
+/* eth_writev
+ *
+ * DESCRIPTION: Vector write for the card. Like eth_write the data is not
+ *              used yet and every call sends one test burst, so a writev
+ *              sends one burst no matter how many buffers it has.
+ *
+ * INPUTS: iov: the buffers
+ *         iovcnt: number of buffers
+ * OUTPUTS: none
+ * RETURN VALUE: total length of the buffers
+ * SIDE EFFECTS: sends packets
+ */
+int eth_writev(int fd, const iovec_t * iov, int iovcnt) {
+    int total = 0;
+    int i;
+
+    for (i = 0; i < iovcnt; i++) {
+        total += iov[i].len;
+    }
+    eth_write(fd, NULL, total);
+    return total;
+}
 int eth_open(const unsigned char * filename) {
     flag[terminal_idx] = 0;
     return 0;
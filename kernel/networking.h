@@ -2,6 +2,7 @@
 #define NETWORKING_H
 
 #include "types.h"
+#include "file_driver.h"
 
 #define NETWORK_CONTROLLER_CLASSCODE 0x2
 #define ETHERNET_CONTROLLER_SUBCLASS 0x0
@@ -139,6 +140,7 @@ typedef struct __attribute__ ((packed)) ethernet_frame {
 
 int eth_read(int fd, void * buf, int nbytes);
 int eth_write(int fd, const void * buf, int nbytes);
+int eth_writev(int fd, const iovec_t * iov, int iovcnt);
 int eth_open(const unsigned char * filename);
 int eth_close(int fd);
 
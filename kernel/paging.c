@@ -1,6 +1,10 @@
 
 #include "paging.h"
 #include "lib.h"
+#include "palloc.h"
+#include "shm.h"
+
+page_table_entry_t mmap_tables[NUM_MMAP_TABLES][MMAP_TABLE_ENTRIES] __attribute__((aligned(4096)));
 
 /* init_paging
  * 
@@ -73,17 +77,10 @@ void init_paging(){
     // page_directory[32].page_size = 1; // this is a 4 MB page
 
     // video memory
-    page_table[VIDEO_IDX].present = 1; // video memory is present
-    page_table[VIDEO_IDX].read_write = 1; // we can read/write to it
-
-    page_table[TERM1_VIDEO_ADDR].present = 1; // video memory is present
-    page_table[TERM1_VIDEO_ADDR].read_write = 1; // we can read/write to it
-
-    page_table[TERM2_VIDEO_ADDR].present = 1; // video memory is present
-    page_table[TERM2_VIDEO_ADDR].read_write = 1; // we can read/write to it
-
-    page_table[TERM3_VIDEO_ADDR].present = 1; // video memory is present
-    page_table[TERM3_VIDEO_ADDR].read_write = 1; // we can read/write to it
+    for (i = VIDEO_IDX; i < VIDEO_IDX + VIDEO_NUM_PAGES; i++) {
+        page_table[i].present = 1; // video memory is present
+        page_table[i].read_write = 1; // we can read/write to it
+    }
 
     // USER_VIDEO_PDE_INDEX is 33, since program image ends at 132 MB and this is where
     // the next page will start. index 33 corresponds to 132 MB in virtual space. 
@@ -94,6 +91,24 @@ void init_paging(){
     page_directory[USER_VIDEO_PDE_IDX].page_table_base_addr = ((int)video_map_table) >> 12; // PT for video map
     page_directory[USER_VIDEO_PDE_IDX].page_size = 0; 
 
+    // mmap region, pointed at the running process' table by set_mmap_table.
+    // the PTEs decide what is writable
+    page_directory[USER_MMAP_PDE_IDX].present = 0;
+    page_directory[USER_MMAP_PDE_IDX].read_write = 1;
+    page_directory[USER_MMAP_PDE_IDX].user_supervisor = 1;
+    page_directory[USER_MMAP_PDE_IDX].page_size = 0;
+    page_directory[USER_HEAP_PDE_IDX].present = 0;
+    page_directory[USER_HEAP_PDE_IDX].read_write = 1;
+    page_directory[USER_HEAP_PDE_IDX].user_supervisor = 1;
+    page_directory[USER_HEAP_PDE_IDX].page_size = 0;
+
+    // kernel page pool for palloc, identity mapped and supervisor only
+    for (i = KHEAP_PDE_START; i < KHEAP_PDE_START + KHEAP_NUM_PDES; i++) {
+        page_directory[i].page_table_base_addr = i << (22 - PAGE_SHIFT); // physical address bits 31:22 for a 4 MB page
+        page_directory[i].page_size = 1;
+        page_directory[i].present = 1;
+    }
+
     // // 1018 seems to be the page where the network card will be on
     page_directory[1018].page_table_base_addr = 0xFE800;
     page_directory[1018].read_write = 1;
@@ -107,3 +122,300 @@ void init_paging(){
     page_directory[31].page_size = 1; 
     page_directory[31].present = 1;
 }
+
+/* set_mmap_table
+ * 
+ * DESCRIPTION: Points the mmap region and heap at the page tables of a process
+ * 
+ * INPUTS: pid: the process that is about to run, -1 for none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: caller has to flush the TLB
+ */
+void set_mmap_table(int32_t pid) {
+    if (pid < 0 || pid >= NUM_MMAP_TABLES) {
+        page_directory[USER_MMAP_PDE_IDX].present = 0;
+        page_directory[USER_HEAP_PDE_IDX].present = 0;
+        return;
+    }
+    page_directory[USER_MMAP_PDE_IDX].page_table_base_addr = ((int)mmap_tables[pid]) >> PAGE_SHIFT;
+    page_directory[USER_MMAP_PDE_IDX].present = 1;
+    page_directory[USER_HEAP_PDE_IDX].page_table_base_addr = ((int)&mmap_tables[pid][NUM_ENTRIES]) >> PAGE_SHIFT;
+    page_directory[USER_HEAP_PDE_IDX].present = 1;
+}
+
+/* clear_mmap_table
+ * 
+ * DESCRIPTION: Removes every mapping of a process, its heap included
+ * 
+ * INPUTS: pid: the process
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: caller has to flush the TLB if pid is running
+ */
+void clear_mmap_table(int32_t pid) {
+    mmap_unmap(pid, 0, MMAP_TABLE_ENTRIES);
+}
+
+/* mmap_find_free
+ * 
+ * DESCRIPTION: Finds the first run of unused pages in the mmap region of
+ *              a process, pages reserved for demand zero count as used
+ * 
+ * INPUTS: pid: the process
+ *         num_pages: length of the run
+ * OUTPUTS: none
+ * RETURN VALUE: index of the first page of the run, -1 if there is none
+ * SIDE EFFECTS: none
+ */
+int32_t mmap_find_free(int32_t pid, uint32_t num_pages) {
+    page_table_entry_t * table;
+    uint32_t first, run;
+
+    if (pid < 0 || pid >= NUM_MMAP_TABLES || num_pages == 0) {
+        return -1;
+    }
+    table = mmap_tables[pid];
+
+    // first fit run of unused pages, the heap is left to sbrk
+    for (first = 0, run = 0; first + run < NUM_ENTRIES && run < num_pages; ) {
+        if (table[first + run].val != 0) {
+            first += run + 1;
+            run = 0;
+        } else {
+            run++;
+        }
+    }
+    return (run < num_pages) ? -1 : first;
+}
+
+/* mmap_map_page
+ * 
+ * DESCRIPTION: Maps a physical page into the mmap region of a process
+ * 
+ * INPUTS: pid: the process
+ *         index: page of the region
+ *         addr: physical address of the page
+ *         writable: 1 to let the process write to it
+ *         avail: PTE_ANON if the page came from palloc and now belongs to the
+ *                process, PTE_SHARED for a page of a shared memory segment
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: caller has to flush the TLB if pid is running
+ */
+void mmap_map_page(int32_t pid, uint32_t index, uint32_t addr, int writable, int avail) {
+    page_table_entry_t * pte = &mmap_tables[pid][index];
+
+    pte->val = 0;
+    pte->page_base_address = addr >> PAGE_SHIFT;
+    pte->user_supervisor = 1;
+    pte->read_write = writable;
+    pte->avail = avail;
+    pte->present = 1;
+}
+
+/* mmap_reserve_zero
+ * 
+ * DESCRIPTION: Reserves a run of writable pages that are allocated and
+ *              zeroed the first time they are touched
+ * 
+ * INPUTS: pid: the process
+ *         first: first page of the run
+ *         num_pages: length of the run
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none, nothing is mapped yet
+ */
+void mmap_reserve_zero(int32_t pid, uint32_t first, uint32_t num_pages) {
+    page_table_entry_t * pte;
+    uint32_t i;
+
+    for (i = first; i < first + num_pages; i++) {
+        pte = &mmap_tables[pid][i];
+        pte->val = 0;
+        pte->user_supervisor = 1;
+        pte->read_write = 1;
+        pte->avail = PTE_ZERO;
+    }
+}
+
+/* mmap_fault
+ * 
+ * DESCRIPTION: Resolves a page fault on a page reserved for demand zero
+ * 
+ * INPUTS: pid: the running process
+ *         addr: the address that faulted
+ * OUTPUTS: none
+ * RETURN VALUE: 0 if the page is mapped now and the access can be retried,
+ *               -1 if the fault is a real one or there is no free page
+ * SIDE EFFECTS: flushes the TLB
+ */
+int32_t mmap_fault(int32_t pid, uint32_t addr) {
+    page_table_entry_t * pte;
+    uint32_t index;
+    void * page;
+
+    if (pid < 0 || pid >= NUM_MMAP_TABLES || addr < USER_MMAP_START ||
+        addr - USER_MMAP_START >= MMAP_TABLE_ENTRIES * PAGE_SIZE) {
+        return -1;
+    }
+    index = (addr - USER_MMAP_START) >> PAGE_SHIFT;
+    pte = &mmap_tables[pid][index];
+    if (pte->present || !(pte->avail & PTE_ZERO)) {
+        return -1;
+    }
+    if ((page = palloc(1)) == NULL) {
+        return -1;
+    }
+    memset(page, 0, PAGE_SIZE);
+    mmap_map_page(pid, index, (uint32_t) page, pte->read_write, PTE_ANON);
+    flush_tlb();
+    return 0;
+}
+
+/* mmap_range_writable
+ * 
+ * DESCRIPTION: Checks that every page of a buffer in the mmap region or
+ *              heap is mapped or reserved, and writable
+ * 
+ * INPUTS: pid: the process
+ *         addr: start of the buffer
+ *         len: size of the buffer
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if the kernel may read and write the buffer, 0 if not
+ * SIDE EFFECTS: none
+ */
+int mmap_range_writable(int32_t pid, uint32_t addr, uint32_t len) {
+    uint32_t i;
+
+    if (pid < 0 || pid >= NUM_MMAP_TABLES || addr < USER_MMAP_START ||
+        addr - USER_MMAP_START > MMAP_TABLE_ENTRIES * PAGE_SIZE ||
+        len > MMAP_TABLE_ENTRIES * PAGE_SIZE - (addr - USER_MMAP_START)) {
+        return 0;
+    }
+    if (len == 0) {
+        return 1;
+    }
+    for (i = (addr - USER_MMAP_START) >> PAGE_SHIFT; i <= (addr - USER_MMAP_START + len - 1) >> PAGE_SHIFT; i++) {
+        if (!mmap_tables[pid][i].read_write || !(mmap_tables[pid][i].present || (mmap_tables[pid][i].avail & PTE_ZERO))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* mmap_range_mapped
+ * 
+ * DESCRIPTION: Checks that every page of a run in the mmap region is mapped
+ *              or reserved
+ * 
+ * INPUTS: pid: the process
+ *         first: first page of the run
+ *         num_pages: length of the run
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if the whole run is in the mmap region and in use, 0 if
+ *               not. The heap window after it never counts.
+ * SIDE EFFECTS: none
+ */
+int mmap_range_mapped(int32_t pid, uint32_t first, uint32_t num_pages) {
+    uint32_t i;
+
+    if (pid < 0 || pid >= NUM_MMAP_TABLES || first > NUM_ENTRIES || num_pages > NUM_ENTRIES - first) {
+        return 0;
+    }
+    for (i = first; i < first + num_pages; i++) {
+        if (!(mmap_tables[pid][i].present || (mmap_tables[pid][i].avail & PTE_ZERO))) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* virt_to_phys
+ * 
+ * DESCRIPTION: Translates an address of the running process through the
+ *              page directory
+ * 
+ * INPUTS: addr: virtual address
+ * OUTPUTS: none
+ * RETURN VALUE: physical address, 0 if it is not mapped
+ * SIDE EFFECTS: none
+ */
+uint32_t virt_to_phys(uint32_t addr) {
+    page_dir_entry_t * pde = &page_directory[addr >> PDE_SHIFT];
+    page_table_entry_t * pte;
+
+    if (!pde->present) {
+        return 0;
+    }
+    if (pde->page_size) { // 4 MB page
+        return (pde->page_table_base_addr << PAGE_SHIFT) + (addr & ((1 << PDE_SHIFT) - 1));
+    }
+    // page tables are in the kernel image, which is identity mapped
+    pte = &((page_table_entry_t *) (pde->page_table_base_addr << PAGE_SHIFT))[(addr >> PAGE_SHIFT) & (NUM_ENTRIES - 1)];
+    if (!pte->present) {
+        return 0;
+    }
+    return (pte->page_base_address << PAGE_SHIFT) + (addr & (PAGE_SIZE - 1));
+}
+
+/* mmap_take_page
+ * 
+ * DESCRIPTION: Unmaps a page the process owns without freeing it, so it can
+ *              be handed to someone else. The address stays reserved for
+ *              demand zero, touching it again gets a fresh zeroed page.
+ * 
+ * INPUTS: pid: the process
+ *         index: page of the region
+ * OUTPUTS: none
+ * RETURN VALUE: physical address of the page, 0 if it is not an owned page
+ * SIDE EFFECTS: caller has to flush the TLB if pid is running
+ */
+uint32_t mmap_take_page(int32_t pid, uint32_t index) {
+    page_table_entry_t * pte;
+    uint32_t addr;
+
+    if (pid < 0 || pid >= NUM_MMAP_TABLES || index >= MMAP_TABLE_ENTRIES) {
+        return 0;
+    }
+    pte = &mmap_tables[pid][index];
+    if (!pte->present || !(pte->avail & PTE_ANON)) {
+        return 0;
+    }
+    addr = pte->page_base_address << PAGE_SHIFT;
+    mmap_reserve_zero(pid, index, 1); // a heap page below brk must not become a hole
+    return addr;
+}
+
+/* mmap_unmap
+ * 
+ * DESCRIPTION: Unmaps a run of pages, the ones the process owns are freed
+ *              and shared memory segments lose a user
+ * 
+ * INPUTS: pid: the process
+ *         first: first page of the run
+ *         num_pages: length of the run
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: caller has to flush the TLB if pid is running
+ */
+void mmap_unmap(int32_t pid, uint32_t first, uint32_t num_pages) {
+    page_table_entry_t * table;
+    uint32_t i;
+
+    if (pid < 0 || pid >= NUM_MMAP_TABLES || first >= MMAP_TABLE_ENTRIES) {
+        return;
+    }
+    if (num_pages > MMAP_TABLE_ENTRIES - first) {
+        num_pages = MMAP_TABLE_ENTRIES - first;
+    }
+    table = mmap_tables[pid];
+    for (i = first; i < first + num_pages; i++) {
+        if (table[i].present && (table[i].avail & PTE_ANON)) {
+            pfree((void *) (table[i].page_base_address << PAGE_SHIFT), 1);
+        } else if (table[i].present && (table[i].avail & PTE_SHARED)) {
+            shm_put_page(table[i].page_base_address << PAGE_SHIFT);
+        }
+        table[i].val = 0;
+    }
+}
@@ -7,17 +7,33 @@
 #define KERNEL_ADDR 0x400
 #define VIDEO_ADDR 0xb8
 #define VIDEO_IDX 0xb8
+#define VIDEO_NUM_PAGES 8 // all 32 KB of text mode video memory, terminals scroll through it
 
-#define TERM1_VIDEO_ADDR 0xb9
-#define TERM1_VIDEO_IDX 0xb9
+#define USER_VIDEO_PDE_IDX 33
 
-#define TERM2_VIDEO_ADDR 0xba
-#define TERM2_VIDEO_IDX 0xba
+// read-only file mappings from mmap start at 136 MB, right after vidmap
+#define USER_MMAP_PDE_IDX 34
+#define USER_MMAP_START 0x8800000
+#define NUM_MMAP_TABLES 22 // one per pid, MAX_NEXT_PID in syscall.h
+#define PAGE_SHIFT 12
+#define PAGE_SIZE (1 << PAGE_SHIFT)
+#define PDE_SHIFT 22 // a page directory entry covers 4 MB
 
-#define TERM3_VIDEO_ADDR 0xbb
-#define TERM3_VIDEO_IDX 0xbb
+// the sbrk heap is the next 4 MB, its page table follows the mmap one so
+// a page of either is found by its offset from USER_MMAP_START
+#define USER_HEAP_PDE_IDX 35
+#define USER_HEAP_START 0x8C00000
+#define MMAP_TABLE_ENTRIES (2 * NUM_ENTRIES) // mmap region and heap of one process
 
-#define USER_VIDEO_PDE_IDX 33
+// avail bits of an mmap page table entry
+#define PTE_ANON 1 // the page came from palloc and is freed when it is unmapped
+#define PTE_ZERO 2 // not present yet, a zeroed page is allocated on the first access
+#define PTE_SHARED 4 // page of a shared memory segment, see shm.h
+
+// 96 MB to 124 MB is the kernel page pool, see palloc.h. PDE 31 above it
+// maps the NIC memory
+#define KHEAP_PDE_START 24
+#define KHEAP_NUM_PDES 7
 
 /* This struct has the info for a page directory entry */
 typedef struct page_dir_entry {
@@ -65,6 +81,8 @@ extern page_dir_entry_t page_directory[1024] __attribute__((aligned(4096)));
 extern page_table_entry_t page_table[1024] __attribute__((aligned(4096)));
 /* Page Table for video mapping*/
 extern page_table_entry_t video_map_table[1024] __attribute__((aligned(4096)));
+/* Page Tables for each process' mmap region */
+extern page_table_entry_t mmap_tables[NUM_MMAP_TABLES][MMAP_TABLE_ENTRIES] __attribute__((aligned(4096)));
 
 
 
@@ -93,6 +111,152 @@ extern void enable_paging();
  */
 void init_paging();
 
+/* set_mmap_table
+ * 
+ * DESCRIPTION: Points the mmap region at the page table of a process
+ * 
+ * INPUTS: pid: the process that is about to run, -1 for none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: caller has to flush the TLB
+ */
+void set_mmap_table(int32_t pid);
+
+/* clear_mmap_table
+ * 
+ * DESCRIPTION: Removes every mapping of a process
+ * 
+ * INPUTS: pid: the process
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: caller has to flush the TLB if pid is running
+ */
+void clear_mmap_table(int32_t pid);
+
+/* mmap_find_free
+ * 
+ * DESCRIPTION: Finds the first run of unused pages in the mmap region of
+ *              a process, pages reserved for demand zero count as used
+ * 
+ * INPUTS: pid: the process
+ *         num_pages: length of the run
+ * OUTPUTS: none
+ * RETURN VALUE: index of the first page of the run, -1 if there is none
+ * SIDE EFFECTS: none
+ */
+int32_t mmap_find_free(int32_t pid, uint32_t num_pages);
+
+/* mmap_map_page
+ * 
+ * DESCRIPTION: Maps a physical page into the mmap region of a process
+ * 
+ * INPUTS: pid: the process
+ *         index: page of the region
+ *         addr: physical address of the page
+ *         writable: 1 to let the process write to it
+ *         avail: PTE_ANON if the page came from palloc and now belongs to the
+ *                process, PTE_SHARED for a page of a shared memory segment
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: caller has to flush the TLB if pid is running
+ */
+void mmap_map_page(int32_t pid, uint32_t index, uint32_t addr, int writable, int avail);
+
+/* mmap_reserve_zero
+ * 
+ * DESCRIPTION: Reserves a run of writable pages that are allocated and
+ *              zeroed the first time they are touched
+ * 
+ * INPUTS: pid: the process
+ *         first: first page of the run
+ *         num_pages: length of the run
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none, nothing is mapped yet
+ */
+void mmap_reserve_zero(int32_t pid, uint32_t first, uint32_t num_pages);
+
+/* mmap_fault
+ * 
+ * DESCRIPTION: Resolves a page fault on a page reserved for demand zero
+ * 
+ * INPUTS: pid: the running process
+ *         addr: the address that faulted
+ * OUTPUTS: none
+ * RETURN VALUE: 0 if the page is mapped now and the access can be retried,
+ *               -1 if the fault is a real one or there is no free page
+ * SIDE EFFECTS: flushes the TLB
+ */
+int32_t mmap_fault(int32_t pid, uint32_t addr);
+
+/* mmap_range_writable
+ * 
+ * DESCRIPTION: Checks that every page of a buffer in the mmap region or
+ *              heap is mapped or reserved, and writable
+ * 
+ * INPUTS: pid: the process
+ *         addr: start of the buffer
+ *         len: size of the buffer
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if the kernel may read and write the buffer, 0 if not
+ * SIDE EFFECTS: none
+ */
+int mmap_range_writable(int32_t pid, uint32_t addr, uint32_t len);
+
+/* mmap_range_mapped
+ * 
+ * DESCRIPTION: Checks that every page of a run in the mmap region is mapped
+ *              or reserved
+ * 
+ * INPUTS: pid: the process
+ *         first: first page of the run
+ *         num_pages: length of the run
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if the whole run is in the mmap region and in use, 0 if
+ *               not. The heap window after it never counts.
+ * SIDE EFFECTS: none
+ */
+int mmap_range_mapped(int32_t pid, uint32_t first, uint32_t num_pages);
+
+/* virt_to_phys
+ * 
+ * DESCRIPTION: Translates an address of the running process through the
+ *              page directory
+ * 
+ * INPUTS: addr: virtual address
+ * OUTPUTS: none
+ * RETURN VALUE: physical address, 0 if it is not mapped
+ * SIDE EFFECTS: none
+ */
+uint32_t virt_to_phys(uint32_t addr);
+
+/* mmap_take_page
+ * 
+ * DESCRIPTION: Unmaps a page the process owns without freeing it, so it can
+ *              be handed to someone else
+ * 
+ * INPUTS: pid: the process
+ *         index: page of the region
+ * OUTPUTS: none
+ * RETURN VALUE: physical address of the page, 0 if it is not an owned page
+ * SIDE EFFECTS: caller has to flush the TLB if pid is running
+ */
+uint32_t mmap_take_page(int32_t pid, uint32_t index);
+
+/* mmap_unmap
+ * 
+ * DESCRIPTION: Unmaps a run of pages, the ones the process owns are freed
+ *              and shared memory segments lose a user
+ * 
+ * INPUTS: pid: the process
+ *         first: first page of the run
+ *         num_pages: length of the run
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: caller has to flush the TLB if pid is running
+ */
+void mmap_unmap(int32_t pid, uint32_t first, uint32_t num_pages);
+
 /* flush_tlb
  * 
  * DESCRIPTION: flushes the TLB
@@ -0,0 +1,119 @@
+#include "palloc.h"
+#include "kstat.h"
+#include "types.h"
+#include "lib.h"
+
+#define BITS_PER_WORD 32
+#define WORD_SHIFT 5
+#define FULL_WORD 0xFFFFFFFF
+
+/* one bit per page, set while the page is allocated */
+static uint32_t page_bitmap[PALLOC_NUM_PAGES / BITS_PER_WORD];
+/* no page below this index is free, so searches can start here */
+static uint32_t first_free = 0;
+
+/* page_used
+ *
+ * DESCRIPTION: Checks the bitmap bit of a page
+ *
+ * INPUTS: page: index of the page
+ * OUTPUTS: none
+ * RETURN VALUE: nonzero if the page is allocated
+ * SIDE EFFECTS: none
+ */
+static uint32_t page_used(uint32_t page) {
+    return page_bitmap[page >> WORD_SHIFT] & (1 << (page & (BITS_PER_WORD - 1)));
+}
+
+/* palloc_init
+ *
+ * DESCRIPTION: Marks every page free
+ *
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void palloc_init() {
+    memset(page_bitmap, 0, sizeof(page_bitmap));
+    first_free = 0;
+    kstat.pages_used = 0;
+}
+
+/* palloc
+ *
+ * DESCRIPTION: Allocates physically contiguous pages, first fit
+ *
+ * INPUTS: num_pages: number of 4KB pages
+ * OUTPUTS: none
+ * RETURN VALUE: address of the first page, NULL if there is no run of
+ *               num_pages free pages. The memory is not cleared.
+ * SIDE EFFECTS: none
+ */
+void * palloc(uint32_t num_pages) {
+    uint32_t flags;
+    uint32_t first, run, i;
+
+    if (num_pages == 0 || num_pages > PALLOC_NUM_PAGES) {
+        return NULL;
+    }
+
+    cli_and_save(flags);
+    first = first_free;
+    run = 0;
+    while (run < num_pages && first + run < PALLOC_NUM_PAGES) {
+        if (run == 0 && page_bitmap[first >> WORD_SHIFT] == FULL_WORD) {
+            first = (first | (BITS_PER_WORD - 1)) + 1; // skip whole words that are in use
+        } else if (page_used(first + run)) {
+            first += run + 1;
+            run = 0;
+        } else {
+            run++;
+        }
+    }
+    if (run < num_pages) {
+        restore_flags(flags);
+        return NULL;
+    }
+
+    for (i = first; i < first + num_pages; i++) {
+        page_bitmap[i >> WORD_SHIFT] |= 1 << (i & (BITS_PER_WORD - 1));
+    }
+    if (first == first_free) {
+        first_free += num_pages;
+    }
+    kstat.pages_used += num_pages;
+    restore_flags(flags);
+
+    return (void *) (PALLOC_START + first * PALLOC_PAGE_SIZE);
+}
+
+/* pfree
+ *
+ * DESCRIPTION: Returns pages from palloc
+ *
+ * INPUTS: addr: address palloc returned
+ *         num_pages: the number of pages that were allocated
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void pfree(void * addr, uint32_t num_pages) {
+    uint32_t flags;
+    uint32_t first = ((uint32_t) addr - PALLOC_START) / PALLOC_PAGE_SIZE;
+    uint32_t i;
+
+    if (addr == NULL || (uint32_t) addr < PALLOC_START || first + num_pages > PALLOC_NUM_PAGES) {
+        return;
+    }
+
+    cli_and_save(flags);
+    for (i = first; i < first + num_pages; i++) {
+        page_bitmap[i >> WORD_SHIFT] &= ~(1 << (i & (BITS_PER_WORD - 1)));
+    }
+    if (first < first_free) {
+        first_free = first;
+    }
+    kstat.pages_used -= num_pages;
+    restore_flags(flags);
+}
@@ -0,0 +1,21 @@
+#include "types.h"
+
+#ifndef PALLOC_H
+#define PALLOC_H
+
+/* physical memory from 96 MB to 124 MB is handed out in 4KB pages, below
+ * it are the 4 MB program pages of every pid. it is identity mapped for the
+ * kernel only (see init_paging), so a page's address is usable as a pointer
+ * right away. The 4 MB page above it is where networking.c puts the NIC
+ * descriptor rings and buffers, the card DMAs into it */
+#define PALLOC_START 0x6000000
+#define NIC_MEM_START 0x7C00000
+#define PALLOC_END NIC_MEM_START
+#define PALLOC_PAGE_SIZE 4096
+#define PALLOC_NUM_PAGES ((PALLOC_END - PALLOC_START) / PALLOC_PAGE_SIZE)
+
+void palloc_init();
+void * palloc(uint32_t num_pages);
+void pfree(void * addr, uint32_t num_pages);
+
+#endif // PALLOC_H
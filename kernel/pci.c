@@ -3,6 +3,100 @@
 #include "lib.h"
 #include "outl.h"
 
+static uint32_t pci_conf_address(uint8_t bus, uint8_t device, uint8_t func, uint8_t offset);
+
+uint32_t read_pci_conf(uint8_t bus, uint8_t device, uint8_t func, uint8_t offset) {
+    // Write out the address
+    outl_asm(pci_conf_address(bus, device, func, offset), 0xCF8);
+    // Read in the data
+    // (offset & 2) * 8) = 0 will choose the first word of the 32-bit register
+    return inl(0xCFC);
+}
+
+/* write_pci_conf
+ *
+ * DESCRIPTION: Writes a dword of a device's configuration space
+ *
+ * INPUTS: bus, device, func: the function to configure
+ *         offset: dword aligned register offset
+ *         value: value to write
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: changes the device configuration
+ */
+void write_pci_conf(uint8_t bus, uint8_t device, uint8_t func, uint8_t offset, uint32_t value) {
+    outl_asm(pci_conf_address(bus, device, func, offset), 0xCF8);
+    outl_asm(value, 0xCFC);
+}
+
+/* pci_find
+ *
+ * DESCRIPTION: Scans bus 0 for the first function whose configuration dword
+ *              at offset matches value under mask. QEMU puts every device on
+ *              bus 0.
+ *
+ * INPUTS: offset: configuration register to compare
+ *         mask: bits of the register to compare
+ *         value: expected value of those bits
+ *         device: filled with the device number
+ *         func: filled with the function number
+ * OUTPUTS: none
+ * RETURN VALUE: 0 if a function was found, -1 otherwise
+ * SIDE EFFECTS: none
+ */
+static int32_t pci_find(uint8_t offset, uint32_t mask, uint32_t value, uint8_t * device, uint8_t * func) {
+    uint32_t dev, fn, num_funcs;
+    for (dev = 0; dev < PCI_MAX_DEVICES; dev++) {
+        if ((read_pci_conf(0, dev, 0, PCI_VENDOR_ID) & 0xFFFF) == PCI_NO_VENDOR) {
+            continue;
+        }
+        num_funcs = (read_pci_conf(0, dev, 0, PCI_HEADER_TYPE) & PCI_MULTI_FUNCTION) ? PCI_MAX_FUNCS : 1;
+        for (fn = 0; fn < num_funcs; fn++) {
+            if ((read_pci_conf(0, dev, fn, PCI_VENDOR_ID) & 0xFFFF) == PCI_NO_VENDOR) {
+                continue;
+            }
+            if ((read_pci_conf(0, dev, fn, offset) & mask) == value) {
+                *device = dev;
+                *func = fn;
+                return 0;
+            }
+        }
+    }
+    return -1;
+}
+
+/* pci_find_device
+ *
+ * DESCRIPTION: Finds the first function with a class code
+ *
+ * INPUTS: class_code: PCI base class
+ *         subclass: PCI subclass
+ *         device: filled with the device number
+ *         func: filled with the function number
+ * OUTPUTS: none
+ * RETURN VALUE: 0 if a function was found, -1 otherwise
+ * SIDE EFFECTS: none
+ */
+int32_t pci_find_device(uint8_t class_code, uint8_t subclass, uint8_t * device, uint8_t * func) {
+    return pci_find(PCI_CLASS, 0xFFFF0000, ((uint32_t) class_code << 24) | ((uint32_t) subclass << 16), device, func);
+}
+
+/* pci_find_id
+ *
+ * DESCRIPTION: Finds the first function with a vendor and device id
+ *
+ * INPUTS: vendor_id: PCI vendor id
+ *         device_id: PCI device id
+ *         device: filled with the device number
+ *         func: filled with the function number
+ * OUTPUTS: none
+ * RETURN VALUE: 0 if a function was found, -1 otherwise
+ * SIDE EFFECTS: none
+ */
+int32_t pci_find_id(uint16_t vendor_id, uint16_t device_id, uint8_t * device, uint8_t * func) {
+    return pci_find(PCI_VENDOR_ID, 0xFFFFFFFF, ((uint32_t) device_id << 16) | vendor_id, device, func);
+}
+
 /*
 CONFIG ADDRESS REGISTER: 32 bit total
 |  31  |  30-24 |  23-16   |    15-11    |      10-8     |     7 - 0     |
@@ -10,7 +104,7 @@ CONFIG ADDRESS REGISTER: 32 bit total
 Among them, register offset is word aligned so the last two bits are always 0
 And enable bit is always 1
 */
-uint32_t read_pci_conf(uint8_t bus, uint8_t device, uint8_t func, uint8_t offset) {
+static uint32_t pci_conf_address(uint8_t bus, uint8_t device, uint8_t func, uint8_t offset) {
     // params are shorts because they are 8 bits in the config register
     // calculating the config reg requires us to extend them to long and shift
     uint32_t bus_bits = ((uint32_t) bus) << 16;
@@ -19,13 +113,6 @@ uint32_t read_pci_conf(uint8_t bus, uint8_t device, uint8_t func, uint8_t offset
     uint32_t enable_bits = 0x80000000;
     // ands with 0b11111100 to enforce the word alignment
     uint32_t offset_bits = ((uint32_t) offset) & 0xFC;
-    uint32_t ret;
 
-    uint32_t address = enable_bits + bus_bits + device_bits + func_bits + offset_bits;
-    // Write out the address
-    outl_asm(address, 0xCF8);
-    // Read in the data
-    // (offset & 2) * 8) = 0 will choose the first word of the 32-bit register
-    ret = inl(0xCFC);
-    return ret;
+    return enable_bits + bus_bits + device_bits + func_bits + offset_bits;
 }
@@ -2,7 +2,29 @@
 #define PCI_H
 #include "types.h"
 
+#define PCI_MAX_DEVICES 32
+#define PCI_MAX_FUNCS 8
+
+/* configuration space offsets */
+#define PCI_VENDOR_ID 0x00
+#define PCI_COMMAND 0x04
+#define PCI_CLASS 0x08
+#define PCI_HEADER_TYPE 0x0C
+#define PCI_BAR0 0x10
+#define PCI_BAR4 0x20
+#define PCI_INTERRUPT_LINE 0x3C
+
+#define PCI_NO_VENDOR 0xFFFF
+#define PCI_MULTI_FUNCTION 0x800000 // header type bit 7, in the dword at 0x0C
+#define PCI_COMMAND_IO 0x1
+#define PCI_COMMAND_BUS_MASTER 0x4
+#define PCI_BAR_IO_SPACE 0x1
+#define PCI_BAR_IO_MASK 0xFFFFFFFC
+
 uint32_t read_pci_conf(uint8_t bus, uint8_t device, uint8_t func, uint8_t offset);
+void write_pci_conf(uint8_t bus, uint8_t device, uint8_t func, uint8_t offset, uint32_t value);
+int32_t pci_find_device(uint8_t class_code, uint8_t subclass, uint8_t * device, uint8_t * func);
+int32_t pci_find_id(uint16_t vendor_id, uint16_t device_id, uint8_t * device, uint8_t * func);
 
 #endif
 
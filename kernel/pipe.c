@@ -0,0 +1,555 @@
+#include "pipe.h"
+#include "file_driver.h"
+#include "process.h"
+#include "palloc.h"
+#include "paging.h"
+#include "types.h"
+#include "lib.h"
+
+#define SLOT(p, i) (&(p)->slots[(i) & (PIPE_SLOTS - 1)])
+
+static pipe_t pipes[MAX_PIPES];
+
+file_ops_t pipe_read_ops = {
+    .write_func = NULL,
+    .read_func = pipe_read,
+    .close_func = pipe_read_close,
+    .open_func = NULL,
+    .ioctl_func = pipe_read_ioctl,
+    .dup_func = pipe_read_dup,
+    .mmap_func = pipe_read_mmap
+};
+file_ops_t pipe_write_ops = {
+    .write_func = pipe_write,
+    .read_func = NULL,
+    .close_func = pipe_write_close,
+    .open_func = NULL,
+    .ioctl_func = pipe_write_ioctl,
+    .dup_func = pipe_write_dup,
+    .mmap_func = pipe_write_mmap
+};
+
+/* get_pipe
+ *
+ * DESCRIPTION: Finds the pipe an open end refers to
+ *
+ * INPUTS: fd: pointer to the file object, its inode is the pipe number
+ * OUTPUTS: none
+ * RETURN VALUE: the pipe, NULL if the number is out of range or the pipe
+ *               is free
+ * SIDE EFFECTS: none
+ */
+static pipe_t * get_pipe(int32_t fd) {
+    int32_t n = ((file_object_t *) fd)->inode;
+    if (n < 0 || n >= MAX_PIPES || !pipes[n].in_use) {
+        return NULL;
+    }
+    return &pipes[n];
+}
+
+/* pipe_release
+ *
+ * DESCRIPTION: Gives the pages still in a pipe back to the page pool once
+ *              both ends are closed everywhere
+ *
+ * INPUTS: p: the pipe
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: the pipe can be handed out again
+ */
+static void pipe_release(pipe_t * p) {
+    if (p->readers > 0 || p->writers > 0) {
+        return;
+    }
+    for (; p->head != p->tail; p->head++) {
+        pfree(SLOT(p, p->head)->page, 1);
+    }
+    p->in_use = 0;
+}
+
+/* pipe_gift
+ *
+ * DESCRIPTION: Moves the page at buf out of the writer's mmap region into
+ *              the pipe, if it is a whole page the writer owns. The writer
+ *              gets a zeroed page there the next time it touches it.
+ *
+ * INPUTS: p: the pipe
+ *         buf: page aligned user address
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if the page moved, 0 if it has to be copied
+ * SIDE EFFECTS: interrupts have to be off, caller flushes the TLB
+ */
+static int pipe_gift(pipe_t * p, const uint8_t * buf) {
+    pcb_t * pcb = get_current_process();
+    pipe_slot_t * slot;
+    uint32_t addr;
+
+    if (pcb == NULL || p->tail - p->head == PIPE_SLOTS || (uint32_t) buf < USER_MMAP_START) {
+        return 0;
+    }
+    if (0 == (addr = mmap_take_page(pcb->pid, ((uint32_t) buf - USER_MMAP_START) >> PAGE_SHIFT))) {
+        return 0;
+    }
+    slot = SLOT(p, p->tail++);
+    slot->page = (uint8_t *) addr;
+    slot->start = 0;
+    slot->end = PAGE_SIZE;
+    return 1;
+}
+
+/* pipe_copy_in
+ *
+ * DESCRIPTION: Copies bytes to the end of the pipe, filling the last page
+ *              before taking a new one
+ *
+ * INPUTS: p: the pipe
+ *         buf: bytes to copy
+ *         n: number of bytes
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes copied, less if the pipe filled up
+ * SIDE EFFECTS: interrupts have to be off
+ */
+static uint32_t pipe_copy_in(pipe_t * p, const uint8_t * buf, uint32_t n) {
+    pipe_slot_t * slot;
+    uint32_t done = 0;
+    uint32_t chunk;
+    uint8_t * page;
+
+    while (done < n) {
+        slot = SLOT(p, p->tail - 1);
+        if (p->head == p->tail || slot->end == PAGE_SIZE) {
+            if (p->tail - p->head == PIPE_SLOTS || (page = palloc(1)) == NULL) {
+                break;
+            }
+            slot = SLOT(p, p->tail++);
+            slot->page = page;
+            slot->start = 0;
+            slot->end = 0;
+        }
+        chunk = PAGE_SIZE - slot->end;
+        if (chunk > n - done) {
+            chunk = n - done;
+        }
+        memcpy(slot->page + slot->end, buf + done, chunk);
+        slot->end += chunk;
+        done += chunk;
+    }
+    return done;
+}
+
+/* pipe_copy_out
+ *
+ * DESCRIPTION: Copies bytes from the front of the pipe, pages that were
+ *              read to the end go back to the page pool
+ *
+ * INPUTS: p: the pipe
+ *         buf: where to copy to
+ *         n: most bytes to copy
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes copied
+ * SIDE EFFECTS: interrupts have to be off
+ */
+static uint32_t pipe_copy_out(pipe_t * p, uint8_t * buf, uint32_t n) {
+    pipe_slot_t * slot;
+    uint32_t done = 0;
+    uint32_t chunk;
+
+    while (done < n && p->head != p->tail) {
+        slot = SLOT(p, p->head);
+        chunk = slot->end - slot->start;
+        if (chunk > n - done) {
+            chunk = n - done;
+        }
+        memcpy(buf + done, slot->page + slot->start, chunk);
+        slot->start += chunk;
+        done += chunk;
+        if (slot->start == slot->end) {
+            pfree(slot->page, 1);
+            p->head++;
+        }
+    }
+    return done;
+}
+
+/* pipe_create
+ *
+ * DESCRIPTION: Allocates a free pipe, with one reader and one writer for
+ *              the two fds sys_pipe opens. Pages are taken as data comes in.
+ *
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: number of the pipe, -1 if all pipes are in use
+ * SIDE EFFECTS: none
+ */
+int32_t pipe_create() {
+    uint32_t flags;
+    int32_t n;
+
+    cli_and_save(flags);
+    for (n = 0; n < MAX_PIPES; n++) {
+        if (!pipes[n].in_use) {
+            break;
+        }
+    }
+    if (n == MAX_PIPES) {
+        restore_flags(flags);
+        return -1;
+    }
+    pipes[n].in_use = 1;
+    pipes[n].head = 0;
+    pipes[n].tail = 0;
+    pipes[n].gift = 0;
+    pipes[n].readers = 1;
+    pipes[n].writers = 1;
+    restore_flags(flags);
+    return n;
+}
+
+/* pipe_read
+ *
+ * DESCRIPTION: Reads what is in the pipe with one copy per page. Waits
+ *              while it is empty and a process that can run still has the
+ *              write end.
+ *
+ * INPUTS: fd: pointer to the file object of the read end
+ *         buf: where to copy to
+ *         nbytes: most bytes to read
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes read, 0 at end of file, -1 for invalid
+ *               arguments
+ * SIDE EFFECTS: none
+ */
+int32_t pipe_read(int32_t fd, void * buf, int32_t nbytes) {
+    pipe_t * p = get_pipe(fd);
+    uint32_t flags;
+    int32_t n;
+
+    if (p == NULL || buf == NULL || nbytes < 0) {
+        return -1;
+    }
+    while (1) {
+        cli_and_save(flags);
+        if (p->head != p->tail || p->writers == 0 ||
+            !file_users_running(&pipe_write_ops, p - pipes)) {
+            break;
+        }
+        restore_flags(flags);
+        process_yield();
+    }
+    n = pipe_copy_out(p, buf, nbytes);
+    restore_flags(flags);
+    return n;
+}
+
+/* pipe_write
+ *
+ * DESCRIPTION: Writes into the pipe with one copy per page. In gift mode
+ *              whole pages the writer owns are moved instead of copied and
+ *              are gone from the writer afterwards. Waits for room while a
+ *              process that can run has the read end, without one the rest
+ *              does not fit and is not written.
+ *
+ * INPUTS: fd: pointer to the file object of the write end
+ *         buf: bytes to write
+ *         nbytes: number of bytes to write
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes written, -1 if the read end is closed or
+ *               the arguments are invalid
+ * SIDE EFFECTS: none
+ */
+int32_t pipe_write(int32_t fd, const void * buf, int32_t nbytes) {
+    pipe_t * p = get_pipe(fd);
+    const uint8_t * bytes = buf;
+    uint32_t flags, chunk, copied;
+    int32_t n = 0;
+    int gifted = 0;
+
+    if (p == NULL || buf == NULL || nbytes < 0 || p->readers == 0) {
+        return -1;
+    }
+    while (1) {
+        cli_and_save(flags);
+        while (n < nbytes) {
+            if (p->gift && !((uint32_t) (bytes + n) & (PAGE_SIZE - 1)) && nbytes - n >= PAGE_SIZE &&
+                pipe_gift(p, bytes + n)) {
+                n += PAGE_SIZE;
+                gifted = 1;
+                continue;
+            }
+            // in gift mode copy up to the next page so the one after can still move
+            chunk = p->gift ? PAGE_SIZE - ((uint32_t) (bytes + n) & (PAGE_SIZE - 1)) : nbytes - n;
+            if (chunk > nbytes - n) {
+                chunk = nbytes - n;
+            }
+            copied = pipe_copy_in(p, bytes + n, chunk);
+            n += copied;
+            if (copied < chunk) { // full
+                break;
+            }
+        }
+        if (n == nbytes || p->readers == 0 || !file_users_running(&pipe_read_ops, p - pipes)) {
+            break;
+        }
+        restore_flags(flags);
+        process_yield();
+    }
+    if (gifted) {
+        flush_tlb();
+    }
+    restore_flags(flags);
+    return n;
+}
+
+/* pipe_read_dup
+ *
+ * DESCRIPTION: Counts another open read end, for a child that gets it as
+ *              stdin
+ *
+ * INPUTS: fd: pointer to the file object of the read end
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 for an invalid pipe
+ * SIDE EFFECTS: none
+ */
+int32_t pipe_read_dup(int32_t fd) {
+    pipe_t * p = get_pipe(fd);
+    uint32_t flags;
+
+    if (p == NULL) {
+        return -1;
+    }
+    cli_and_save(flags);
+    p->readers++;
+    restore_flags(flags);
+    return 0;
+}
+
+/* pipe_write_dup
+ *
+ * DESCRIPTION: Counts another open write end, for a child that gets it as
+ *              stdout
+ *
+ * INPUTS: fd: pointer to the file object of the write end
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 for an invalid pipe
+ * SIDE EFFECTS: none
+ */
+int32_t pipe_write_dup(int32_t fd) {
+    pipe_t * p = get_pipe(fd);
+    uint32_t flags;
+
+    if (p == NULL) {
+        return -1;
+    }
+    cli_and_save(flags);
+    p->writers++;
+    restore_flags(flags);
+    return 0;
+}
+
+/* pipe_read_close
+ *
+ * DESCRIPTION: Closes a read end, writes fail once the last one is gone
+ *
+ * INPUTS: fd: pointer to the file object of the read end
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 for an invalid pipe
+ * SIDE EFFECTS: frees the pipe if no end is open anymore
+ */
+int32_t pipe_read_close(int32_t fd) {
+    pipe_t * p = get_pipe(fd);
+    uint32_t flags;
+
+    if (p == NULL) {
+        return -1;
+    }
+    cli_and_save(flags);
+    p->readers--;
+    pipe_release(p);
+    restore_flags(flags);
+    return 0;
+}
+
+/* pipe_write_close
+ *
+ * DESCRIPTION: Closes a write end, reads see end of file once the last one
+ *              is gone and the pipe is empty
+ *
+ * INPUTS: fd: pointer to the file object of the write end
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 for an invalid pipe
+ * SIDE EFFECTS: frees the pipe if no end is open anymore
+ */
+int32_t pipe_write_close(int32_t fd) {
+    pipe_t * p = get_pipe(fd);
+    uint32_t flags;
+
+    if (p == NULL) {
+        return -1;
+    }
+    cli_and_save(flags);
+    p->writers--;
+    pipe_release(p);
+    restore_flags(flags);
+    return 0;
+}
+
+/* pipe_read_ioctl
+ *
+ * DESCRIPTION: PIPE_ATTACH makes the read end stdin of the next program the
+ *              calling process executes
+ *
+ * INPUTS: fd: pointer to the file object of the read end
+ *         request: PIPE_ATTACH
+ *         arg: ignored
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 for an unknown request
+ * SIDE EFFECTS: none
+ */
+int32_t pipe_read_ioctl(int32_t fd, int32_t request, int32_t arg) {
+    pipe_t * p = get_pipe(fd);
+
+    if (p == NULL || request != PIPE_ATTACH) {
+        return -1;
+    }
+    return set_child_stdio(FD_STDIN, FILE_TYPE_PIPE, &pipe_read_ops, p - pipes);
+}
+
+/* pipe_write_ioctl
+ *
+ * DESCRIPTION: PIPE_ATTACH makes the write end stdout of the next program
+ *              the calling process executes. PIPE_GIFT with arg 1 lets
+ *              writes move whole pages the writer owns into the pipe,
+ *              with 0 they are copied again. A moved page does not come
+ *              back: after the write its address reads as zeros, the
+ *              writer can fill it again for the next write.
+ *
+ * INPUTS: fd: pointer to the file object of the write end
+ *         request: PIPE_ATTACH or PIPE_GIFT
+ *         arg: ignored for PIPE_ATTACH, 0 or 1 for PIPE_GIFT
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 for an unknown request
+ * SIDE EFFECTS: none
+ */
+int32_t pipe_write_ioctl(int32_t fd, int32_t request, int32_t arg) {
+    pipe_t * p = get_pipe(fd);
+
+    if (p == NULL) {
+        return -1;
+    }
+    switch (request) {
+        case PIPE_ATTACH:
+            return set_child_stdio(FD_STDOUT, FILE_TYPE_PIPE, &pipe_write_ops, p - pipes);
+        case PIPE_GIFT:
+            p->gift = (arg != 0);
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+/* pipe_read_mmap
+ *
+ * DESCRIPTION: Moves pages from the front of the pipe into the reader's
+ *              mmap region instead of copying them. Takes whole pages up to
+ *              and including the first one that is not full, waits like
+ *              pipe_read if the pipe is empty.
+ *
+ * INPUTS: fd: pointer to the file object of the read end
+ *         start: set to the user address of the first byte
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes mapped, munmap gives the pages back, 0 at
+ *               end of file, -1 if the first page was read in part or the
+ *               region is full
+ * SIDE EFFECTS: the pages belong to the reader now
+ */
+int32_t pipe_read_mmap(int32_t fd, uint8_t ** start) {
+    pcb_t * pcb = get_current_process();
+    pipe_t * p = get_pipe(fd);
+    pipe_slot_t * slot;
+    uint32_t flags, num_pages, i;
+    int32_t first;
+    int32_t length = 0;
+
+    if (p == NULL || pcb == NULL) {
+        return -1;
+    }
+    while (1) {
+        cli_and_save(flags);
+        if (p->head != p->tail || p->writers == 0 ||
+            !file_users_running(&pipe_write_ops, p - pipes)) {
+            break;
+        }
+        restore_flags(flags);
+        process_yield();
+    }
+    if (p->head == p->tail) {
+        restore_flags(flags);
+        return 0;
+    }
+    if (SLOT(p, p->head)->start != 0) {
+        restore_flags(flags);
+        return -1;
+    }
+    for (num_pages = 1; p->head + num_pages != p->tail; num_pages++) {
+        if (SLOT(p, p->head + num_pages - 1)->end != PAGE_SIZE || SLOT(p, p->head + num_pages)->start != 0) {
+            break;
+        }
+    }
+    if (-1 == (first = mmap_find_free(pcb->pid, num_pages))) {
+        restore_flags(flags);
+        return -1;
+    }
+    for (i = 0; i < num_pages; i++) {
+        slot = SLOT(p, p->head++);
+        memset(slot->page + slot->end, 0, PAGE_SIZE - slot->end); // nothing old shows through
+        mmap_map_page(pcb->pid, first + i, (uint32_t) slot->page, 1, PTE_ANON);
+        length += slot->end;
+    }
+    set_mmap_table(pcb->pid);
+    flush_tlb();
+    restore_flags(flags);
+
+    *start = (uint8_t *) (USER_MMAP_START + (first << PAGE_SHIFT));
+    return length;
+}
+
+/* pipe_write_mmap
+ *
+ * DESCRIPTION: Maps fresh zeroed pages into the writer's mmap region for
+ *              it to fill and give to the pipe with PIPE_GIFT, as many as
+ *              the pipe holds
+ *
+ * INPUTS: fd: pointer to the file object of the write end
+ *         start: set to the user address of the first page
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes mapped, -1 if the region is full or there
+ *               are no free pages
+ * SIDE EFFECTS: the pages belong to the writer, munmap frees them
+ */
+int32_t pipe_write_mmap(int32_t fd, uint8_t ** start) {
+    pcb_t * pcb = get_current_process();
+    pipe_t * p = get_pipe(fd);
+    uint8_t * page;
+    int32_t first;
+    uint32_t i;
+
+    if (p == NULL || pcb == NULL) {
+        return -1;
+    }
+    if (-1 == (first = mmap_find_free(pcb->pid, PIPE_SLOTS))) {
+        return -1;
+    }
+    for (i = 0; i < PIPE_SLOTS; i++) {
+        if ((page = palloc(1)) == NULL) {
+            mmap_unmap(pcb->pid, first, i);
+            return -1;
+        }
+        memset(page, 0, PAGE_SIZE);
+        mmap_map_page(pcb->pid, first + i, (uint32_t) page, 1, PTE_ANON);
+    }
+    set_mmap_table(pcb->pid);
+    flush_tlb();
+
+    *start = (uint8_t *) (USER_MMAP_START + (first << PAGE_SHIFT));
+    return PIPE_BUF_SIZE;
+}
@@ -0,0 +1,57 @@
+#include "types.h"
+#include "syscall.h"
+#include "palloc.h"
+
+#ifndef PIPE_H
+#define PIPE_H
+
+#define MAX_PIPES 16
+#define PIPE_SLOTS 16 // pages a pipe holds, a power of two
+#define PIPE_BUF_PAGES PIPE_SLOTS
+#define PIPE_BUF_SIZE (PIPE_SLOTS * PALLOC_PAGE_SIZE)
+
+/* ioctl requests on either end of a pipe */
+#define PIPE_ATTACH 0 // the next program the process executes gets the read end as stdin or the write end as stdout
+#define PIPE_GIFT 1 // write end, arg 1: whole pages a write passes from the mmap region move into the pipe, 0: copy them
+
+/* a pipe is a queue of pages. Written bytes are copied into the last page
+ * with room or a new one, in gift mode a whole page the writer owns moves
+ * into the queue instead and is unmapped from the writer. A read copies
+ * out of the first page, mmap on the read end moves the pages into the
+ * reader. mmap on the write end hands out fresh pages to fill and give. */
+typedef struct pipe_slot {
+    uint8_t * page; // from palloc
+    uint16_t start; // first byte not read yet
+    uint16_t end; // byte after the last one written
+} pipe_slot_t;
+
+/* a pipe lives while either end is open in some process. readers and
+ * writers count the open ends, fds of the process that made the pipe and
+ * stdin or stdout of the programs it was attached to */
+typedef struct pipe {
+    pipe_slot_t slots[PIPE_SLOTS];
+    uint32_t head; // slot read next, head and tail run freely and are masked on use
+    uint32_t tail; // slot after the last one written
+    int in_use;
+    int gift; // PIPE_GIFT mode
+    int readers;
+    int writers;
+} pipe_t;
+
+extern file_ops_t pipe_read_ops;
+extern file_ops_t pipe_write_ops;
+
+int32_t pipe_create();
+
+int32_t pipe_read(int32_t fd, void * buf, int32_t nbytes);
+int32_t pipe_write(int32_t fd, const void * buf, int32_t nbytes);
+int32_t pipe_read_dup(int32_t fd);
+int32_t pipe_write_dup(int32_t fd);
+int32_t pipe_read_close(int32_t fd);
+int32_t pipe_write_close(int32_t fd);
+int32_t pipe_read_ioctl(int32_t fd, int32_t request, int32_t arg);
+int32_t pipe_write_ioctl(int32_t fd, int32_t request, int32_t arg);
+int32_t pipe_read_mmap(int32_t fd, uint8_t ** start);
+int32_t pipe_write_mmap(int32_t fd, uint8_t ** start);
+
+#endif // PIPE_H
@@ -1,5 +1,7 @@
 #include "pit.h"
 #include "process.h"
+#include "kstat.h"
+#include "terminal.h"
 
 static int test_pit_counter = 0;
 
@@ -20,7 +22,16 @@ void pit_handler(){
     //printf("PIT: %d\n", test_pit_counter);
     test_pit_counter ++;
 
+    kstat.ticks++;
+    if (get_current_pcb() != NULL) {
+        get_current_pcb()->ticks++;
+    }
+
+
+    // typed keys are handled and the displayed terminal's screen catches up once per tick
+    terminal_input();
+    terminal_flush();
 
     // scheduling stuff
-    go_to_next_terminal();
+    go_to_next_process();
 }
@@ -6,13 +6,14 @@
 #include "terminal.h"
 #include "pit.h"
 #include "paging.h"
+#include "kstat.h"
 
 terminal_desc_t * current_terminal;
 terminal_desc_t terminals[MAX_TERMINALS];
 
 /* init_kernel
  * 
- * DESCRIPTION: Initializes 3 shells in 3 terminals
+ * DESCRIPTION: Starts a shell in the first terminal, the others are opened with Alt+Fn
  * 
  * INPUTS: NONE
  *         
@@ -24,33 +25,16 @@ int init_kernel() {
 
     /*
     * Sets the terminal struct values for terminal 1. 
-    * has_been_called is 1 since this will be the first 
-    * process called
+    * its shell is started marked as running since this 
+    * will be the first process called
     */
-    terminals[TERMINAL_1].terminal_id = TERMINAL_1;
-    terminals[TERMINAL_1].vid_mem_present = 0;
-    terminals[TERMINAL_1].has_been_called = 1; 
-
-    /*
-    * Sets the terminal struct values for terminal 2
-    */
-    terminals[TERMINAL_2].terminal_id = TERMINAL_2;
-    terminals[TERMINAL_2].vid_mem_present = 0;
-    terminals[TERMINAL_2].has_been_called = 0;
-
-    /*
-    * Sets the terminal struct values for terminal 3. 
-    */
-    terminals[TERMINAL_3].terminal_id = TERMINAL_3;
-    terminals[TERMINAL_3].vid_mem_present = 0;
-    terminals[TERMINAL_3].has_been_called = 0;
+    open_terminal(TERMINAL_1);
 
     // loads shell program execution data into mem and sets up pcb for this terminal
-    create_shell((void *) &terminals[TERMINAL_3]);
-    create_shell((void *) &terminals[TERMINAL_2]);
     create_shell((void *) &terminals[TERMINAL_1]); // tss is set in here
 
     current_terminal = &terminals[TERMINAL_1];
+    current_terminal->active_pcb->started = 1;
     set_current_pcb(current_terminal->active_pcb);
 
     pit_init(); // init PIT interrupts after setting up terminal
@@ -105,19 +89,26 @@ void set_terminal(int terminal_num) {
 }
 #endif
 
-/* go_to_next_terminal
+/* go_to_next_process
  * 
- * DESCRIPTION: Goes to the next terminal from the current one.
- *              Sets the current active process and change the current 
- *              process number for terminal and rtc. Loads paging too
+ * DESCRIPTION: Switches to the next process that can run, in round-robin by pid.
+ *              A process that executed a program waits for it and is skipped,
+ *              programs started with spawn run next to their parent. A terminal
+ *              that was just opened gets its shell loaded here, it is skipped
+ *              while there is no pid for it. Processes asleep in futex_wait
+ *              are skipped too. When nothing can run the caller keeps
+ *              running if it is still active, otherwise the CPU idles until
+ *              an interrupt makes something runnable. Sets the keyboard and rtc terminal
+ *              of the process and loads its paging, the paging of the
+ *              process it belongs to for a thread.
  * 
  * INPUTS: NONE
  *         
  * OUTPUTS: none ( asm_halt or asm_execute will be called)
- * RETURN VALUE: none
- * SIDE EFFECTS: goes into user process
+ * RETURN VALUE: none, returns when the scheduler gets back to the calling process
+ * SIDE EFFECTS: goes into user process, interrupts have to be off
  */
-void go_to_next_terminal() {
+void go_to_next_process() {
 
     /*
     * Stores the ebp and esp of the previous process so the kernel
@@ -126,51 +117,133 @@ void go_to_next_terminal() {
     */
     register uint32_t store_ebp asm("ebp");
     register uint32_t store_esp asm("esp");
-    current_terminal->saved_esp = (void *) store_esp;
-    current_terminal->saved_ebp = (void *) store_ebp;
-
-    //vIbMaT 
-    if(current_terminal->vid_mem_present != 0){
-        video_map_table[current_terminal->terminal_id].page_base_address = TERM1_VIDEO_ADDR+current_terminal->terminal_id; 
+    pcb_t * current = get_current_pcb();
+    pcb_t * next = NULL;
+    int pid;
+    int i;
+
+    if (current != NULL) {
+        current->sched_esp = (void *) store_esp;
+        current->sched_ebp = (void *) store_ebp;
     }
-    flush_tlb();
 
-    // change the current terminal to the next one in round-robin
-    current_terminal = &terminals[(current_terminal->terminal_id+1) % MAX_TERMINALS];
+    kstat.context_switches++;
+
+    while (1) {
+        for (i = 0; i < MAX_TERMINALS; i++) {
+            if (terminals[i].open && terminals[i].active_pcb == NULL) {
+                create_shell((void *) &terminals[i]);
+            }
+        }
+
+        pid = (current != NULL) ? current->pid : -1;
+        for (i = 0; i < MAX_NEXT_PID; i++) {
+            pid = (pid + 1) % MAX_NEXT_PID;
+            if ((next = get_pcb(pid)) != NULL && next->active && next->futex_key == 0) {
+                break;
+            }
+            next = NULL;
+        }
+        if (next != NULL) {
+            break;
+        }
+        if (current != NULL && current->active) { // the caller is the last process left, it keeps running
+            next = current;
+            break;
+        }
+        // the caller exited and nothing can run, wait until an interrupt changes that
+        asm volatile ("sti; hlt; cli");
+    }
+    current_terminal = (terminal_desc_t *) next->terminal;
 
     set_active_buffer (current_terminal->terminal_id); // sets the keyboard/terminal attributes of this terminal
     set_rtc_active_terminal(current_terminal->terminal_id); // sets the rtc attributes of this terminal
 
-    fs_reload_exe(current_terminal->active_pcb->pid); // resets paging to page of next terminal
-    tss.esp0 = ((PCB_BOTTOM_MB << MiB_SHIFT) - ((current_terminal->active_pcb->pid) * (PCB_LEN_KB << KiB_SHIFT)) - NUM_BYTES_4); // reset kernel esp to next process esp
-    set_current_pcb(current_terminal->active_pcb);
+    fs_reload_exe(next->process->pid); // resets paging to page of next process
+    tss.esp0 = ((PCB_BOTTOM_MB << MiB_SHIFT) - ((next->pid) * (PCB_LEN_KB << KiB_SHIFT)) - NUM_BYTES_4); // reset kernel esp to next process esp
+    set_current_pcb(next);
 
-    //ViBmAt 
-    if(current_terminal->vid_mem_present != 0){
-        video_map_table[current_terminal->terminal_id].page_base_address = VIDEO_ADDR + (get_displayed_terminal()+1) * (get_displayed_terminal() != current_terminal->terminal_id) ; 
-    }   
     // modified paging, flush the TLB
     flush_tlb();
 
     /*
-    * If this terminal hasn't been called then there will be no saved esp or ebp, and
-    * the kernel should start this kernel from the beginning
+    * If this process hasn't run yet then there will be no saved esp or ebp, and
+    * the kernel should start it from the beginning
     */
-    if (!current_terminal->has_been_called) {
-        current_terminal->has_been_called = 1;
+    if (!next->started) {
+        next->started = 1;
+        if (next->process != next) { // a thread starts where thread_create said
+            thread_start_asm(next->thread_eip, next->thread_esp);
+        }
         execute_asm();
     }
 
     // set the esp, ebp to previously stored values
-    store_ebp = (uint32_t) current_terminal->saved_ebp;
-    store_esp = (uint32_t) current_terminal->saved_esp;
+    store_ebp = (uint32_t) next->sched_ebp;
+    store_esp = (uint32_t) next->sched_esp;
 
-    // context switch into next terminal
+    // context switch into next process
     halt_asm((void *) store_ebp, (void *) store_esp, 0);
 
 
 }
 
+/* process_yield
+ * 
+ * DESCRIPTION: Lets the other processes run while the calling one waits for
+ *              something in the kernel, so a wait does not depend on the PIT
+ * 
+ * INPUTS: NONE
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: none, returns when the scheduler gets back to the calling process
+ * SIDE EFFECTS: does nothing before the first shell is started
+ */
+void process_yield() {
+    uint32_t flags;
+
+    if (get_current_pcb() == NULL) {
+        return;
+    }
+    cli_and_save(flags);
+    go_to_next_process();
+    restore_flags(flags);
+}
+
+/* open_terminal
+ * 
+ * DESCRIPTION: Opens a terminal for Alt+Fn. Its state and screen are allocated
+ *              right away, its shell is started the next time the scheduler gets to it.
+ * 
+ * INPUTS: terminal_num: index of the terminal
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success or if it is already open, -1 if it can't be allocated
+ * SIDE EFFECTS: none
+ */
+int open_terminal(int terminal_num) {
+    if (terminal_num < 0 || terminal_num >= MAX_TERMINALS) {
+        return -1;
+    }
+    if (terminals[terminal_num].open) {
+        return 0;
+    }
+    if (terminal_create(terminal_num) == -1) {
+        return -1;
+    }
+    terminals[terminal_num].terminal_id = terminal_num;
+    terminals[terminal_num].vid_mem_present = 0;
+    terminals[terminal_num].active_pcb = NULL;
+    terminals[terminal_num].open = 1;
+    return 0;
+}
+
 int get_num_vidmapped(){
-    return terminals[TERMINAL_1].vid_mem_present + terminals[TERMINAL_2].vid_mem_present + terminals[TERMINAL_3].vid_mem_present;
+    int i;
+    int count = 0;
+
+    for (i = 0; i < MAX_TERMINALS; i++) {
+        count += terminals[i].vid_mem_present;
+    }
+    return count;
 }
@@ -7,9 +7,8 @@
 #define TERMINAL_2 1
 #define TERMINAL_3 2
 
-#define MAX_TERMINALS 3
-
 #include "syscall.h"
+#include "terminal.h"
 
 typedef struct __attribute__ ((packed)) terminal_desc {
     pcb_t * active_pcb;
@@ -20,16 +19,16 @@ typedef struct __attribute__ ((packed)) terminal_desc {
     // void * vid_mem_ptr; // DO WE NEED THIS?
     // anything else we need?
 
-    void * saved_esp;
-    void * saved_ebp;
-    int has_been_called;
+    int open; // opened with Alt+Fn, its shell starts the first time it is scheduled
 } terminal_desc_t;
 
 int init_kernel();
+int open_terminal(int terminal_num);
 
 // void set_terminal(int terminal_num);
 
-void go_to_next_terminal();
+void go_to_next_process();
+void process_yield();
 
 int get_num_vidmapped();
 
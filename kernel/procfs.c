@@ -0,0 +1,454 @@
+#include "procfs.h"
+#include "file_driver.h"
+#include "process.h"
+#include "paging.h"
+#include "kstat.h"
+#include "terminal.h"
+#include "exception_numbers.h"
+#include "types.h"
+#include "lib.h"
+
+#define NUM_WIDTH 12
+#define NAME_WIDTH 14
+#define NUM_BUF_SIZE 16
+#define KCYCLE_SHIFT 10
+#define STAMP_SEED 5381
+#define STAMP_MULT 33
+
+/* names of the entries in SYSCALL_TABLE (linkage.S), in table order */
+static const int8_t * syscall_names[] = {
+    "halt", "execute", "read", "write", "open", "close", "getargs", "vidmap",
+    "set_handler", "sigreturn", "mmap", "munmap",
+    "lseek", "pread", "stat", "fstat", "getdents",
+    "readv", "writev", "ioctl", "pipe", "spawn", "waitpid",
+    "sbrk", "mmap_anon", "shm_map", "futex_wait", "futex_wake",
+    "thread_create", "thread_exit", "thread_join"
+};
+#define NUM_SYSCALL_NAMES (sizeof(syscall_names) / sizeof(syscall_names[0]))
+
+static void proc_gen_stat(proc_buf_t * out);
+static void proc_gen_interrupts(proc_buf_t * out);
+static void proc_gen_syscalls(proc_buf_t * out);
+static void proc_gen_ps(proc_buf_t * out);
+static void proc_gen_net(proc_buf_t * out);
+
+static proc_entry_t proc_entries[] = {
+    { .name = "stat", .generate = proc_gen_stat },
+    { .name = "interrupts", .generate = proc_gen_interrupts },
+    { .name = "syscalls", .generate = proc_gen_syscalls },
+    { .name = "ps", .generate = proc_gen_ps },
+    { .name = "net", .generate = proc_gen_net }
+};
+#define NUM_PROC_ENTRIES (sizeof(proc_entries) / sizeof(proc_entries[0]))
+
+static file_ops_t proc_ops = {
+    .write_func = proc_write,
+    .read_func = proc_read,
+    .close_func = proc_close,
+    .open_func = proc_open
+};
+static file_ops_t proc_dir_ops = {
+    .write_func = NULL,
+    .read_func = proc_dir_read,
+    .close_func = proc_close,
+    .open_func = proc_open,
+    .getdents_func = proc_dir_getdents
+};
+
+/* proc_puts
+ *
+ * DESCRIPTION: Appends a string to proc text, padded with spaces
+ *
+ * INPUTS: out: the text being generated
+ *         s: string to append
+ *         width: minimum number of characters to append
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: silently truncates once the buffer is full, only updates
+ *               the stamp when there is no buffer
+ */
+static void proc_puts(proc_buf_t * out, const int8_t * s, uint32_t width) {
+    uint32_t written = 0;
+    if (out->data == NULL) {
+        while (*s != '\0') {
+            out->stamp = out->stamp * STAMP_MULT + *s++;
+        }
+        return;
+    }
+    while (*s != '\0' && out->len < PROC_BUF_SIZE) {
+        out->data[out->len++] = *s++;
+        written++;
+    }
+    while (written < width && out->len < PROC_BUF_SIZE) {
+        out->data[out->len++] = ' ';
+        written++;
+    }
+}
+
+/* proc_putu
+ *
+ * DESCRIPTION: Appends an unsigned number to proc text, padded with spaces
+ *
+ * INPUTS: out: the text being generated
+ *         value: number to append in decimal
+ *         width: minimum number of characters to append
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: only updates the stamp when there is no buffer
+ */
+static void proc_putu(proc_buf_t * out, uint32_t value, uint32_t width) {
+    int8_t num_buf[NUM_BUF_SIZE];
+    if (out->data == NULL) {
+        out->stamp = out->stamp * STAMP_MULT + value;
+        return;
+    }
+    itoa(value, num_buf, 10);
+    proc_puts(out, num_buf, width);
+}
+
+/* proc_put_counter
+ *
+ * DESCRIPTION: Appends a "name value" line to proc text
+ *
+ * INPUTS: out: the text being generated
+ *         name: name of the counter
+ *         value: value of the counter
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void proc_put_counter(proc_buf_t * out, const int8_t * name, uint32_t value) {
+    proc_puts(out, name, NAME_WIDTH + NUM_WIDTH / 2);
+    proc_putu(out, value, 0);
+    proc_puts(out, "\n", 0);
+}
+
+/* /proc/stat: scheduler, paging and filesystem counters */
+static void proc_gen_stat(proc_buf_t * out) {
+    proc_put_counter(out, "ticks", kstat.ticks);
+    proc_put_counter(out, "context_switches", kstat.context_switches);
+    proc_put_counter(out, "tlb_flushes", tlb_flush_count);
+    proc_put_counter(out, "fs_lookups", kstat.fs_lookups);
+    proc_put_counter(out, "fs_lookup_misses", kstat.fs_lookup_misses);
+    proc_put_counter(out, "fs_reads", kstat.fs_reads);
+    proc_put_counter(out, "fs_read_bytes", kstat.fs_read_bytes);
+    proc_put_counter(out, "bcache_hits", kstat.bcache_hits);
+    proc_put_counter(out, "bcache_misses", kstat.bcache_misses);
+    proc_put_counter(out, "bcache_readahead", kstat.bcache_readahead_blocks);
+    proc_put_counter(out, "block_requests", kstat.block_requests);
+    proc_put_counter(out, "block_read_sectors", kstat.block_read_sectors);
+    proc_put_counter(out, "block_write_sectors", kstat.block_write_sectors);
+    proc_put_counter(out, "vblk_requests", kstat.vblk_requests);
+    proc_put_counter(out, "vblk_kicks", kstat.vblk_kicks);
+    proc_put_counter(out, "vblk_queue_depth", kstat.vblk_queue_depth);
+    proc_put_counter(out, "vblk_max_depth", kstat.vblk_max_queue_depth);
+    proc_put_counter(out, "vblk_avg_kcycles", kstat.vblk_completions ?
+        (uint32_t) (kstat.vblk_latency_cycles >> KCYCLE_SHIFT) / kstat.vblk_completions : 0);
+    proc_put_counter(out, "pages_used", kstat.pages_used);
+    proc_put_counter(out, "demand_zero_faults", kstat.demand_zero_faults);
+    proc_put_counter(out, "term_writes", kstat.term_writes);
+    proc_put_counter(out, "term_chars", kstat.term_chars);
+    proc_put_counter(out, "term_kcycles", (uint32_t) (kstat.term_cycles >> KCYCLE_SHIFT));
+    proc_put_counter(out, "term_switches", kstat.term_switches);
+    proc_put_counter(out, "term_switch_cycles", kstat.term_switch_cycles);
+    proc_put_counter(out, "term_flushes", kstat.term_flushes);
+    proc_put_counter(out, "term_flushed_rows", kstat.term_flushed_rows);
+    proc_put_counter(out, "keys", kstat.keys);
+    proc_put_counter(out, "keys_dropped", kstat.keys_dropped);
+}
+
+/* /proc/interrupts: one line per PIC input */
+static void proc_gen_interrupts(proc_buf_t * out) {
+    int i;
+    proc_puts(out, "irq", NUM_WIDTH / 2);
+    proc_puts(out, "count\n", 0);
+    for (i = 0; i < NUM_IRQS; i++) {
+        proc_putu(out, i, NUM_WIDTH / 2);
+        proc_putu(out, kstat.irq_count[i], 0);
+        proc_puts(out, "\n", 0);
+    }
+}
+
+/* /proc/syscalls: calls and average latency in kilocycles per syscall */
+static void proc_gen_syscalls(proc_buf_t * out) {
+    int i;
+    uint32_t avg;
+    proc_puts(out, "name", NAME_WIDTH);
+    proc_puts(out, "calls", NUM_WIDTH);
+    proc_puts(out, "returns", NUM_WIDTH);
+    proc_puts(out, "avg_kcycles\n", 0);
+    for (i = 0; i < NUM_SYSCALL_NAMES; i++) {
+        avg = 0;
+        if (kstat.syscall_returns[i]) {
+            avg = (uint32_t) (kstat.syscall_cycles[i] >> KCYCLE_SHIFT) / kstat.syscall_returns[i];
+        }
+        proc_puts(out, syscall_names[i], NAME_WIDTH);
+        proc_putu(out, syscall_calls[i], NUM_WIDTH);
+        proc_putu(out, kstat.syscall_returns[i], NUM_WIDTH);
+        proc_putu(out, avg, 0);
+        proc_puts(out, "\n", 0);
+    }
+}
+
+/* /proc/ps: one line per live process */
+static void proc_gen_ps(proc_buf_t * out) {
+    int pid, i, fds;
+    uint32_t mem_kb;
+    pcb_t * pcb;
+    pcb_t * parent;
+    terminal_desc_t * terminal;
+
+    proc_puts(out, "pid", NUM_WIDTH / 2);
+    proc_puts(out, "ppid", NUM_WIDTH / 2);
+    proc_puts(out, "term", NUM_WIDTH / 2);
+    proc_puts(out, "state", NUM_WIDTH / 2);
+    proc_puts(out, "ticks", NUM_WIDTH);
+    proc_puts(out, "fds", NUM_WIDTH / 2);
+    proc_puts(out, "mem_kb", NUM_WIDTH - 2);
+    proc_puts(out, "name\n", 0);
+
+    for (pid = 0; pid < MAX_NEXT_PID; pid++) {
+        if (NULL == (pcb = get_pcb(pid))) {
+            continue;
+        }
+        parent = (pcb_t *) pcb->parent_pcb_ptr;
+        terminal = (terminal_desc_t *) pcb->terminal;
+
+        fds = 0;
+        for (i = 0; i < pcb->fd_table_size; i++) {
+            if (pcb->file_arr[i].fd != -1) {
+                fds++;
+            }
+        }
+
+        // program page, kernel stack and the vidmap page if there is one,
+        // a thread has its kernel stack and user stack
+        mem_kb = (MB_4_PAGE_SIZE >> KiB_SHIFT) + PCB_LEN_KB;
+        if (pcb->process != pcb) {
+            mem_kb = PCB_LEN_KB + ((THREAD_STACK_PAGES * PAGE_SIZE) >> KiB_SHIFT);
+        } else if (terminal != NULL && terminal->vid_mem_present) {
+            mem_kb += TERM_VIDEO_SIZE >> KiB_SHIFT;
+        }
+
+        proc_putu(out, pid, NUM_WIDTH / 2);
+        if (parent != NULL) {
+            proc_putu(out, parent->pid, NUM_WIDTH / 2);
+        } else {
+            proc_puts(out, "-", NUM_WIDTH / 2);
+        }
+        if (terminal != NULL) {
+            proc_putu(out, terminal->terminal_id, NUM_WIDTH / 2);
+        } else {
+            proc_puts(out, "-", NUM_WIDTH / 2);
+        }
+        if (pcb == get_current_pcb()) {
+            proc_puts(out, "run", NUM_WIDTH / 2);
+        } else if (pcb->zombie) {
+            proc_puts(out, "exit", NUM_WIDTH / 2);
+        } else if (pcb->active) {
+            proc_puts(out, "ready", NUM_WIDTH / 2);
+        } else {
+            proc_puts(out, "wait", NUM_WIDTH / 2);
+        }
+        proc_putu(out, pcb->ticks, NUM_WIDTH);
+        proc_putu(out, fds, NUM_WIDTH / 2);
+        proc_putu(out, mem_kb, NUM_WIDTH - 2);
+        proc_puts(out, pcb->name, 0);
+        proc_puts(out, "\n", 0);
+    }
+}
+
+/* /proc/net: NIC traffic counters */
+static void proc_gen_net(proc_buf_t * out) {
+    proc_put_counter(out, "tx_packets", kstat.nic_tx_packets);
+    proc_put_counter(out, "tx_bytes", kstat.nic_tx_bytes);
+    proc_put_counter(out, "rx_packets", kstat.nic_rx_packets);
+    proc_put_counter(out, "rx_bytes", kstat.nic_rx_bytes);
+    proc_put_counter(out, "irqs", kstat.irq_count[ETH_INTERRUPT - IRQ_0]);
+}
+
+/* proc_lookup_path
+ *
+ * DESCRIPTION: Resolves a path in the /proc namespace
+ *
+ * INPUTS: path: "/proc" for the directory, or "/proc/<name>"
+ * OUTPUTS: none
+ * RETURN VALUE: pointer to the file operations for the path, NULL if there
+ *               is no such proc file
+ * SIDE EFFECTS: none
+ */
+file_ops_t * proc_lookup_path(const int8_t * path) {
+    if (!strncmp(path, PROC_DIR_NAME, PROC_PREFIX_LEN)) {
+        return &proc_dir_ops;
+    }
+    if (proc_open((const uint8_t *) path) == -1) {
+        return NULL;
+    }
+    return &proc_ops;
+}
+
+/* proc_open
+ *
+ * DESCRIPTION: Finds the proc entry for a path
+ *
+ * INPUTS: filename: "/proc" or "/proc/<name>"
+ * OUTPUTS: none
+ * RETURN VALUE: index of the entry (kept as the file's inode), 0 for the
+ *               directory, -1 if there is no such entry
+ * SIDE EFFECTS: none
+ */
+int32_t proc_open(const uint8_t * filename) {
+    int i;
+    if (!strncmp((int8_t *) filename, PROC_DIR_NAME, PROC_PREFIX_LEN)) {
+        return 0;
+    }
+    if (strncmp((int8_t *) filename, PROC_PREFIX, PROC_PREFIX_LEN)) {
+        return -1;
+    }
+    for (i = 0; i < NUM_PROC_ENTRIES; i++) {
+        if (!strncmp(proc_entries[i].name, (int8_t *) filename + PROC_PREFIX_LEN, PROC_NAME_LEN)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* proc_read
+ *
+ * DESCRIPTION: Reads the text of a proc file. A read at offset 0 walks the
+ *              values the file shows without formatting them and takes a
+ *              new snapshot only if they changed; every other read is a
+ *              plain copy of the snapshot so a file read in pieces stays
+ *              consistent.
+ *
+ * INPUTS: fd: pointer to the file object of the open proc file
+ *         buf: buffer we want to read bytes into
+ *         nbytes: number of bytes we want to read
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes read, 0 at end of file, -1 for invalid arguments
+ * SIDE EFFECTS: advances the file object's offset
+ */
+int32_t proc_read(int32_t fd, void * buf, int32_t nbytes) {
+    file_object_t * file = (file_object_t *) fd;
+    proc_entry_t * entry;
+    proc_buf_t out;
+    uint32_t remaining;
+
+    if (file == NULL || buf == NULL || nbytes < 0 || file->inode < 0 || file->inode >= NUM_PROC_ENTRIES) {
+        return -1;
+    }
+    entry = &proc_entries[file->inode];
+
+    if (file->curr_offset == 0 || !entry->valid) {
+        out.data = NULL;
+        out.stamp = STAMP_SEED;
+        entry->generate(&out);
+        if (!entry->valid || out.stamp != entry->stamp) {
+            entry->stamp = out.stamp;
+            out.data = entry->data;
+            out.len = 0;
+            entry->generate(&out);
+            entry->len = out.len;
+            entry->valid = 1;
+        }
+    }
+
+    if (file->curr_offset >= entry->len) {
+        return 0;
+    }
+    remaining = entry->len - file->curr_offset;
+    if (nbytes > remaining) {
+        nbytes = remaining;
+    }
+    memcpy(buf, entry->data + file->curr_offset, nbytes);
+    file->curr_offset += nbytes;
+    return nbytes;
+}
+
+/* proc_write
+ *
+ * DESCRIPTION: procfs is read-only
+ *
+ * INPUTS: ignored
+ * OUTPUTS: none
+ * RETURN VALUE: -1
+ * SIDE EFFECTS: none
+ */
+int32_t proc_write(int32_t fd, const void * buf, int32_t nbytes) {
+    return -1;
+}
+
+/* proc_close
+ *
+ * DESCRIPTION: Nothing to release for proc files
+ *
+ * INPUTS: ignored
+ * OUTPUTS: none
+ * RETURN VALUE: 0
+ * SIDE EFFECTS: none
+ */
+int32_t proc_close(int32_t fd) {
+    return 0;
+}
+
+/* proc_dir_read
+ *
+ * DESCRIPTION: Reads the /proc directory one file name at a time
+ *
+ * INPUTS: fd: pointer to the file object of the open directory
+ *         buf: buffer we want to read the name into
+ *         nbytes: unused
+ * OUTPUTS: none
+ * RETURN VALUE: length of the name read, 0 once every entry was listed
+ * SIDE EFFECTS: advances the file object's offset
+ */
+int32_t proc_dir_read(int32_t fd, void * buf, int32_t nbytes) {
+    file_object_t * file = (file_object_t *) fd;
+    uint32_t size;
+
+    if (file == NULL || buf == NULL) {
+        return -1;
+    }
+    if (file->curr_offset < 0 || file->curr_offset >= NUM_PROC_ENTRIES) {
+        return 0;
+    }
+
+    size = strlen(proc_entries[file->curr_offset].name);
+    memcpy(buf, proc_entries[file->curr_offset].name, size);
+    file->curr_offset += 1;
+    return size;
+}
+
+/* proc_dir_getdents
+ *
+ * DESCRIPTION: Reads as many /proc entries as fit in the buffer, see
+ *              dir_getdents
+ *
+ * INPUTS: fd: pointer to the file object of the open directory
+ *         buf: buffer we want to read the entries into
+ *         nbytes: size of buf
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes read, 0 once every entry was listed, -1 if
+ *               buf is too small for the next entry
+ * SIDE EFFECTS: advances the file object's offset
+ */
+int32_t proc_dir_getdents(int32_t fd, void * buf, int32_t nbytes) {
+    file_object_t * file = (file_object_t *) fd;
+    int32_t read = 0;
+    int32_t put;
+
+    if (file == NULL || buf == NULL) {
+        return -1;
+    }
+
+    while (file->curr_offset >= 0 && file->curr_offset < NUM_PROC_ENTRIES) {
+        put = put_dirent((uint8_t *) buf + read, nbytes - read, proc_entries[file->curr_offset].name,
+                         strlen(proc_entries[file->curr_offset].name), FILE_TYPE_PROC, 0, 0);
+        if (put == 0) {
+            return (read == 0) ? -1 : read;
+        }
+        read += put;
+        file->curr_offset += 1;
+    }
+    return read;
+}
@@ -0,0 +1,43 @@
+#include "types.h"
+#include "syscall.h"
+
+#ifndef PROCFS_H
+#define PROCFS_H
+
+#define PROC_NAME_LEN 16
+#define PROC_BUF_SIZE 4096
+
+/* read-only kernel state is reachable as "/proc/<name>" */
+#define PROC_PREFIX "/proc/"
+#define PROC_PREFIX_LEN 6
+#define PROC_DIR_NAME "/proc"
+
+/* text being generated for one proc file. With data NULL nothing is
+ * written, the values only get folded into stamp */
+typedef struct proc_buf {
+    int8_t * data;
+    uint32_t len;
+    uint32_t stamp;
+} proc_buf_t;
+
+/* one proc file. The text is regenerated when a read from the start of the
+ * file finds that the values it shows moved, otherwise served from data */
+typedef struct proc_entry {
+    int8_t name[PROC_NAME_LEN];
+    void (*generate)(proc_buf_t * out);
+    int8_t data[PROC_BUF_SIZE];
+    uint32_t len;
+    uint32_t stamp; // stamp of the values data was generated from
+    int valid;
+} proc_entry_t;
+
+file_ops_t * proc_lookup_path(const int8_t * path);
+
+int32_t proc_read(int32_t fd, void * buf, int32_t nbytes);
+int32_t proc_write(int32_t fd, const void * buf, int32_t nbytes);
+int32_t proc_open(const uint8_t * filename);
+int32_t proc_close(int32_t fd);
+int32_t proc_dir_read(int32_t fd, void * buf, int32_t nbytes);
+int32_t proc_dir_getdents(int32_t fd, void * buf, int32_t nbytes);
+
+#endif // PROCFS_H
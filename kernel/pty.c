@@ -0,0 +1,394 @@
+#include "pty.h"
+#include "devfs.h"
+#include "file_driver.h"
+#include "process.h"
+#include "palloc.h"
+#include "types.h"
+#include "lib.h"
+
+static pty_t ptys[MAX_PTYS];
+
+static file_ops_t pty_master_ops = {
+    .write_func = pty_master_write,
+    .read_func = pty_master_read,
+    .close_func = pty_master_close,
+    .open_func = pty_master_open,
+    .ioctl_func = pty_master_ioctl
+};
+file_ops_t pty_stdin_ops = {
+    .write_func = NULL,
+    .read_func = pty_slave_read,
+    .close_func = pty_slave_close,
+    .open_func = NULL,
+    .dup_func = pty_slave_dup
+};
+file_ops_t pty_stdout_ops = {
+    .write_func = pty_slave_write,
+    .read_func = NULL,
+    .close_func = pty_slave_close,
+    .open_func = NULL,
+    .dup_func = pty_slave_dup
+};
+
+/* get_pty
+ *
+ * DESCRIPTION: Finds the pty an open master or slave refers to
+ *
+ * INPUTS: fd: pointer to the file object, its inode is the pty number
+ * OUTPUTS: none
+ * RETURN VALUE: the pty, NULL if the number is out of range or the pty
+ *               is not in use
+ * SIDE EFFECTS: none
+ */
+static pty_t * get_pty(int32_t fd) {
+    int32_t n = ((file_object_t *) fd)->inode;
+    if (n < 0 || n >= MAX_PTYS || ptys[n].to_slave.data == NULL) {
+        return NULL;
+    }
+    return &ptys[n];
+}
+
+/* master_stopped
+ *
+ * DESCRIPTION: Checks if nothing will be written to the slave anymore. The
+ *              process holding the master cannot write while it waits for a
+ *              program it executed to halt.
+ *
+ * INPUTS: p: the pty
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if the master is closed or no process that can run has
+ *               it, 0 if not
+ * SIDE EFFECTS: none
+ */
+static int master_stopped(pty_t * p) {
+    return !p->master_open || !file_users_running(&pty_master_ops, p - ptys);
+}
+
+/* pty_release
+ *
+ * DESCRIPTION: Gives the rings of a pty back to the page pool once neither
+ *              side is in use
+ *
+ * INPUTS: p: the pty
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: the pty can be handed out again
+ */
+static void pty_release(pty_t * p) {
+    if (p->master_open || p->slave_users > 0 || p->to_slave.data == NULL) {
+        return;
+    }
+    pfree(p->to_slave.data, PTY_BUF_PAGES);
+    pfree(p->to_master.data, PTY_BUF_PAGES);
+    p->to_slave.data = NULL;
+    p->to_master.data = NULL;
+}
+
+/* pty_init
+ *
+ * DESCRIPTION: Registers the pty master as /dev/ptmx
+ *
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: adds an entry to the device table
+ */
+void pty_init() {
+    memset(ptys, 0, sizeof(ptys));
+    dev_register((int8_t *) "ptmx", &pty_master_ops);
+}
+
+/* pty_master_open
+ *
+ * DESCRIPTION: Allocates a free pty and its rings
+ *
+ * INPUTS: ignored
+ * OUTPUTS: none
+ * RETURN VALUE: number of the pty, stored as the inode of the open file,
+ *               -1 if all ptys are in use or there are no free pages
+ * SIDE EFFECTS: none
+ */
+int32_t pty_master_open(const uint8_t * filename) {
+    pty_t * p;
+    uint32_t flags;
+    int32_t n;
+
+    cli_and_save(flags);
+    for (n = 0; n < MAX_PTYS; n++) {
+        if (ptys[n].to_slave.data == NULL) {
+            break;
+        }
+    }
+    if (n == MAX_PTYS) {
+        restore_flags(flags);
+        return -1;
+    }
+
+    p = &ptys[n];
+    p->to_slave.data = palloc(PTY_BUF_PAGES);
+    p->to_master.data = palloc(PTY_BUF_PAGES);
+    if (p->to_slave.data == NULL || p->to_master.data == NULL) {
+        if (p->to_slave.data != NULL) {
+            pfree(p->to_slave.data, PTY_BUF_PAGES);
+        }
+        if (p->to_master.data != NULL) {
+            pfree(p->to_master.data, PTY_BUF_PAGES);
+        }
+        p->to_slave.data = NULL;
+        p->to_master.data = NULL;
+        restore_flags(flags);
+        return -1;
+    }
+    ring_init(&p->to_slave, p->to_slave.data, PTY_BUF_SIZE);
+    ring_init(&p->to_master, p->to_master.data, PTY_BUF_SIZE);
+    p->master_open = 1;
+    p->slave_users = 0;
+    restore_flags(flags);
+    return n;
+}
+
+/* pty_master_close
+ *
+ * DESCRIPTION: Closes the master, the slave reads what is left and then
+ *              end of file
+ *
+ * INPUTS: fd: pointer to the file object of the master
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 for an invalid pty
+ * SIDE EFFECTS: frees the rings if no process has the slave
+ */
+int32_t pty_master_close(int32_t fd) {
+    pty_t * p = get_pty(fd);
+    uint32_t flags;
+
+    if (p == NULL) {
+        return -1;
+    }
+    cli_and_save(flags);
+    p->master_open = 0;
+    pty_release(p);
+    restore_flags(flags);
+    return 0;
+}
+
+/* pty_master_read
+ *
+ * DESCRIPTION: Reads what programs on the slave wrote to stdout, waits until
+ *              there is something or no process that can run has the slave
+ *
+ * INPUTS: fd: pointer to the file object of the master
+ *         buf: where to copy to
+ *         nbytes: most bytes to read
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes read, 0 at end of file, -1 for invalid
+ *               arguments
+ * SIDE EFFECTS: none
+ */
+int32_t pty_master_read(int32_t fd, void * buf, int32_t nbytes) {
+    pty_t * p = get_pty(fd);
+    uint32_t flags;
+    int32_t n;
+
+    if (p == NULL || buf == NULL || nbytes < 0) {
+        return -1;
+    }
+    while (1) {
+        cli_and_save(flags);
+        if (RING_COUNT(&p->to_master) > 0 || p->slave_users == 0 ||
+            !file_users_running(&pty_stdout_ops, p - ptys)) {
+            break;
+        }
+        restore_flags(flags);
+        process_yield();
+    }
+    n = ring_get(&p->to_master, buf, nbytes, 0);
+    restore_flags(flags);
+    return n;
+}
+
+/* pty_master_write
+ *
+ * DESCRIPTION: Queues input for the slave's stdin. Waits for room while a
+ *              process that can run has the slave, without one it writes
+ *              what fits.
+ *
+ * INPUTS: fd: pointer to the file object of the master
+ *         buf: bytes to write
+ *         nbytes: number of bytes to write
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes written, -1 for invalid arguments
+ * SIDE EFFECTS: none
+ */
+int32_t pty_master_write(int32_t fd, const void * buf, int32_t nbytes) {
+    pty_t * p = get_pty(fd);
+    uint32_t flags;
+    int32_t n = 0;
+
+    if (p == NULL || buf == NULL || nbytes < 0) {
+        return -1;
+    }
+    while (1) {
+        cli_and_save(flags);
+        n += ring_put(&p->to_slave, (const uint8_t *) buf + n, nbytes - n);
+        if (n == nbytes || p->slave_users == 0 ||
+            !file_users_running(&pty_stdin_ops, p - ptys)) {
+            break;
+        }
+        restore_flags(flags);
+        process_yield();
+    }
+    restore_flags(flags);
+    return n;
+}
+
+/* pty_master_ioctl
+ *
+ * DESCRIPTION: PTY_GET_NUM returns the number of the pty, PTY_ATTACH makes
+ *              the next program the calling process executes run with the
+ *              slave as stdin and stdout
+ *
+ * INPUTS: fd: pointer to the file object of the master
+ *         request: PTY_GET_NUM or PTY_ATTACH
+ *         arg: ignored
+ * OUTPUTS: none
+ * RETURN VALUE: the pty number or 0, -1 for an unknown request
+ * SIDE EFFECTS: none
+ */
+int32_t pty_master_ioctl(int32_t fd, int32_t request, int32_t arg) {
+    pty_t * p = get_pty(fd);
+
+    if (p == NULL) {
+        return -1;
+    }
+    switch (request) {
+        case PTY_GET_NUM:
+            return p - ptys;
+        case PTY_ATTACH:
+            if (-1 == set_child_stdio(FD_STDIN, 1, &pty_stdin_ops, p - ptys)) {
+                return -1;
+            }
+            return set_child_stdio(FD_STDOUT, 1, &pty_stdout_ops, p - ptys);
+        default:
+            return -1;
+    }
+}
+
+/* pty_slave_read
+ *
+ * DESCRIPTION: stdin of a program on the slave. Like a canonical terminal it
+ *              waits for a whole line and stops after its '\n'. Once the
+ *              master will not write anymore it returns what is left and
+ *              then end of file.
+ *
+ * INPUTS: fd: pointer to the file object, its inode is the pty number
+ *         buf: where to copy to
+ *         nbytes: most bytes to read
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes read, 0 at end of file, -1 for invalid
+ *               arguments
+ * SIDE EFFECTS: none
+ */
+int32_t pty_slave_read(int32_t fd, void * buf, int32_t nbytes) {
+    pty_t * p = get_pty(fd);
+    ring_t * r;
+    uint32_t flags;
+    int32_t n;
+
+    if (p == NULL || buf == NULL || nbytes < 0) {
+        return -1;
+    }
+    r = &p->to_slave;
+    while (1) {
+        cli_and_save(flags);
+        if (ring_has_line(r) || RING_SPACE(r) == 0 || master_stopped(p)) {
+            break;
+        }
+        restore_flags(flags);
+        process_yield();
+    }
+    n = ring_get(r, buf, nbytes, 1);
+    restore_flags(flags);
+    return n;
+}
+
+/* pty_slave_write
+ *
+ * DESCRIPTION: stdout of a program on the slave. Waits for the master to
+ *              make room, unless the master will not read until the program
+ *              halts, then the rest is dropped.
+ *
+ * INPUTS: fd: pointer to the file object, its inode is the pty number
+ *         buf: bytes to write
+ *         nbytes: number of bytes to write
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes written, -1 if the master is closed or the
+ *               arguments are invalid
+ * SIDE EFFECTS: none
+ */
+int32_t pty_slave_write(int32_t fd, const void * buf, int32_t nbytes) {
+    pty_t * p = get_pty(fd);
+    uint32_t flags;
+    int32_t n = 0;
+
+    if (p == NULL || buf == NULL || nbytes < 0 || !p->master_open) {
+        return -1;
+    }
+    while (1) {
+        cli_and_save(flags);
+        n += ring_put(&p->to_master, (const uint8_t *) buf + n, nbytes - n);
+        if (n == nbytes || master_stopped(p)) {
+            break;
+        }
+        restore_flags(flags);
+        process_yield();
+    }
+    restore_flags(flags);
+    return n;
+}
+
+/* pty_slave_dup
+ *
+ * DESCRIPTION: Counts another open slave stdin or stdout, for a program
+ *              that gets the slave from its parent
+ *
+ * INPUTS: fd: pointer to the file object, its inode is the pty number
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 for an invalid pty
+ * SIDE EFFECTS: none
+ */
+int32_t pty_slave_dup(int32_t fd) {
+    pty_t * p = get_pty(fd);
+    uint32_t flags;
+
+    if (p == NULL) {
+        return -1;
+    }
+    cli_and_save(flags);
+    p->slave_users++;
+    restore_flags(flags);
+    return 0;
+}
+
+/* pty_slave_close
+ *
+ * DESCRIPTION: Closes a slave stdin or stdout when its process halts, a
+ *              master read sees end of file once the last one is gone
+ *
+ * INPUTS: fd: pointer to the file object, its inode is the pty number
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 for an invalid pty
+ * SIDE EFFECTS: frees the rings if the master is closed too
+ */
+int32_t pty_slave_close(int32_t fd) {
+    pty_t * p = get_pty(fd);
+    uint32_t flags;
+
+    if (p == NULL) {
+        return -1;
+    }
+    cli_and_save(flags);
+    p->slave_users--;
+    pty_release(p);
+    restore_flags(flags);
+    return 0;
+}
@@ -0,0 +1,42 @@
+#include "types.h"
+#include "syscall.h"
+#include "palloc.h"
+#include "ring.h"
+
+#ifndef PTY_H
+#define PTY_H
+
+#define MAX_PTYS 4
+#define PTY_BUF_SIZE 0x4000 // bytes buffered in each direction, a power of two
+#define PTY_BUF_PAGES (PTY_BUF_SIZE / PALLOC_PAGE_SIZE)
+
+/* ioctl requests on a pty master */
+#define PTY_GET_NUM 0 // returns the number of the pty
+#define PTY_ATTACH 1 // the next program the process executes gets the slave as stdin and stdout
+
+/* the master is opened as /dev/ptmx and every open allocates a new pty. The
+ * slave has no name, a process gets it as stdin and stdout by executing a
+ * program after PTY_ATTACH and its children inherit it */
+typedef struct pty {
+    int master_open; // 1 while the master fd is open
+    int slave_users; // open slave stdins and stdouts
+    ring_t to_slave; // master writes, read as the slave's stdin
+    ring_t to_master; // the slave's stdout, master reads
+} pty_t;
+
+extern file_ops_t pty_stdin_ops;
+extern file_ops_t pty_stdout_ops;
+
+void pty_init();
+
+int32_t pty_master_open(const uint8_t * filename);
+int32_t pty_master_close(int32_t fd);
+int32_t pty_master_read(int32_t fd, void * buf, int32_t nbytes);
+int32_t pty_master_write(int32_t fd, const void * buf, int32_t nbytes);
+int32_t pty_master_ioctl(int32_t fd, int32_t request, int32_t arg);
+int32_t pty_slave_read(int32_t fd, void * buf, int32_t nbytes);
+int32_t pty_slave_write(int32_t fd, const void * buf, int32_t nbytes);
+int32_t pty_slave_dup(int32_t fd);
+int32_t pty_slave_close(int32_t fd);
+
+#endif // PTY_H
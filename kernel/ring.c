@@ -0,0 +1,107 @@
+#include "ring.h"
+#include "types.h"
+#include "lib.h"
+
+/* ring_init
+ *
+ * DESCRIPTION: Sets up an empty ring over a buffer
+ *
+ * INPUTS: r: the ring
+ *         data: the buffer
+ *         size: size of the buffer, a power of two
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void ring_init(ring_t * r, uint8_t * data, uint32_t size) {
+    r->data = data;
+    r->size = size;
+    r->head = 0;
+    r->tail = 0;
+}
+
+/* ring_put
+ *
+ * DESCRIPTION: Copies as much of a buffer into a ring as fits, in at most
+ *              two pieces
+ *
+ * INPUTS: r: the ring
+ *         buf: bytes to copy
+ *         n: number of bytes to copy
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes copied
+ * SIDE EFFECTS: none
+ */
+uint32_t ring_put(ring_t * r, const uint8_t * buf, uint32_t n) {
+    uint32_t start = r->tail & (r->size - 1);
+    uint32_t first;
+
+    if (n > RING_SPACE(r)) {
+        n = RING_SPACE(r);
+    }
+    first = r->size - start;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(r->data + start, buf, first);
+    memcpy(r->data, buf + first, n - first);
+    r->tail += n;
+    return n;
+}
+
+/* ring_get
+ *
+ * DESCRIPTION: Copies bytes out of a ring, in at most two pieces
+ *
+ * INPUTS: r: the ring
+ *         buf: where to copy to
+ *         n: most bytes to copy
+ *         line: stop after the first '\n' if set
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes copied
+ * SIDE EFFECTS: none
+ */
+uint32_t ring_get(ring_t * r, uint8_t * buf, uint32_t n, int line) {
+    uint32_t start = r->head & (r->size - 1);
+    uint32_t first;
+    uint32_t i;
+
+    if (n > RING_COUNT(r)) {
+        n = RING_COUNT(r);
+    }
+    if (line) {
+        for (i = 0; i < n; i++) {
+            if (r->data[(r->head + i) & (r->size - 1)] == '\n') {
+                n = i + 1;
+                break;
+            }
+        }
+    }
+    first = r->size - start;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(buf, r->data + start, first);
+    memcpy(buf + first, r->data, n - first);
+    r->head += n;
+    return n;
+}
+
+/* ring_has_line
+ *
+ * DESCRIPTION: Checks if a ring holds a whole line
+ *
+ * INPUTS: r: the ring
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if there is a '\n' in the ring, 0 if not
+ * SIDE EFFECTS: none
+ */
+int ring_has_line(ring_t * r) {
+    uint32_t i;
+    for (i = r->head; i != r->tail; i++) {
+        if (r->data[i & (r->size - 1)] == '\n') {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include "types.h"
+
+#ifndef RING_H
+#define RING_H
+
+/* byte ring shared by ptys and pipes. size is a power of two, head and tail
+ * run freely and are masked on use so a full ring needs no spare byte. The
+ * callers keep interrupts off around every call. */
+typedef struct ring {
+    uint8_t * data;
+    uint32_t size;
+    uint32_t head; // next byte to read
+    uint32_t tail; // next byte to write
+} ring_t;
+
+#define RING_COUNT(r) ((r)->tail - (r)->head)
+#define RING_SPACE(r) ((r)->size - RING_COUNT(r))
+
+void ring_init(ring_t * r, uint8_t * data, uint32_t size);
+uint32_t ring_put(ring_t * r, const uint8_t * buf, uint32_t n);
+uint32_t ring_get(ring_t * r, uint8_t * buf, uint32_t n, int line);
+int ring_has_line(ring_t * r);
+
+#endif // RING_H
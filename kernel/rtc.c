@@ -3,11 +3,13 @@
 #include "i8259.h"
 #include "lib.h"
 #include "types.h"
+#include "devfs.h"
+#include "process.h"
 
 static volatile int rtc_enabled_tests = 0; // 0 when screen writing for rtc interrupts is enabled
-static volatile uint16_t rtc_count[MAX_TERMINALS] = {0,0,0};
-static volatile uint16_t max_rtc_count[MAX_TERMINALS] = {ACTUAL_RTC_FREQ / DEFAULT_FREQ, ACTUAL_RTC_FREQ / DEFAULT_FREQ, ACTUAL_RTC_FREQ / DEFAULT_FREQ};
-static volatile uint8_t current_rtc[MAX_TERMINALS] = {0,0,0};
+static volatile uint16_t rtc_count[MAX_TERMINALS];
+static volatile uint16_t max_rtc_count[MAX_TERMINALS]; // set to the default rate in initialize_rtc
+static volatile uint8_t current_rtc[MAX_TERMINALS];
 static int active_terminal = 0;
 /*
 * 0 - no RTC tests
@@ -17,10 +19,18 @@ static int active_terminal = 0;
 */
 static volatile int ENABLE_RTC_TESTS = 0;
 
+static file_ops_t rtc_ops = {
+    .write_func = rtc_write,
+    .read_func = rtc_read,
+    .close_func = rtc_close,
+    .open_func = rtc_open
+};
+
 /* 
  * initialize_rtc
  *   DESCRIPTION: Sends the initialization commands to the RTC device to send
- *              periodic interrupts at 1024 kHz. Enables irq 8 in PIC.
+ *              periodic interrupts at 1024 kHz. Enables irq 8 in PIC and
+ *              registers the device as /dev/rtc.
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: none
@@ -29,8 +39,13 @@ void initialize_rtc() {
     printf("Initializing RTC device \n");
 
     uint8_t rtc_init;
+    int i;
     rtc_enabled_tests = 0;
 
+    for (i = 0; i < MAX_TERMINALS; i++) {
+        max_rtc_count[i] = ACTUAL_RTC_FREQ / DEFAULT_FREQ;
+    }
+
     outb(RTC_NMI_MASK | RTC_REG_B, RTC_PORT); // set the nmi mask, and select reg b
     rtc_init = inb(CMOS_PORT); // get the current value
     outb(RTC_NMI_MASK | RTC_REG_B, RTC_PORT); // select reg b
@@ -43,6 +58,8 @@ void initialize_rtc() {
     rtc_init = inb(CMOS_PORT);
     outb(RTC_REG_A, RTC_PORT);
     outb((rtc_init & RATE_LIMIT_MASK) | DEFAULT_RATE, CMOS_PORT); // makes sure that init A bits are still set
+
+    dev_register((int8_t *) "rtc", &rtc_ops);
 }
 
 /* 
@@ -186,14 +203,21 @@ int rtc_tests_enabled() {
 
 /* 
  * rtc_read
- *   DESCRIPTION: Waits till next user defined rtc interrupt
+ *   DESCRIPTION: Waits till next user defined rtc interrupt. Programs that
+ *                draw through vidmap pace their frames with it, so the
+ *                displayed screen is flushed first to show the frame drawn
+ *                so far. Other processes run while it waits.
  *   INPUTS: none
  *   OUTPUTS: none
  *   RETURN VALUE: 0 for success, never returns is RTC is inactive
  */
 int rtc_read(int fd, void * buf, int nybtes) {
     uint8_t prev = current_rtc[active_terminal]; // get current flag value
-    while(prev == current_rtc[active_terminal]); // check for when flag value changes
+
+    terminal_flush();
+    while(prev == current_rtc[active_terminal]) { // check for when flag value changes
+        process_yield();
+    }
 
     return 0;
 }
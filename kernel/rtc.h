@@ -1,3 +1,5 @@
+#include "terminal.h"
+
 #ifndef _RTC_H
 #define _RTC_H
 
@@ -36,8 +38,6 @@
 #define RTC_TESTS_FREQ 2
 #define RTC_TESTS_DRIVER 3
 
-#define MAX_TERMINALS 3
-
 void set_RTC_ENABLED_TESTS(int val);
 
 void initialize_rtc();
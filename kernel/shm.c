@@ -0,0 +1,156 @@
+#include "shm.h"
+#include "paging.h"
+#include "palloc.h"
+#include "types.h"
+#include "lib.h"
+
+static shm_segment_t segments[MAX_SHM_SEGMENTS];
+
+/* shm_init
+ *
+ * DESCRIPTION: Starts out with no shared memory segments
+ *
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void shm_init() {
+    memset(segments, 0, sizeof(segments));
+}
+
+/* shm_find
+ *
+ * DESCRIPTION: Looks up a segment by name
+ *
+ * INPUTS: name: name of the segment
+ * OUTPUTS: none
+ * RETURN VALUE: the segment, NULL if there is none with that name
+ * SIDE EFFECTS: none
+ */
+static shm_segment_t * shm_find(const int8_t * name) {
+    int i;
+
+    for (i = 0; i < MAX_SHM_SEGMENTS; i++) {
+        if (segments[i].mem != NULL && strncmp(segments[i].name, name, SHM_NAME_LEN + 1) == 0) {
+            return &segments[i];
+        }
+    }
+    return NULL;
+}
+
+/* shm_create
+ *
+ * DESCRIPTION: Makes a zeroed segment
+ *
+ * INPUTS: name: name of the segment, at most SHM_NAME_LEN characters
+ *         num_pages: size of the segment
+ * OUTPUTS: none
+ * RETURN VALUE: the segment, NULL if all are in use or there are no free pages
+ * SIDE EFFECTS: the segment has no users yet
+ */
+static shm_segment_t * shm_create(const int8_t * name, uint32_t num_pages) {
+    int i;
+
+    for (i = 0; i < MAX_SHM_SEGMENTS; i++) {
+        if (segments[i].mem == NULL) {
+            break;
+        }
+    }
+    if (i == MAX_SHM_SEGMENTS || (segments[i].mem = palloc(num_pages)) == NULL) {
+        return NULL;
+    }
+    memset(segments[i].mem, 0, num_pages * PAGE_SIZE);
+    strcpy(segments[i].name, name);
+    segments[i].num_pages = num_pages;
+    segments[i].users = 0;
+    return &segments[i];
+}
+
+/* shm_map
+ *
+ * DESCRIPTION: Maps a segment into the mmap region of a process, the
+ *              segment is made if there is none with that name yet
+ *
+ * INPUTS: pid: the process
+ *         name: name of the segment, at most SHM_NAME_LEN characters
+ *         num_pages: pages to map, the size of a new segment. 0 maps all of
+ *                    an existing one
+ *         first: page of the region to map it at, -1 for the first free run
+ * OUTPUTS: none
+ * RETURN VALUE: first page of the mapping, -1 if the name is too long, the
+ *               segment is smaller, the pages of the region are not free or
+ *               there is no memory for a new segment
+ * SIDE EFFECTS: caller has to flush the TLB if pid is running
+ */
+int32_t shm_map(int32_t pid, const int8_t * name, uint32_t num_pages, int32_t first) {
+    shm_segment_t * seg;
+    uint32_t flags, i;
+
+    if (pid < 0 || pid >= NUM_MMAP_TABLES || strlen(name) == 0 || strlen(name) > SHM_NAME_LEN) {
+        return -1;
+    }
+
+    cli_and_save(flags);
+    seg = shm_find(name);
+    if (num_pages == 0 && seg != NULL) {
+        num_pages = seg->num_pages;
+    }
+    if (num_pages == 0 || num_pages > SHM_MAX_PAGES || (seg != NULL && num_pages > seg->num_pages)) {
+        restore_flags(flags);
+        return -1;
+    }
+
+    if (first == -1) {
+        first = mmap_find_free(pid, num_pages);
+    } else if (first < 0 || first + num_pages > NUM_ENTRIES) {
+        first = -1;
+    } else {
+        for (i = first; i < first + num_pages; i++) {
+            if (mmap_tables[pid][i].val != 0) {
+                first = -1;
+                break;
+            }
+        }
+    }
+    if (first == -1 || (seg == NULL && (seg = shm_create(name, num_pages)) == NULL)) {
+        restore_flags(flags);
+        return -1;
+    }
+
+    for (i = 0; i < num_pages; i++) {
+        mmap_map_page(pid, first + i, (uint32_t) seg->mem + i * PAGE_SIZE, 1, PTE_SHARED);
+    }
+    seg->users += num_pages;
+    restore_flags(flags);
+    return first;
+}
+
+/* shm_put_page
+ *
+ * DESCRIPTION: Drops a mapped page of a segment, the segment is freed when
+ *              no process has any of it mapped anymore
+ *
+ * INPUTS: addr: physical address of the page
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void shm_put_page(uint32_t addr) {
+    uint32_t flags;
+    int i;
+
+    cli_and_save(flags);
+    for (i = 0; i < MAX_SHM_SEGMENTS; i++) {
+        if (segments[i].mem == NULL || addr < (uint32_t) segments[i].mem ||
+            addr >= (uint32_t) segments[i].mem + segments[i].num_pages * PAGE_SIZE) {
+            continue;
+        }
+        if (--segments[i].users == 0) {
+            pfree(segments[i].mem, segments[i].num_pages);
+            segments[i].mem = NULL;
+        }
+        break;
+    }
+    restore_flags(flags);
+}
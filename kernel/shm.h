@@ -0,0 +1,24 @@
+#include "types.h"
+
+#ifndef SHM_H
+#define SHM_H
+
+#define MAX_SHM_SEGMENTS 16
+#define SHM_NAME_LEN 32
+#define SHM_MAX_PAGES 256 // 1 MB, a segment is one run of pages from palloc
+
+/* a named run of pages that any process can map into its mmap region.
+ * users counts the pages of it mapped by all processes together, the
+ * segment is freed once the last one is unmapped */
+typedef struct shm_segment {
+    int8_t name[SHM_NAME_LEN + 1];
+    uint8_t * mem; // from palloc, NULL if the slot is free
+    uint32_t num_pages;
+    uint32_t users;
+} shm_segment_t;
+
+void shm_init();
+int32_t shm_map(int32_t pid, const int8_t * name, uint32_t num_pages, int32_t first);
+void shm_put_page(uint32_t addr);
+
+#endif // SHM_H
@@ -6,44 +6,50 @@
 #include "lib.h"
 #include "x86_desc.h"
 #include "process.h"
+#include "devfs.h"
+#include "procfs.h"
+#include "palloc.h"
+#include "pipe.h"
+#include "shm.h"
+#include "futex.h"
 
 pcb_t * current_pcb_ptr = 0;
-int pid_arr[6] = {0,0,0,0,0,0};
+int pid_arr[MAX_NEXT_PID];
 
-static file_ops_t rtc_ops = {
-    .write_func = rtc_write,
-    .read_func = rtc_read,
-    .close_func = rtc_close,
-    .open_func = rtc_open
-};
 static file_ops_t fs_ops = {
     .write_func = fs_write,
     .read_func = fs_read,
     .close_func = fs_close,
-    .open_func = fs_open
+    .open_func = fs_open,
+    .readv_func = fs_readv
 };
 static file_ops_t dir_ops = {
     .write_func = fs_write,
     .read_func = dir_read,
     .close_func = fs_close,
-    .open_func = fs_open
+    .open_func = fs_open,
+    .getdents_func = dir_getdents
 };
 static file_ops_t stdin_ops = {
     .write_func = NULL,
     .read_func = read_from_terminal,
     .close_func = terminal_close,
-    .open_func = terminal_open
+    .open_func = terminal_open,
+    .ioctl_func = terminal_ioctl
 };
 static file_ops_t stdout_ops = {
     .write_func = write_to_terminal,
     .read_func = NULL,
     .close_func = terminal_close,
-    .open_func = terminal_open
+    .open_func = terminal_open,
+    .writev_func = writev_to_terminal,
+    .ioctl_func = terminal_ioctl
 };
 
 
 
-static file_ops_t* file_ops_array[NUM_FOPS] = {&rtc_ops, &dir_ops, &fs_ops}; 
+// rtc dentries (type 0) are resolved through the device registry instead
+static file_ops_t* file_ops_array[NUM_FOPS] = {NULL, &dir_ops, &fs_ops};
 
 /* set_current_pcb
  * 
@@ -60,6 +66,356 @@ void set_current_pcb(pcb_t * new_pcb) {
     current_pcb_ptr = new_pcb;
 }
 
+/* get_current_pcb
+ * 
+ * DESCRIPTION: Get the current active pcb
+ * 
+ * INPUTS: NONE
+ * OUTPUTS: NONE
+ * RETURN VALUE: pointer to the pcb of the running process, NULL before
+ *               the first process starts
+ * SIDE EFFECTS: NONE
+ */
+pcb_t * get_current_pcb() {
+    return current_pcb_ptr;
+}
+
+/* get_current_process
+ * 
+ * DESCRIPTION: Get the process the running thread belongs to, its pcb has
+ *              the address space, fd table and args of all its threads
+ * 
+ * INPUTS: NONE
+ * OUTPUTS: NONE
+ * RETURN VALUE: pointer to the pcb of the process, NULL before the first
+ *               process starts
+ * SIDE EFFECTS: NONE
+ */
+pcb_t * get_current_process() {
+    return (current_pcb_ptr != NULL) ? current_pcb_ptr->process : NULL;
+}
+
+/* get_pcb
+ * 
+ * DESCRIPTION: Get the pcb of a process by pid
+ * 
+ * INPUTS: pid -- pid of the process
+ * OUTPUTS: NONE
+ * RETURN VALUE: pointer to the pcb, NULL if no process has that pid
+ * SIDE EFFECTS: NONE
+ */
+pcb_t * get_pcb(int pid) {
+    if (pid < 0 || pid >= MAX_NEXT_PID || !pid_arr[pid]) {
+        return NULL;
+    }
+    return (pcb_t*) ((PCB_BOTTOM_MB << MiB_SHIFT) - ((pid + 1) * (PCB_LEN_KB << KiB_SHIFT)));
+}
+
+/* fd_table_pages
+ * 
+ * DESCRIPTION: Gets the number of pages a grown fd table takes up
+ * 
+ * INPUTS: size -- number of entries in the table
+ * OUTPUTS: NONE
+ * RETURN VALUE: pages for the entries and the bitmap behind them
+ * SIDE EFFECTS: NONE
+ */
+static uint32_t fd_table_pages(uint32_t size) {
+    uint32_t bytes = size * sizeof(file_desc_t) + ((size >> FD_WORD_SHIFT) + 1) * sizeof(uint32_t);
+    return (bytes + PALLOC_PAGE_SIZE - 1) / PALLOC_PAGE_SIZE;
+}
+
+/* fd_table_init
+ * 
+ * DESCRIPTION: Points a new process at the fd table inside its pcb, with
+ *              only stdin and stdout open. A shell gets the terminal, other
+ *              programs get what their parent attached with set_child_stdio
+ *              or else the parent's own stdin and stdout.
+ * 
+ * INPUTS: pcb -- the new process
+ *         parent -- the process executing it, NULL for a shell
+ * OUTPUTS: NONE
+ * RETURN VALUE: NONE
+ * SIDE EFFECTS: the parent's attached files move to the new process
+ */
+static void fd_table_init(pcb_t * pcb, pcb_t * parent) {
+    file_desc_t * desc;
+    int i;
+
+    pcb->file_arr = pcb->fd_table_init;
+    pcb->fd_bitmap = (uint32_t *) (pcb->fd_table_init + FD_TABLE_INIT); // fd_bitmap_init
+    pcb->fd_table_size = FD_TABLE_INIT;
+    pcb->fd_first_free = 0;
+    memset(pcb->fd_bitmap, 0, sizeof(pcb->fd_bitmap_init));
+
+    for (i = 0; i < FD_TABLE_INIT; i++) {
+        pcb->file_arr[i].fd = -1;
+    }
+    for (i = FD_STDIN; i <= FD_STDOUT; i++) {
+        desc = &pcb->file_arr[i];
+        if (parent == NULL) {
+            desc->type = 1;
+            desc->ops = (i == FD_STDIN) ? &stdin_ops : &stdout_ops;
+        } else if (parent->child_stdio[i].ops != NULL) { // the parent's reference moves over
+            *desc = parent->child_stdio[i];
+            parent->child_stdio[i].ops = NULL;
+        } else {
+            *desc = parent->file_arr[i];
+            if (desc->ops->dup_func != NULL) {
+                desc->ops->dup_func((int32_t) &desc->file);
+            }
+        }
+        desc->fd = i;
+        pcb->fd_bitmap[0] |= 1 << i;
+        pcb->child_stdio[i].ops = NULL;
+    }
+}
+
+/* close_stdio
+ * 
+ * DESCRIPTION: Drops a process's reference to a stdin or stdout file, which
+ *              sys_close does not take
+ * 
+ * INPUTS: desc -- the fd table entry or attached file
+ * OUTPUTS: NONE
+ * RETURN VALUE: NONE
+ * SIDE EFFECTS: the entry is left without a file
+ */
+static void close_stdio(file_desc_t * desc) {
+    if (desc->ops != NULL && desc->ops->close_func != NULL) {
+        desc->ops->close_func((int32_t) &desc->file);
+    }
+    desc->ops = NULL;
+}
+
+/* drop_child_stdio
+ * 
+ * DESCRIPTION: Closes what a process attached for a program it could not
+ *              execute, so the next one does not get it by surprise
+ * 
+ * INPUTS: pcb -- the process, may be NULL
+ * OUTPUTS: NONE
+ * RETURN VALUE: NONE
+ * SIDE EFFECTS: NONE
+ */
+static void drop_child_stdio(pcb_t * pcb) {
+    int i;
+
+    if (pcb == NULL) {
+        return;
+    }
+    for (i = FD_STDIN; i <= FD_STDOUT; i++) {
+        close_stdio(&pcb->child_stdio[i]);
+    }
+}
+
+/* set_child_stdio
+ * 
+ * DESCRIPTION: Sets what the next program the current process executes gets
+ *              as stdin or stdout, drivers call it from their ioctl
+ * 
+ * INPUTS: fd -- FD_STDIN or FD_STDOUT
+ *         type -- FILE_TYPE_* of the file
+ *         ops -- its file operations
+ *         inode -- what its open_func would have returned
+ * OUTPUTS: NONE
+ * RETURN VALUE: 0 on success, -1 for an invalid fd or without a process
+ * SIDE EFFECTS: replaces a file attached before
+ */
+int32_t set_child_stdio(int fd, int type, file_ops_t * ops, int32_t inode) {
+    file_desc_t * desc;
+    file_desc_t old;
+
+    if (current_pcb_ptr == NULL || fd < FD_STDIN || fd > FD_STDOUT || ops == NULL) {
+        return -1;
+    }
+    desc = &get_current_process()->child_stdio[fd];
+    old = *desc; // dropped last in case it is the same file
+    desc->type = type;
+    desc->file.inode = inode;
+    desc->file.curr_offset = 0;
+    desc->fd = fd;
+    desc->flags = 0;
+    desc->ops = ops;
+    if (ops->dup_func != NULL) {
+        ops->dup_func((int32_t) &desc->file);
+    }
+    close_stdio(&old);
+    return 0;
+}
+
+/* file_users_running
+ * 
+ * DESCRIPTION: Checks if a process that can run has a file open, one that
+ *              waits for the program it executed or in waitpid cannot read
+ *              or write it. The files of a process are in use while any of
+ *              its threads can run.
+ * 
+ * INPUTS: ops -- file operations of the file
+ *         inode -- what its open_func returned
+ * OUTPUTS: NONE
+ * RETURN VALUE: 1 if such a process has it open or attached, 0 if not
+ * SIDE EFFECTS: NONE
+ */
+int file_users_running(file_ops_t * ops, int32_t inode) {
+    pcb_t * pcb;
+    int pid;
+    int i;
+
+    for (pid = 0; pid < MAX_NEXT_PID; pid++) {
+        if ((pcb = get_pcb(pid)) == NULL || !pcb->active || pcb->waiting) {
+            continue;
+        }
+        pcb = pcb->process;
+        for (i = 0; i < pcb->fd_table_size; i++) {
+            if (pcb->file_arr[i].fd != -1 && pcb->file_arr[i].ops == ops && pcb->file_arr[i].file.inode == inode) {
+                return 1;
+            }
+        }
+        for (i = FD_STDIN; i <= FD_STDOUT; i++) {
+            if (pcb->child_stdio[i].ops == ops && pcb->child_stdio[i].file.inode == inode) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* fd_table_release
+ * 
+ * DESCRIPTION: Frees the pages of a grown fd table, the fds have to be
+ *              closed already
+ * 
+ * INPUTS: pcb -- the process
+ * OUTPUTS: NONE
+ * RETURN VALUE: NONE
+ * SIDE EFFECTS: the process is left with the table inside its pcb
+ */
+static void fd_table_release(pcb_t * pcb) {
+    if (pcb->file_arr != pcb->fd_table_init) {
+        pfree(pcb->file_arr, fd_table_pages(pcb->fd_table_size));
+    }
+    pcb->file_arr = pcb->fd_table_init;
+    pcb->fd_bitmap = (uint32_t *) (pcb->fd_table_init + FD_TABLE_INIT); // fd_bitmap_init
+    pcb->fd_table_size = FD_TABLE_INIT;
+}
+
+/* fd_table_grow
+ * 
+ * DESCRIPTION: Moves the fd table to pages with twice as many entries
+ * 
+ * INPUTS: pcb -- the process
+ * OUTPUTS: NONE
+ * RETURN VALUE: 0 on success, -1 if the table is at MAX_FILE_OPEN or
+ *               there is no memory
+ * SIDE EFFECTS: file_arr moves, pointers into the old table are stale
+ */
+static int fd_table_grow(pcb_t * pcb) {
+    uint32_t old_size = pcb->fd_table_size;
+    uint32_t new_size = old_size << 1;
+    file_desc_t * table;
+    uint32_t * bitmap;
+    uint32_t i;
+
+    if (old_size >= MAX_FILE_OPEN) {
+        return -1;
+    }
+    if (NULL == (table = (file_desc_t *) palloc(fd_table_pages(new_size)))) {
+        return -1;
+    }
+    bitmap = (uint32_t *) (table + new_size);
+
+    memcpy(table, pcb->file_arr, old_size * sizeof(file_desc_t));
+    for (i = old_size; i < new_size; i++) {
+        table[i].fd = -1;
+    }
+    memset(bitmap, 0, ((new_size >> FD_WORD_SHIFT) + 1) * sizeof(uint32_t));
+    memcpy(bitmap, pcb->fd_bitmap, ((old_size >> FD_WORD_SHIFT) + 1) * sizeof(uint32_t));
+
+    fd_table_release(pcb);
+    pcb->file_arr = table;
+    pcb->fd_bitmap = bitmap;
+    pcb->fd_table_size = new_size;
+    return 0;
+}
+
+/* fd_alloc
+ * 
+ * DESCRIPTION: Reserves the lowest free fd, growing the table if it is
+ *              full. The entry stays closed (fd -1) until the caller fills
+ *              it in.
+ * 
+ * INPUTS: pcb -- the process
+ * OUTPUTS: NONE
+ * RETURN VALUE: the fd, -1 if the process can't open any more files
+ * SIDE EFFECTS: sets the fd's bit in the bitmap
+ */
+static int fd_alloc(pcb_t * pcb) {
+    uint32_t word, bit;
+    int fd;
+
+    while (1) {
+        // words below fd_first_free are full, and so is most of the table
+        // in a process with lots of fds, so this is a word or two
+        for (word = pcb->fd_first_free; (word << FD_WORD_SHIFT) < pcb->fd_table_size; word++) {
+            if (pcb->fd_bitmap[word] != 0xFFFFFFFF) {
+                break;
+            }
+        }
+        pcb->fd_first_free = word;
+        if ((word << FD_WORD_SHIFT) < pcb->fd_table_size) {
+            asm volatile ("bsfl %1, %0" : "=r"(bit) : "r"(~pcb->fd_bitmap[word]));
+            fd = (word << FD_WORD_SHIFT) + bit;
+            if (fd < pcb->fd_table_size) {
+                pcb->fd_bitmap[word] |= 1 << bit;
+                return fd;
+            }
+        }
+        if (fd_table_grow(pcb)) {
+            return -1;
+        }
+    }
+}
+
+/* fd_free
+ * 
+ * DESCRIPTION: Marks an fd closed so fd_alloc can hand it out again
+ * 
+ * INPUTS: pcb -- the process
+ *         fd -- the fd
+ * OUTPUTS: NONE
+ * RETURN VALUE: NONE
+ * SIDE EFFECTS: NONE
+ */
+static void fd_free(pcb_t * pcb, int fd) {
+    uint32_t word = fd >> FD_WORD_SHIFT;
+
+    pcb->file_arr[fd].fd = -1;
+    pcb->fd_bitmap[word] &= ~(1 << (fd & (FD_BITS_PER_WORD - 1)));
+    if (word < pcb->fd_first_free) {
+        pcb->fd_first_free = word;
+    }
+}
+
+/* get_open_file
+ * 
+ * DESCRIPTION: looks up an open file of the current process
+ * 
+ * INPUTS: fd: file descriptor
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: the file descriptor entry, NULL if fd is not open
+ * SIDE EFFECTS: none
+ */
+static file_desc_t * get_open_file(int fd) {
+    pcb_t * process = get_current_process();
+
+    if (fd < 0 || fd >= process->fd_table_size || process->file_arr[fd].fd == -1) {
+        return NULL;
+    }
+    return &process->file_arr[fd];
+}
+
 /* sys_read
  * 
  * DESCRIPTION: Reads n bytes to a buffer from a file given by file
@@ -79,15 +435,9 @@ int sys_read(int fd, char * buff, int nbytes) {
         return -1;
     }
     //printf("read\n");
-    file_desc_t * desc_ptr;
-
-    if (fd >= MAX_FILE_OPEN || fd < 0) { // if invalid fd, return failure
-        return -1;
-    }
+    file_desc_t * desc_ptr = get_open_file(fd); // get file descriptor
 
-    desc_ptr = &current_pcb_ptr->file_arr[fd]; // get file descriptor
-
-    if (desc_ptr->fd == -1) { //if fd is already closed, return failure
+    if (desc_ptr == NULL) { // if invalid fd or fd is already closed, return failure
         return -1;
     }
 
@@ -120,15 +470,9 @@ int sys_write(int fd, char * buff, int nbytes) {
         return -1;
     }
     //printf("write\n");
-    file_desc_t * desc_ptr;
-
-    if (fd >= MAX_FILE_OPEN || fd < 0) { // if invalid fd, return failure
-        return -1;
-    }
-
-    desc_ptr = &current_pcb_ptr->file_arr[fd]; // get fd
+    file_desc_t * desc_ptr = get_open_file(fd); // get fd
 
-    if(desc_ptr->fd == -1){ // if fd isn't open, return failure
+    if (desc_ptr == NULL) { // if invalid fd or fd isn't open, return failure
         return -1;
     }
 
@@ -153,24 +497,18 @@ int sys_write(int fd, char * buff, int nbytes) {
  */
 int sys_close(int fd) {
     
-    file_desc_t * desc_ptr;
-
-    if (fd >= MAX_FILE_OPEN || fd < MIN_FILE_CLOSE) { // if invalid fd, return failure
-        return -1;
-    }
+    file_desc_t * desc_ptr = get_open_file(fd);
 
-    desc_ptr = &current_pcb_ptr->file_arr[fd];
-
-    if (desc_ptr->fd == -1) { //if fd is already closed, return failure
+    if (desc_ptr == NULL || fd < MIN_FILE_CLOSE) { // if invalid fd or fd is already closed, return failure
         return -1;
     }
 
-    desc_ptr->fd = -1;
+    fd_free(get_current_process(), fd);
 
     if (desc_ptr->ops->close_func == NULL) {
         return -1;
     } else {
-        return (desc_ptr->ops-> close_func) (desc_ptr->fd);
+        return (desc_ptr->ops-> close_func) ((int32_t) &desc_ptr->file);
     }
 
     return -1;
@@ -190,53 +528,127 @@ int sys_close(int fd) {
  */
 int sys_open(char * filename) {
     //printf("open\n");
-    file_desc_t * file_arr = current_pcb_ptr->file_arr;
+    pcb_t * process = get_current_process();
+    file_desc_t * desc_ptr;
+    file_ops_t * ops;
+    int type;
     int fd;
 
     if (!filename) { //check for invalid filename pointer (0 is null pointer)
         return -1;
     }
 
-    for (fd = MIN_FILE_CLOSE; fd<MAX_FILE_OPEN; fd++) { // loop through the pcb (made of 8 entries), start at 2 because 0 and 1 are not dynamically allocated
-        if (file_arr[fd].fd == -1) { // check for open slot
-            break;
+    dentry_t dentry; // dummy dentry
+
+    if (!strncmp(filename, DEV_DIR_NAME, DEV_PREFIX_LEN - 1)) { // anything under /dev comes from the device registry
+        ops = dev_lookup_path((int8_t*)filename);
+        type = FILE_TYPE_DEV;
+    } else if (!strncmp(filename, PROC_DIR_NAME, PROC_PREFIX_LEN - 1)) { // kernel statistics under /proc
+        ops = proc_lookup_path((int8_t*)filename);
+        type = FILE_TYPE_PROC;
+    } else {
+        if (0 != read_dentry_by_name((uint8_t*)filename, &dentry)) { // if read was unsuccessful
+            return -1;
         }
-    }
 
-    if (fd >= MAX_FILE_OPEN || fd < MIN_FILE_CLOSE) { 
-    /*check for invalid fd number, only fd values 2-7 are able to be dynamically allocated, since fd array is size 8 and 0 and 1 are defined as stdin and stdout*/
-        return -1;
-    }
+        type = dentry.filetype;
 
-    dentry_t dentry; // dummy dentry
+        if (dentry.filetype == FILE_TYPE_RTC) {
+            ops = dev_lookup((int8_t*)"rtc");
+        } else if (dentry.filetype < NUM_FOPS && dentry.filetype >= 0){
+            ops = file_ops_array[dentry.filetype];
+        } else {
+            // unknown filetype
+            ops = NULL;
+        }
+    }
 
-    if (0 != read_dentry_by_name((uint8_t*)filename, &dentry)) { // if read was unsuccessful
+    if (ops == NULL) { // no such device or driver never registered
         return -1;
     }
 
-    file_arr[fd].type = dentry.filetype;
-    
-    if (dentry.filetype < NUM_FOPS && dentry.filetype >= 0){
-        file_arr[fd].ops = file_ops_array[dentry.filetype];
-    } else {
-        // unknown filetype
+    // lowest free fd, the table grows when it is full
+    if (-1 == (fd = fd_alloc(process))) {
         return -1;
     }
+    desc_ptr = &process->file_arr[fd];
+    desc_ptr->type = type;
+    desc_ptr->ops = ops;
 
-    if (-1 == (file_arr[fd].file.inode = file_arr[fd].ops->open_func((uint8_t*)filename))) { // call fs open
+    if (-1 == (desc_ptr->file.inode = ops->open_func((uint8_t*)filename))) { // call fs open
+        fd_free(process, fd);
         return -1;
     }
 
-    file_arr[fd].file.curr_offset = 0; // instantiate the current offset to 0
-    file_arr[fd].fd = fd; // set the current fd number (just so it is non-negative)
+    desc_ptr->file.curr_offset = 0; // instantiate the current offset to 0
+    desc_ptr->fd = fd; // set the current fd number (just so it is non-negative)
 
     return fd;
 }
 
 
+/* release_children
+ * 
+ * DESCRIPTION: Lets go of the programs a halting process spawned. Zombies
+ *              are reaped, the ones still running free their pid themselves
+ *              when they halt.
+ * 
+ * INPUTS: pcb -- the halting process
+ * OUTPUTS: NONE
+ * RETURN VALUE: NONE
+ * SIDE EFFECTS: NONE
+ */
+static void release_children(pcb_t * pcb) {
+    pcb_t * child;
+    uint32_t flags;
+    int pid;
+
+    cli_and_save(flags);
+    for (pid = 0; pid < MAX_NEXT_PID; pid++) {
+        if ((child = get_pcb(pid)) == NULL || !child->spawned || child->parent_pcb_ptr != pcb) {
+            continue;
+        }
+        if (child->zombie) {
+            pid_arr[pid] = 0;
+        } else {
+            child->parent_pcb_ptr = NULL;
+        }
+    }
+    restore_flags(flags);
+}
+
+/* release_threads
+ * 
+ * DESCRIPTION: Ends the other threads of a halting process, they never run
+ *              again once their pid is free
+ * 
+ * INPUTS: pcb -- the halting process
+ * OUTPUTS: NONE
+ * RETURN VALUE: NONE
+ * SIDE EFFECTS: their stacks go with the rest of the mmap region
+ */
+static void release_threads(pcb_t * pcb) {
+    pcb_t * thread;
+    uint32_t flags;
+    int pid;
+
+    cli_and_save(flags);
+    for (pid = 0; pid < MAX_NEXT_PID; pid++) {
+        if ((thread = get_pcb(pid)) == NULL || thread == pcb || thread->process != pcb) {
+            continue;
+        }
+        if (thread->futex_key != 0) {
+            futex_cancel(thread);
+        }
+        pid_arr[pid] = 0;
+    }
+    restore_flags(flags);
+}
+
 /* sys_halt
  * 
- * DESCRIPTION: Halts a user program that was executed
+ * DESCRIPTION: Halts a user program that was executed. Called by a thread
+ *              other than the first one it only ends that thread.
  * 
  * INPUTS: retval: return values of the program that was executed
  *         
@@ -248,6 +660,9 @@ int sys_halt(int retval) {
     if (current_pcb_ptr == NULL) {
         while(1) {;}
     }
+    if (current_pcb_ptr->process != current_pcb_ptr) {
+        sys_thread_exit(retval);
+    }
 
     /*
     * 1) Restore Parent Data
@@ -264,9 +679,37 @@ int sys_halt(int retval) {
   */
     {
         int i=0;
-        for (i=0; i<MAX_FILE_OPEN; i++) {
+        for (i=MIN_FILE_CLOSE; i<current_pcb_ptr->fd_table_size; i++) {
+            if (current_pcb_ptr->fd_bitmap[i >> FD_WORD_SHIFT] == 0) { // nothing open in this word
+                i |= FD_BITS_PER_WORD - 1;
+                continue;
+            }
             sys_close(i); // close every fd
         }
+        for (i = FD_STDIN; i <= FD_STDOUT; i++) {
+            close_stdio(&current_pcb_ptr->file_arr[i]);
+        }
+        drop_child_stdio(current_pcb_ptr);
+        fd_table_release(current_pcb_ptr);
+    }
+    release_threads(current_pcb_ptr);
+    clear_mmap_table(current_pcb_ptr->pid); // drop file mappings
+    release_children(current_pcb_ptr);
+
+    /*
+    * A spawned program does not return into its parent, it stays a zombie
+    * with its status until the parent reaps it and the scheduler moves on
+    */
+    if (current_pcb_ptr->spawned) {
+        cli();
+        current_pcb_ptr->active = 0;
+        current_pcb_ptr->exit_status = retval;
+        if (current_pcb_ptr->parent_pcb_ptr == NULL) { // nobody is left to reap it
+            pid_arr[current_pcb_ptr->pid] = 0;
+        } else {
+            current_pcb_ptr->zombie = 1;
+        }
+        go_to_next_process();
     }
 
     /*
@@ -284,6 +727,8 @@ int sys_halt(int retval) {
     */
    video_map_table[((terminal_desc_t *) current_pcb_ptr->terminal)->terminal_id].present = 0;
    ((terminal_desc_t *) (current_pcb_ptr->terminal))->vid_mem_present = 0;
+   terminal_set_vidmapped(((terminal_desc_t *) current_pcb_ptr->terminal)->terminal_id, 0);
+   terminal_set_mode(((terminal_desc_t *) current_pcb_ptr->terminal)->terminal_id, TERM_MODE_DEFAULT); // the shell reads lines
 
    if(get_num_vidmapped() == 0){
         // USER_VIDEO_PDE_INDEX is 33, since program image ends at 132 MB and this is where
@@ -304,6 +749,7 @@ int sys_halt(int retval) {
     }
 
     ((terminal_desc_t *) current_pcb_ptr->terminal)->active_pcb = current_pcb_ptr;
+    current_pcb_ptr->active = 1; // no longer waits in execute
     
 
 
@@ -312,7 +758,7 @@ int sys_halt(int retval) {
    * 2.1) renable paging with old values
    * 2.2) set tss back to what is was before
    */
-    fs_reload_exe(current_pcb_ptr->pid); // reload exe for parent process and reset paging for parent process
+    fs_reload_exe(current_pcb_ptr->process->pid); // reload exe for parent process and reset paging for parent process
     tss.esp0 = ((PCB_BOTTOM_MB << MiB_SHIFT) - ((current_pcb_ptr->pid) * (PCB_LEN_KB << KiB_SHIFT)) - NUM_BYTES_4); // reset kernel esp to parent process kernel esp
 
     /*
@@ -355,7 +801,7 @@ int create_shell(void * t) {
     */
     {
         int i=0;
-        for (i=0; i<3; i++) {
+        for (i=0; i<MAX_NEXT_PID; i++) {
             if (!pid_arr[i]) {
                 pid = i;
                 pid_arr[i] = 1;
@@ -365,9 +811,6 @@ int create_shell(void * t) {
         if (pid == -1) {
             return -1;
         }
-        if (pid > 3) {
-            sti();
-        }
     }
 
     /*
@@ -383,27 +826,21 @@ int create_shell(void * t) {
     new_pcb_ptr = (pcb_t*) ((PCB_BOTTOM_MB << MiB_SHIFT) - ((pid + 1) * (PCB_LEN_KB << KiB_SHIFT))); // set new pcb pointer to 8kb above current process stack pointer
     new_pcb_ptr->pid = pid;
     {
-        int i=0;
         // store ebp and esp in the new pcb pointer
         new_pcb_ptr->saved_ebp = (void *) store_ebp;
         new_pcb_ptr->saved_esp = (void *) store_esp;
 
-        for (i=0; i<MAX_FILE_OPEN; i++) { // through every file open
-            if (!i || i==1) { // if file is stdin or stdout
-                new_pcb_ptr->file_arr[i].fd = i; // store file number
-                new_pcb_ptr->file_arr[i].type = 1;
-            } else {
-                new_pcb_ptr->file_arr[i].fd = -1; // store empty files for the rest
-            }
-        }
-        
-        new_pcb_ptr->file_arr[0].ops = &stdin_ops;
-        new_pcb_ptr->file_arr[1].ops = &stdout_ops;
+        fd_table_init(new_pcb_ptr, NULL); // only stdin and stdout are open
     }
     
     // assuming that our argbuf will always be null terminated
     strcpy(new_pcb_ptr->arg_buf, arg_buf);
     new_pcb_ptr->arg_buf_len = arg_buf_len;
+    strcpy(new_pcb_ptr->name, "shell");
+    new_pcb_ptr->ticks = 0;
+    new_pcb_ptr->brk = 0;
+    new_pcb_ptr->futex_key = 0;
+    new_pcb_ptr->process = new_pcb_ptr;
 
     new_pcb_ptr->active = 1; // set new pcb to active
     new_pcb_ptr->parent_pcb_ptr = (void *) NULL; // new process is going to be child of the current process 
@@ -416,17 +853,21 @@ int create_shell(void * t) {
     // current_pcb_ptr = new_pcb_ptr; // current process is now the new process we inestantiated
 }
 
-/* sys_execute
+/* load_program
  * 
- * DESCRIPTION: attempts to execute a user program by name
+ * DESCRIPTION: Sets up a process for a command: gets a pid, loads the
+ *              executable into its program page and fills in its pcb. The
+ *              new process is not running yet.
  * 
- * INPUTS: buffer: the command we want to execute
- *         
+ * INPUTS: buffer: the command, the program name and its arguments
+ *         pcb_out: where the new pcb is returned
  * OUTPUTS: None
- * RETURN VALUE: integer. doesn't return and goes to halt if all goes correctly, -1 if the string command cannot be executed 
- * SIDE EFFECTS: copies the exe file to the proper location, flushes paging, enters ring 3, runs the program.
+ * RETURN VALUE: integer. 0 on success, -1 if the string command cannot be executed,
+ *               2 if there is no free pid
+ * SIDE EFFECTS: copies the exe file to the proper location, paging is left
+ *               on the new program's page
  */
-int sys_execute (const void * buffer) {
+static int load_program(const void * buffer, pcb_t ** pcb_out) {
     
     // pointer to the new pcb
     pcb_t * new_pcb_ptr;
@@ -439,16 +880,12 @@ int sys_execute (const void * buffer) {
     uint32_t arg_buf_len = 1;
     int pid = -1;
 
-    // store the command
-    register uint32_t store_ebp asm("ebp");
-    register uint32_t store_esp asm("esp");
-
     /*
     * looks through pid array to get the next available pid
     */
     {
         int i=0;
-        for (i=0; i<6; i++) {
+        for (i=0; i<MAX_NEXT_PID; i++) {
             if (!pid_arr[i]) {
                 pid = i;
                 pid_arr[i] = 1;
@@ -457,12 +894,15 @@ int sys_execute (const void * buffer) {
         }
         if (pid == -1) {
             write_to_terminal(1, "Max processes reached.\n", strlen("Max processes reached.\n"));
+            drop_child_stdio(get_current_process());
             return 2;
         }
         // if (pid > 3) {
         //     //sti();
         // }
     }
+    new_pcb_ptr = (pcb_t*) ((PCB_BOTTOM_MB << MiB_SHIFT) - ((pid + 1) * (PCB_LEN_KB << KiB_SHIFT))); // set new pcb pointer to 8kb above current process stack pointer
+    new_pcb_ptr->active = 0; // the scheduler leaves it alone until it is set up
 
     /*
     * Parse Args:
@@ -521,6 +961,7 @@ int sys_execute (const void * buffer) {
 
         if (inode_num == -1) { // if file is invalid, return failure
             pid_arr[pid] = 0;
+            drop_child_stdio(get_current_process());
             return -1;
         }
 
@@ -529,6 +970,7 @@ int sys_execute (const void * buffer) {
         retval = fs_read((int32_t) &cmd_file, (void *) (&file_buf), FILE_MAGIC_LEN); // read 4 bytes from file
         if (retval != FILE_MAGIC_LEN || file_buf != FILE_MAGIC) { // if we didn't read 4 bytes, or magic number is invalid, return invalid
             pid_arr[pid] = 0;
+            drop_child_stdio(get_current_process());
             return -1;
         }
    }
@@ -543,38 +985,67 @@ int sys_execute (const void * buffer) {
     * Setup PCB
     *   5.1) Basically initialize a chunk of address that is 8kb with bottom at 8MB - (process# * 8kb)
     */
-    new_pcb_ptr = (pcb_t*) ((PCB_BOTTOM_MB << MiB_SHIFT) - ((pid + 1) * (PCB_LEN_KB << KiB_SHIFT))); // set new pcb pointer to 8kb above current process stack pointer
     new_pcb_ptr->pid = pid;
-    {
-        int i=0;
-        // store ebp and esp in the new pcb pointer
-        new_pcb_ptr->saved_ebp = (void *) store_ebp;
-        new_pcb_ptr->saved_esp = (void *) store_esp;
-
-        for (i=0; i<MAX_FILE_OPEN; i++) { // through every file open
-            if (!i || i==1) { // if file is stdin or stdout
-                new_pcb_ptr->file_arr[i].fd = i; // store file number
-                new_pcb_ptr->file_arr[i].type = 1;
-            } else {
-                new_pcb_ptr->file_arr[i].fd = -1; // store empty files for the rest
-            }
-        }
-        
-        new_pcb_ptr->file_arr[0].ops = &stdin_ops;
-        new_pcb_ptr->file_arr[1].ops = &stdout_ops;
-    }
+    fd_table_init(new_pcb_ptr, get_current_process()); // only stdin and stdout are open
     
     // assuming that our argbuf will always be null terminated
     strcpy(new_pcb_ptr->arg_buf, arg_buf);
     new_pcb_ptr->arg_buf_len = arg_buf_len;
+    strncpy(new_pcb_ptr->name, cmd, FILENAME_LEN);
+    new_pcb_ptr->name[FILENAME_LEN] = '\0';
+    new_pcb_ptr->ticks = 0;
+    new_pcb_ptr->brk = 0;
+
+    new_pcb_ptr->started = 0;
+    new_pcb_ptr->spawned = 0;
+    new_pcb_ptr->zombie = 0;
+    new_pcb_ptr->exit_status = 0;
+    new_pcb_ptr->waiting = 0;
+    new_pcb_ptr->futex_key = 0;
+    new_pcb_ptr->process = new_pcb_ptr;
+    if (current_pcb_ptr != NULL) {
+        new_pcb_ptr->terminal = current_pcb_ptr->terminal;
+    }
+    new_pcb_ptr->parent_pcb_ptr = (void *) current_pcb_ptr; // new process is going to be child of the current process 
+
+    *pcb_out = new_pcb_ptr;
+    return 0;
+}
+
+/* sys_execute
+ * 
+ * DESCRIPTION: attempts to execute a user program by name
+ * 
+ * INPUTS: buffer: the command we want to execute
+ *         
+ * OUTPUTS: None
+ * RETURN VALUE: integer. doesn't return and goes to halt if all goes correctly, -1 if the string command cannot be executed 
+ * SIDE EFFECTS: copies the exe file to the proper location, flushes paging, enters ring 3, runs the program.
+ */
+int sys_execute (const void * buffer) {
+    
+    // pointer to the new pcb
+    pcb_t * new_pcb_ptr;
+    int retval;
+
+    // store the command
+    register uint32_t store_ebp asm("ebp");
+    register uint32_t store_esp asm("esp");
+
+    if (0 != (retval = load_program(buffer, &new_pcb_ptr))) {
+        return retval;
+    }
+
+    // store ebp and esp in the new pcb pointer
+    new_pcb_ptr->saved_ebp = (void *) store_ebp;
+    new_pcb_ptr->saved_esp = (void *) store_esp;
+    new_pcb_ptr->started = 1; // goes into user space right here
 
     new_pcb_ptr->active = 1; // set new pcb to active
     if (current_pcb_ptr != NULL) { // if current pcb is there, meaning we have an active user process
         current_pcb_ptr->active = 0; // set it to inactive
-        new_pcb_ptr->terminal = current_pcb_ptr->terminal;
     }
     ((terminal_desc_t *) (new_pcb_ptr->terminal))->active_pcb = new_pcb_ptr;
-    new_pcb_ptr->parent_pcb_ptr = (void *) current_pcb_ptr; // new process is going to be child of the current process 
 
     current_pcb_ptr = new_pcb_ptr; // current process is now the new process we inestantiated
 
@@ -588,7 +1059,7 @@ int sys_execute (const void * buffer) {
 
     tss.ss0 = KERNEL_DS; // set tss stack segment to the kernel segment
     // new kernel esp is pointing at 8MB - (process# * 8kb)
-    tss.esp0 = ((PCB_BOTTOM_MB << MiB_SHIFT) - ((pid) * (PCB_LEN_KB << KiB_SHIFT)) - NUM_BYTES_4); // set esp to kernel stack of new process
+    tss.esp0 = ((PCB_BOTTOM_MB << MiB_SHIFT) - ((new_pcb_ptr->pid) * (PCB_LEN_KB << KiB_SHIFT)) - NUM_BYTES_4); // set esp to kernel stack of new process
 
     execute_asm(); // call the asm function
 
@@ -607,18 +1078,20 @@ int sys_execute (const void * buffer) {
  * SIDE EFFECTS: None
  */
 int sys_getargs(char * buff, int nbytes) {
+    pcb_t * process = get_current_process();
+
     // buffer given to us is null
     if (buff == NULL) { return -1; }
     // no arguments
-    if (current_pcb_ptr->arg_buf[0] == '\0') {
+    if (process->arg_buf[0] == '\0') {
         return -1;
     }
     // buffer too large
-    if (current_pcb_ptr->arg_buf_len > nbytes) {
+    if (process->arg_buf_len > nbytes) {
         return -1;
     }
 
-    strncpy(buff, current_pcb_ptr->arg_buf, current_pcb_ptr->arg_buf_len);
+    strncpy(buff, process->arg_buf, process->arg_buf_len);
     return 0;
 }
 
@@ -649,10 +1122,11 @@ int sys_vidmap(char ** screen_start) {
     }
 
     curr_terminal_ptr->vid_mem_present = 1;
+    terminal_set_vidmapped(curr_terminal_ptr->terminal_id, 1);
 
     // except the entry we control, which will be the first one
+    // the terminal keeps the page pointed at its screen
     video_map_table[curr_terminal_ptr->terminal_id].present = 1;
-    video_map_table[curr_terminal_ptr->terminal_id].page_base_address = VIDEO_ADDR + (get_displayed_terminal()+1) * (get_displayed_terminal() != curr_terminal_ptr->terminal_id) ;   
 
     // modified paging, flush the TLB
     flush_tlb();
@@ -689,3 +1163,873 @@ int sys_sigreturn() {
     return -1;
 }
 
+
+/* sys_mmap
+ * 
+ * DESCRIPTION: maps the data blocks of an open file read-only into the
+ *              process' mmap region, so it can be scanned without read()
+ *              copying it. Other files that can be mapped, like pipe
+ *              ends, do it their own way.
+ * 
+ * INPUTS: fd: open regular file to map
+ *         start: set to the user address of the first byte of the file
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: length of the file in bytes, -1 if the file can't be mapped
+ *               (not a regular file, region full, filesystem not in memory)
+ * SIDE EFFECTS: adds entries to the process' mmap page table
+ */
+int sys_mmap(int fd, uint8_t ** start) {
+    int32_t pid = get_current_process()->pid;
+    file_desc_t * desc_ptr = get_open_file(fd);
+    int32_t length, first;
+    uint32_t num_pages, i, addr;
+
+    if ((int)start < USER_PROGRAM_START || (int)start > USER_PROGRAM_START + MB_4_PAGE_SIZE - sizeof(uint8_t *)) {
+        return -1;
+    }
+    if (desc_ptr != NULL && desc_ptr->type != FILE_TYPE_FILE && desc_ptr->ops->mmap_func != NULL) {
+        return desc_ptr->ops->mmap_func((int32_t) &desc_ptr->file, start);
+    }
+    if (desc_ptr == NULL || desc_ptr->type != FILE_TYPE_FILE) {
+        return -1;
+    }
+    if (-1 == (length = read_file_length(desc_ptr->file.inode))) {
+        return -1;
+    }
+    num_pages = (length + (1 << PAGE_SHIFT) - 1) >> PAGE_SHIFT;
+    if (-1 == (first = mmap_find_free(pid, num_pages))) {
+        return -1;
+    }
+
+    for (i = 0; i < num_pages; i++) {
+        if (read_block_addr(desc_ptr->file.inode, i, &addr)) {
+            mmap_unmap(pid, first, i);
+            return -1;
+        }
+        mmap_map_page(pid, first + i, addr, 0, 0); // the filesystem is read only
+    }
+    set_mmap_table(pid);
+    flush_tlb();
+
+    *start = (uint8_t *) (USER_MMAP_START + (first << PAGE_SHIFT));
+    return length;
+}
+
+/* sys_munmap
+ * 
+ * DESCRIPTION: removes a mapping made by sys_mmap, pages that came from a
+ *              pipe go back to the page pool
+ * 
+ * INPUTS: start: address sys_mmap returned
+ *         length: length sys_mmap returned
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if the range is not in the mmap region or
+ *               has a page that is neither mapped nor reserved
+ * SIDE EFFECTS: removes entries from the process' mmap page table
+ */
+int sys_munmap(uint8_t * start, int32_t length) {
+    uint32_t first = ((uint32_t) start - USER_MMAP_START) >> PAGE_SHIFT;
+    uint32_t num_pages = (length + (1 << PAGE_SHIFT) - 1) >> PAGE_SHIFT;
+
+    if ((uint32_t) start < USER_MMAP_START || ((uint32_t) start & ((1 << PAGE_SHIFT) - 1)) || length < 0) {
+        return -1;
+    }
+    // heap pages go back through sbrk, and a hole is not a mapping
+    if (!mmap_range_mapped(get_current_process()->pid, first, num_pages)) {
+        return -1;
+    }
+    mmap_unmap(get_current_process()->pid, first, num_pages);
+    flush_tlb();
+    return 0;
+}
+
+/* bad_user_range
+ * 
+ * DESCRIPTION: checks that a buffer lies inside the user program page, or in
+ *              writable pages of the mmap region or heap
+ * 
+ * INPUTS: buf: start of the buffer
+ *         len: size of the buffer
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if the kernel must not touch the buffer, 0 if it may
+ * SIDE EFFECTS: none
+ */
+static int bad_user_range(const void * buf, uint32_t len) {
+    uint32_t start = (uint32_t) buf;
+    if (start >= USER_MMAP_START) {
+        return !mmap_range_writable(get_current_process()->pid, start, len);
+    }
+    return start < USER_PROGRAM_START || len > MB_4_PAGE_SIZE ||
+        start > USER_PROGRAM_START + MB_4_PAGE_SIZE - len;
+}
+
+/* sys_lseek
+ * 
+ * DESCRIPTION: moves the read position of an open regular file
+ * 
+ * INPUTS: fd: file descriptor
+ *         offset: new position, relative to whence
+ *         whence: SEEK_SET (start), SEEK_CUR (current position) or SEEK_END
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: the new position, -1 for invalid arguments or a position
+ *               before the start of the file
+ * SIDE EFFECTS: positions past the end are allowed, reads there return 0
+ */
+int sys_lseek(int fd, int32_t offset, int whence) {
+    file_desc_t * desc_ptr = get_open_file(fd);
+    int32_t base;
+
+    if (desc_ptr == NULL || desc_ptr->type != FILE_TYPE_FILE) {
+        return -1;
+    }
+    switch (whence) {
+        case SEEK_SET:
+            base = 0;
+            break;
+        case SEEK_CUR:
+            base = desc_ptr->file.curr_offset;
+            break;
+        case SEEK_END:
+            if (-1 == (base = read_file_length(desc_ptr->file.inode))) {
+                return -1;
+            }
+            break;
+        default:
+            return -1;
+    }
+    if ((offset < 0 && base + offset < 0) || (offset > 0 && base + offset < base)) {
+        return -1;
+    }
+    desc_ptr->file.curr_offset = base + offset;
+    return desc_ptr->file.curr_offset;
+}
+
+/* sys_pread
+ * 
+ * DESCRIPTION: reads from a given position of an open regular file,
+ *              without using or moving the file's read position
+ * 
+ * INPUTS: fd: file descriptor
+ *         buff: buffer we want to read into
+ *         nbytes: number of bytes we want to read
+ *         offset: position in the file to read from
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes read, 0 at or past the end of the file,
+ *               -1 for invalid arguments
+ * SIDE EFFECTS: fills buff
+ */
+int sys_pread(int fd, char * buff, int nbytes, int32_t offset) {
+    file_desc_t * desc_ptr = get_open_file(fd);
+
+    if (desc_ptr == NULL || desc_ptr->type != FILE_TYPE_FILE) {
+        return -1;
+    }
+    if (nbytes < 0 || offset < 0 || bad_user_range(buff, nbytes)) {
+        return -1;
+    }
+    return read_data(desc_ptr->file.inode, offset, (uint8_t *) buff, nbytes);
+}
+
+/* fill_stat
+ * 
+ * DESCRIPTION: fills a stat structure
+ * 
+ * INPUTS: buf: the structure
+ *         type: FILE_TYPE_* of the file
+ *         inode: inode of the file, only used for filesystem files
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if the inode can't be read
+ * SIDE EFFECTS: none
+ */
+static int fill_stat(stat_t * buf, uint32_t type, uint32_t inode) {
+    int32_t length = 0;
+
+    if (type == FILE_TYPE_FILE && -1 == (length = read_file_length(inode))) {
+        return -1;
+    }
+    buf->size = length;
+    buf->type = type;
+    buf->inode = (type == FILE_TYPE_FILE) ? inode : 0;
+    return 0;
+}
+
+/* sys_stat
+ * 
+ * DESCRIPTION: gets the size, type and inode of a file by name
+ * 
+ * INPUTS: filename: name of the file, may be in /dev or /proc
+ *         buf: structure to fill
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if there is no such file
+ * SIDE EFFECTS: fills buf
+ */
+int sys_stat(char * filename, stat_t * buf) {
+    dentry_t dentry;
+
+    if (filename == NULL || bad_user_range(buf, sizeof(stat_t))) {
+        return -1;
+    }
+    if (!strncmp(filename, DEV_DIR_NAME, DEV_PREFIX_LEN - 1)) {
+        return (dev_lookup_path((int8_t*)filename) == NULL) ? -1 : fill_stat(buf, FILE_TYPE_DEV, 0);
+    }
+    if (!strncmp(filename, PROC_DIR_NAME, PROC_PREFIX_LEN - 1)) {
+        return (proc_lookup_path((int8_t*)filename) == NULL) ? -1 : fill_stat(buf, FILE_TYPE_PROC, 0);
+    }
+    if (0 != read_dentry_by_name((uint8_t*)filename, &dentry)) {
+        return -1;
+    }
+    return fill_stat(buf, dentry.filetype, dentry.inode_num);
+}
+
+/* sys_fstat
+ * 
+ * DESCRIPTION: gets the size, type and inode of an open file
+ * 
+ * INPUTS: fd: file descriptor
+ *         buf: structure to fill
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if fd is not open
+ * SIDE EFFECTS: fills buf
+ */
+int sys_fstat(int fd, stat_t * buf) {
+    file_desc_t * desc_ptr = get_open_file(fd);
+
+    if (desc_ptr == NULL || bad_user_range(buf, sizeof(stat_t))) {
+        return -1;
+    }
+    // stdin and stdout are the terminal device unless they are a pipe
+    if ((fd == FD_STDIN || fd == FD_STDOUT) && desc_ptr->type != FILE_TYPE_PIPE) {
+        return fill_stat(buf, FILE_TYPE_DEV, 0);
+    }
+    return fill_stat(buf, desc_ptr->type, desc_ptr->file.inode);
+}
+
+/* sys_getdents
+ * 
+ * DESCRIPTION: reads as many entries of an open directory as fit in the
+ *              buffer, each a dirent_t followed by the name
+ * 
+ * INPUTS: fd: file descriptor of the directory
+ *         buf: buffer we want to read the entries into
+ *         nbytes: size of buf
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: number of bytes filled in, 0 once every entry was read,
+ *               -1 if fd is not a directory or buf can't hold the next entry
+ * SIDE EFFECTS: advances the directory's position past the entries read
+ */
+int sys_getdents(int fd, void * buf, int nbytes) {
+    file_desc_t * desc_ptr = get_open_file(fd);
+
+    if (desc_ptr == NULL || desc_ptr->ops->getdents_func == NULL) {
+        return -1;
+    }
+    if (nbytes < 0 || bad_user_range(buf, nbytes)) {
+        return -1;
+    }
+    return desc_ptr->ops->getdents_func((int32_t) &desc_ptr->file, buf, nbytes);
+}
+
+/* copy_iovec
+ * 
+ * DESCRIPTION: copies a user iovec array into the kernel and checks every
+ *              buffer in it
+ * 
+ * INPUTS: iov: the user array
+ *         iovcnt: number of buffers
+ *         kiov: array of IOV_MAX entries to copy into
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if the array or a buffer is outside the
+ *               user program page or iovcnt is out of range
+ * SIDE EFFECTS: none
+ */
+static int copy_iovec(const iovec_t * iov, int iovcnt, iovec_t * kiov) {
+    int i;
+
+    if (iovcnt < 0 || iovcnt > IOV_MAX || bad_user_range(iov, iovcnt * sizeof(iovec_t))) {
+        return -1;
+    }
+    memcpy(kiov, iov, iovcnt * sizeof(iovec_t));
+    for (i = 0; i < iovcnt; i++) {
+        if (kiov[i].len < 0 || bad_user_range(kiov[i].base, kiov[i].len)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* sys_readv
+ * 
+ * DESCRIPTION: reads into several buffers with one system call, filling
+ *              each buffer before moving on to the next
+ * 
+ * INPUTS: fd: file descriptor of file we want to read from
+ *         iov: the buffers, at most IOV_MAX
+ *         iovcnt: number of buffers
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: total number of bytes read, -1 on failure
+ * SIDE EFFECTS: populates the buffers
+ */
+int sys_readv(int fd, const iovec_t * iov, int iovcnt) {
+    file_desc_t * desc_ptr = get_open_file(fd);
+    iovec_t kiov[IOV_MAX];
+    int total = 0;
+    int read, i;
+
+    if (desc_ptr == NULL || copy_iovec(iov, iovcnt, kiov)) {
+        return -1;
+    }
+    if (desc_ptr->ops->readv_func != NULL) {
+        return desc_ptr->ops->readv_func((int32_t) &desc_ptr->file, kiov, iovcnt);
+    }
+    if (desc_ptr->ops->read_func == NULL) {
+        return -1;
+    }
+
+    // one read per buffer, a short read ends the call like it would end a read loop
+    for (i = 0; i < iovcnt; i++) {
+        read = desc_ptr->ops->read_func((int32_t) &desc_ptr->file, kiov[i].base, kiov[i].len);
+        if (read == -1) {
+            return (total == 0) ? -1 : total;
+        }
+        total += read;
+        if (read < kiov[i].len) {
+            break;
+        }
+    }
+    return total;
+}
+
+/* sys_writev
+ * 
+ * DESCRIPTION: writes several buffers with one system call, in order
+ * 
+ * INPUTS: fd: file descriptor of file we want to write to
+ *         iov: the buffers, at most IOV_MAX
+ *         iovcnt: number of buffers
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: total number of bytes written, -1 on failure
+ * SIDE EFFECTS: none
+ */
+int sys_writev(int fd, const iovec_t * iov, int iovcnt) {
+    file_desc_t * desc_ptr = get_open_file(fd);
+    iovec_t kiov[IOV_MAX];
+    int total = 0;
+    int i;
+
+    if (desc_ptr == NULL || copy_iovec(iov, iovcnt, kiov)) {
+        return -1;
+    }
+    if (desc_ptr->ops->writev_func != NULL) {
+        return desc_ptr->ops->writev_func((int32_t) &desc_ptr->file, kiov, iovcnt);
+    }
+    if (desc_ptr->ops->write_func == NULL) {
+        return -1;
+    }
+
+    // some drivers return 0 instead of a count from write, so count the buffers
+    for (i = 0; i < iovcnt; i++) {
+        if (-1 == desc_ptr->ops->write_func((int32_t) &desc_ptr->file, kiov[i].base, kiov[i].len)) {
+            return (total == 0) ? -1 : total;
+        }
+        total += kiov[i].len;
+    }
+    return total;
+}
+
+/* sys_ioctl
+ * 
+ * DESCRIPTION: passes a device specific request to an open file, terminals
+ *              use it to switch between canonical and raw input
+ * 
+ * INPUTS: fd: file descriptor of the device
+ *         request: what the device should do
+ *         arg: argument of the request
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: depends on the request, -1 if the file takes no requests
+ * SIDE EFFECTS: none
+ */
+int sys_ioctl(int fd, int request, int arg) {
+    file_desc_t * desc_ptr = get_open_file(fd);
+
+    if (desc_ptr == NULL || desc_ptr->ops->ioctl_func == NULL) {
+        return -1;
+    }
+    return desc_ptr->ops->ioctl_func((int32_t) &desc_ptr->file, request, arg);
+}
+
+/* sys_pipe
+ * 
+ * DESCRIPTION: makes a pipe and opens both of its ends
+ * 
+ * INPUTS: fds: array of two ints, gets the fd of the read end and then
+ *              the fd of the write end
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if fds is invalid or there is no free
+ *               pipe or fd
+ * SIDE EFFECTS: none
+ */
+int sys_pipe(int * fds) {
+    static file_ops_t * const end_ops[2] = {&pipe_read_ops, &pipe_write_ops};
+    pcb_t * process = get_current_process();
+    file_desc_t * desc_ptr;
+    file_object_t file;
+    int fd[2];
+    int i;
+
+    if (bad_user_range(fds, 2 * sizeof(int))) {
+        return -1;
+    }
+    if (-1 == (file.inode = pipe_create())) {
+        return -1;
+    }
+
+    for (i = 0; i < 2; i++) {
+        if (-1 == (fd[i] = fd_alloc(process))) {
+            if (i == 1) {
+                fd_free(process, fd[0]);
+            }
+            pipe_read_close((int32_t) &file);
+            pipe_write_close((int32_t) &file);
+            return -1;
+        }
+    }
+    // the table may have grown for the second fd, so fill both in afterwards
+    for (i = 0; i < 2; i++) {
+        desc_ptr = &process->file_arr[fd[i]];
+        desc_ptr->type = FILE_TYPE_PIPE;
+        desc_ptr->ops = end_ops[i];
+        desc_ptr->file.inode = file.inode;
+        desc_ptr->file.curr_offset = 0;
+        desc_ptr->flags = 0;
+        desc_ptr->fd = fd[i];
+        fds[i] = fd[i];
+    }
+    return 0;
+}
+
+/* sys_spawn
+ * 
+ * DESCRIPTION: Starts a user program next to the calling one. It runs when
+ *              the scheduler gets to it, the caller reaps it with waitpid.
+ * 
+ * INPUTS: buffer: the command we want to run
+ *         
+ * OUTPUTS: None
+ * RETURN VALUE: pid of the new process, -1 if the command cannot be executed
+ *               or there is no free pid
+ * SIDE EFFECTS: the stdin and stdout attached for the next program go to it
+ */
+int sys_spawn(const void * buffer) {
+    pcb_t * new_pcb_ptr;
+
+    if (current_pcb_ptr == NULL || buffer == NULL) {
+        return -1;
+    }
+    if (0 != load_program(buffer, &new_pcb_ptr)) {
+        return -1;
+    }
+    fs_reload_exe(current_pcb_ptr->process->pid); // the program was loaded through its own page
+
+    new_pcb_ptr->parent_pcb_ptr = (void *) current_pcb_ptr->process; // any thread of the process can reap it
+    new_pcb_ptr->spawned = 1;
+    new_pcb_ptr->active = 1; // the scheduler can start it now
+    return new_pcb_ptr->pid;
+}
+
+/* sys_waitpid
+ * 
+ * DESCRIPTION: Reaps a program the caller spawned once it has halted. Other
+ *              processes run while it waits.
+ * 
+ * INPUTS: pid: pid of the child, -1 for any child
+ *         status: where the value the child halted with is stored, can be NULL
+ *         options: WNOHANG to return right away if no child has halted yet
+ *         
+ * OUTPUTS: None
+ * RETURN VALUE: pid of the reaped child, 0 with WNOHANG if none has halted,
+ *               -1 if there is no such child or status is invalid
+ * SIDE EFFECTS: the child's pid can be used again
+ */
+int sys_waitpid(int pid, int * status, int options) {
+    pcb_t * self = current_pcb_ptr;
+    pcb_t * process = get_current_process();
+    pcb_t * child;
+    uint32_t flags;
+    int found;
+    int i;
+
+    if (self == NULL || (status != NULL && bad_user_range(status, sizeof(int)))) {
+        return -1;
+    }
+    while (1) {
+        found = 0;
+        cli_and_save(flags);
+        for (i = 0; i < MAX_NEXT_PID; i++) {
+            if ((child = get_pcb(i)) == NULL || !child->spawned || child->parent_pcb_ptr != process ||
+                (pid != -1 && pid != i)) {
+                continue;
+            }
+            found = 1;
+            if (child->zombie) {
+                if (status != NULL) {
+                    *status = child->exit_status;
+                }
+                pid_arr[i] = 0;
+                restore_flags(flags);
+                return i;
+            }
+        }
+        restore_flags(flags);
+        if (!found) {
+            return -1;
+        }
+        if (options & WNOHANG) {
+            return 0;
+        }
+        self->waiting = 1;
+        process_yield();
+        self->waiting = 0;
+    }
+}
+
+/* sys_sbrk
+ * 
+ * DESCRIPTION: Grows or shrinks the heap of the process. New pages are
+ *              reserved and only get memory when they are first touched,
+ *              pages the heap shrinks out of are freed.
+ * 
+ * INPUTS: increment: bytes to add to the heap, negative to give back
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: address of the old end of the heap, -1 if the heap would
+ *               leave its 4 MB
+ * SIDE EFFECTS: changes the process' heap page table
+ */
+int sys_sbrk(int32_t increment) {
+    pcb_t * process = get_current_process();
+    uint32_t old_brk = process->brk;
+    uint32_t new_brk = old_brk + increment;
+    uint32_t old_pages = (old_brk + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    uint32_t new_pages = (new_brk + PAGE_SIZE - 1) >> PAGE_SHIFT;
+
+    if ((increment < 0 && (uint32_t) -increment > old_brk) ||
+        (increment > 0 && (uint32_t) increment > MB_4_PAGE_SIZE - old_brk)) {
+        return -1;
+    }
+    if (new_pages > old_pages) {
+        mmap_reserve_zero(process->pid, NUM_ENTRIES + old_pages, new_pages - old_pages);
+    } else if (new_pages < old_pages) {
+        mmap_unmap(process->pid, NUM_ENTRIES + new_pages, old_pages - new_pages);
+        flush_tlb();
+    }
+    process->brk = new_brk;
+    return USER_HEAP_START + old_brk;
+}
+
+/* sys_mmap_anon
+ * 
+ * DESCRIPTION: Maps zeroed memory into the mmap region. The pages only get
+ *              memory when they are first touched, munmap gives them back.
+ * 
+ * INPUTS: length: bytes to map, rounded up to whole pages
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: address of the mapping, -1 if there is no room for it
+ * SIDE EFFECTS: changes the process' mmap page table
+ */
+int sys_mmap_anon(int32_t length) {
+    int32_t pid = get_current_process()->pid;
+    uint32_t num_pages;
+    int32_t first;
+
+    if (length <= 0 || length > MB_4_PAGE_SIZE) {
+        return -1;
+    }
+    num_pages = (length + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    if (-1 == (first = mmap_find_free(pid, num_pages))) {
+        return -1;
+    }
+    mmap_reserve_zero(pid, first, num_pages);
+    return USER_MMAP_START + (first << PAGE_SHIFT);
+}
+
+/* sys_shm_map
+ * 
+ * DESCRIPTION: Maps a shared memory segment, making it if no process has
+ *              one with that name yet. Every process that maps it sees the
+ *              same pages, munmap drops the mapping again.
+ * 
+ * INPUTS: name: name of the segment, at most SHM_NAME_LEN characters
+ *         size: bytes to map, the size of a new segment. 0 maps all of an
+ *               existing one
+ *         addr: page aligned address in the mmap region to map it at, NULL
+ *               to let the kernel pick one
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: address of the mapping, -1 on failure
+ * SIDE EFFECTS: changes the process' mmap page table
+ */
+int sys_shm_map(const int8_t * name, int32_t size, uint8_t * addr) {
+    int8_t kname[SHM_NAME_LEN + 2];
+    int32_t first = -1;
+    int i;
+
+    if (name == NULL || size < 0) {
+        return -1;
+    }
+    if (addr != NULL) {
+        if ((uint32_t) addr < USER_MMAP_START || ((uint32_t) addr & (PAGE_SIZE - 1)) ||
+            (uint32_t) addr >= USER_MMAP_START + NUM_ENTRIES * PAGE_SIZE) {
+            return -1;
+        }
+        first = ((uint32_t) addr - USER_MMAP_START) >> PAGE_SHIFT;
+    }
+    // a byte at a time, a short name may end right before an unmapped page
+    for (i = 0; i <= SHM_NAME_LEN; i++) {
+        if (bad_user_range(name + i, 1)) {
+            return -1;
+        }
+        if ((kname[i] = name[i]) == '\0') {
+            break;
+        }
+    }
+    kname[SHM_NAME_LEN + 1] = '\0'; // too long, shm_map rejects it
+
+    first = shm_map(get_current_process()->pid, kname, (size + PAGE_SIZE - 1) >> PAGE_SHIFT, first);
+    if (first == -1) {
+        return -1;
+    }
+    flush_tlb();
+    return USER_MMAP_START + (first << PAGE_SHIFT);
+}
+
+/* sys_futex_wait
+ * 
+ * DESCRIPTION: Sleeps until futex_wake is called on the same word, if it
+ *              still holds the expected value. Checking the word and going
+ *              to sleep happen with interrupts off so a wake in between
+ *              cannot be missed.
+ * 
+ * INPUTS: addr: 4 byte aligned word in the program page, mmap region or heap
+ *         expected: value the caller last saw in it
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: 0 once woken, -1 if the word changed already or is invalid
+ * SIDE EFFECTS: the scheduler skips the process while it sleeps
+ */
+int sys_futex_wait(int32_t * addr, int32_t expected) {
+    pcb_t * self = current_pcb_ptr;
+    uint32_t flags;
+
+    if (self == NULL || ((uint32_t) addr & (sizeof(int32_t) - 1)) || bad_user_range(addr, sizeof(int32_t))) {
+        return -1;
+    }
+    cli_and_save(flags);
+    if (*addr != expected) { // reading it maps a demand-zero page, so it has an address below
+        restore_flags(flags);
+        return -1;
+    }
+    futex_queue(self, virt_to_phys((uint32_t) addr));
+    while (self->futex_key != 0) {
+        restore_flags(flags);
+        process_yield();
+        cli_and_save(flags);
+    }
+    restore_flags(flags);
+    return 0;
+}
+
+/* sys_futex_wake
+ * 
+ * DESCRIPTION: Wakes processes sleeping in futex_wait on a word, any
+ *              address the same physical word is mapped at counts
+ * 
+ * INPUTS: addr: 4 byte aligned word in the program page, mmap region or heap
+ *         n: most processes to wake
+ *         
+ * OUTPUTS: none
+ * RETURN VALUE: number of processes woken, -1 if the word is invalid
+ * SIDE EFFECTS: none
+ */
+int sys_futex_wake(int32_t * addr, int32_t n) {
+    uint32_t key;
+
+    if (((uint32_t) addr & (sizeof(int32_t) - 1)) || bad_user_range(addr, sizeof(int32_t)) || n < 0) {
+        return -1;
+    }
+    if ((key = virt_to_phys((uint32_t) addr)) == 0) { // never touched, nobody can wait on it
+        return 0;
+    }
+    return futex_wake_key(key, n);
+}
+
+/* sys_thread_create
+ * 
+ * DESCRIPTION: Starts another thread in the calling process. It shares the
+ *              program page, mmap region, heap and files, and gets its own
+ *              kernel stack and a demand-zero user stack in the mmap region.
+ *              It runs when the scheduler gets to it, as start(arg).
+ * 
+ * INPUTS: start: function the thread runs, in the program page
+ *         arg: passed to start
+ *         ret: where start returns to, the library passes a stub that
+ *              calls thread_exit with the return value
+ *         
+ * OUTPUTS: None
+ * RETURN VALUE: tid of the new thread, -1 if there is no free pid or no
+ *               room for its stack
+ * SIDE EFFECTS: the thread counts as a process in the pid table
+ */
+int sys_thread_create(void * start, void * arg, void * ret) {
+    pcb_t * process = get_current_process();
+    pcb_t * thread;
+    uint32_t * stack;
+    uint32_t flags;
+    int32_t first;
+    int pid = -1;
+    int i;
+
+    if (process == NULL || (uint32_t) start < USER_PROGRAM_START ||
+        (uint32_t) start >= USER_PROGRAM_START + MB_4_PAGE_SIZE) {
+        return -1;
+    }
+
+    cli_and_save(flags);
+    for (i = 0; i < MAX_NEXT_PID; i++) {
+        if (!pid_arr[i]) {
+            pid = i;
+            break;
+        }
+    }
+    if (pid == -1 || -1 == (first = mmap_find_free(process->pid, THREAD_STACK_PAGES))) {
+        restore_flags(flags);
+        return -1;
+    }
+    pid_arr[pid] = 1;
+    mmap_reserve_zero(process->pid, first, THREAD_STACK_PAGES);
+
+    thread = (pcb_t*) ((PCB_BOTTOM_MB << MiB_SHIFT) - ((pid + 1) * (PCB_LEN_KB << KiB_SHIFT)));
+    thread->pid = pid;
+    thread->process = process;
+    thread->parent_pcb_ptr = (void *) process;
+    thread->terminal = current_pcb_ptr->terminal;
+
+    // the files are the process's, a thread has none of its own
+    thread->file_arr = thread->fd_table_init;
+    thread->fd_bitmap = (uint32_t *) (thread->fd_table_init + FD_TABLE_INIT); // fd_bitmap_init
+    thread->fd_table_size = 0;
+    thread->fd_first_free = 0;
+    thread->child_stdio[FD_STDIN].ops = NULL;
+    thread->child_stdio[FD_STDOUT].ops = NULL;
+    thread->arg_buf[0] = '\0';
+    thread->arg_buf_len = 1;
+    strcpy(thread->name, process->name);
+    thread->ticks = 0;
+    thread->brk = 0;
+
+    thread->started = 0;
+    thread->spawned = 0;
+    thread->zombie = 0;
+    thread->exit_status = 0;
+    thread->waiting = 0;
+    thread->futex_key = 0;
+
+    // start(arg) as if called from ret, touching the stack maps its top page
+    stack = (uint32_t *) (USER_MMAP_START + ((first + THREAD_STACK_PAGES) << PAGE_SHIFT));
+    stack[-1] = (uint32_t) arg;
+    stack[-2] = (uint32_t) ret;
+    thread->thread_eip = (uint32_t) start;
+    thread->thread_esp = (uint32_t) &stack[-2];
+    thread->thread_stack = first;
+
+    thread->active = 1; // the scheduler can start it now
+    restore_flags(flags);
+    return pid;
+}
+
+/* sys_thread_exit
+ * 
+ * DESCRIPTION: Ends the calling thread, it stays a zombie with its status
+ *              until another thread of the process joins it
+ * 
+ * INPUTS: retval: status for thread_join
+ *         
+ * OUTPUTS: None
+ * RETURN VALUE: does not return, -1 for the first thread of a process, which
+ *               ends with halt
+ * SIDE EFFECTS: its user stack is freed
+ */
+int sys_thread_exit(int retval) {
+    pcb_t * self = current_pcb_ptr;
+
+    if (self == NULL || self->process == self) {
+        return -1;
+    }
+    cli();
+    mmap_unmap(self->process->pid, self->thread_stack, THREAD_STACK_PAGES);
+    flush_tlb();
+    self->active = 0;
+    self->exit_status = retval;
+    self->zombie = 1;
+    go_to_next_process();
+
+    // the scheduler never comes back to it
+    return -1;
+}
+
+/* sys_thread_join
+ * 
+ * DESCRIPTION: Waits for another thread of the process to exit and reaps
+ *              it. Other processes run while it waits.
+ * 
+ * INPUTS: tid: the thread, as thread_create returned it
+ *         status: where the value the thread exited with is stored, can be NULL
+ *         
+ * OUTPUTS: None
+ * RETURN VALUE: 0 once the thread is reaped, -1 if tid is not another thread
+ *               of the process or status is invalid
+ * SIDE EFFECTS: the thread's pid can be used again
+ */
+int sys_thread_join(int tid, int * status) {
+    pcb_t * self = current_pcb_ptr;
+    pcb_t * thread;
+    uint32_t flags;
+
+    if (self == NULL || (status != NULL && bad_user_range(status, sizeof(int)))) {
+        return -1;
+    }
+    while (1) {
+        cli_and_save(flags);
+        if ((thread = get_pcb(tid)) == NULL || thread == self || thread->process == thread ||
+            thread->process != self->process) {
+            restore_flags(flags);
+            return -1;
+        }
+        if (thread->zombie) {
+            if (status != NULL) {
+                *status = thread->exit_status;
+            }
+            pid_arr[tid] = 0;
+            restore_flags(flags);
+            return 0;
+        }
+        restore_flags(flags);
+        self->waiting = 1;
+        process_yield();
+        self->waiting = 0;
+    }
+}
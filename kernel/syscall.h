@@ -10,8 +10,11 @@
 
 #define NUM_FOPS 3
 
-#define MAX_FILE_OPEN 8
+#define MAX_FILE_OPEN 4096 // per process, the fd table grows up to this
 #define MIN_FILE_CLOSE 2
+#define FD_TABLE_INIT 8 // fds that fit in the pcb before the table has to grow
+#define FD_BITS_PER_WORD 32
+#define FD_WORD_SHIFT 5
 
 #define PCB_LEN_KB 8
 #define PCB_BOTTOM_MB 8
@@ -23,11 +26,15 @@
 
 #define ARG_BUF_SIZE 1024
 
+#define IOV_MAX 32 // most buffers one readv or writev takes
+
 #define USER_PROGRAM_START 0x8000000
 #define MB_4_PAGE_SIZE 0x400000
 #define USER_VIDEO_PDE_INDEX 33
 
-#define MAX_NEXT_PID 6
+#define MAX_NEXT_PID 22 // program pages run from 8 MB up to the page pool at 96 MB
+
+#define THREAD_STACK_PAGES 16 // user stack of a thread, in the mmap region of its process
 
 
 /* fd array: (diagram taken from MP3 doc)
@@ -35,51 +42,121 @@
  *  ________________________________________________________________
  * | stdin | stdout |       |       |       |       |       |       |
  * |_______|________|_______|_______|_______|_______|_______|_______|
+ *
+ * the first FD_TABLE_INIT entries live in the pcb. Once they are used up
+ * the table is moved to palloc pages twice the size, up to MAX_FILE_OPEN.
+ * A bitmap with a bit set for every open fd finds the lowest free fd a
+ * word at a time.
  */
 #define FD_STDIN 0
 #define FD_STDOUT 1
 
+/* file_desc_t types, the first three match the dentry filetype */
+#define FILE_TYPE_RTC 0
+#define FILE_TYPE_DIR 1
+#define FILE_TYPE_FILE 2
+#define FILE_TYPE_DEV 3
+#define FILE_TYPE_PROC 4
+#define FILE_TYPE_PIPE 5
+
+/* sys_lseek whence values */
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+
+/* waitpid options */
+#define WNOHANG 1 // return 0 instead of waiting if no child has halted yet
+
 typedef int32_t (*read_func_t)(int32_t fd , void* buf, int32_t nbytes);
 typedef int32_t (*write_func_t)(int fd, const void* string_to_write, int n_chars);
 typedef int32_t (*open_func_t)(const uint8_t* filename);
 typedef int32_t (*close_func_t)(int32_t fd);
+typedef int32_t (*getdents_func_t)(int32_t fd, void* buf, int32_t nbytes);
+typedef int32_t (*readv_func_t)(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+typedef int32_t (*writev_func_t)(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+typedef int32_t (*ioctl_func_t)(int32_t fd, int32_t request, int32_t arg);
+typedef int32_t (*dup_func_t)(int32_t fd);
+typedef int32_t (*mmap_func_t)(int32_t fd, uint8_t ** start);
 
 typedef struct file_ops {
     read_func_t read_func;
     write_func_t write_func;
     open_func_t open_func;
     close_func_t close_func;
+    getdents_func_t getdents_func; // NULL unless the file is a directory
+    readv_func_t readv_func; // NULL to fall back to one read_func per buffer
+    writev_func_t writev_func; // NULL to fall back to one write_func per buffer
+    ioctl_func_t ioctl_func; // NULL if the file takes no ioctl requests
+    dup_func_t dup_func; // NULL unless the file counts the processes that have it open
+    mmap_func_t mmap_func; // NULL unless a file other than a regular one can be mapped
 } file_ops_t;
 
 typedef struct __attribute__ ((packed)) file_desc {
-    int type; // 0 for rtc, 1 for keyboard, 2 for file
+    int type; // 0 for rtc, 1 for keyboard, 2 for file, 3 for device, 4 for proc, 5 for pipe
     file_object_t file;
     int fd;
     int flags;
     file_ops_t* ops;
 } file_desc_t;
 
+/* filled in by sys_stat and sys_fstat, matches struct ece391_stat */
+typedef struct stat {
+    uint32_t size; // bytes, 0 for devices and proc files
+    uint32_t type; // FILE_TYPE_*
+    uint32_t inode; // 0 if the file is not in the filesystem
+} stat_t;
+
 typedef struct __attribute__ ((packed)) pcb {
     int pid;
     void * parent_pcb_ptr;
-    file_desc_t file_arr[MAX_FILE_OPEN];
+    file_desc_t * file_arr; // fd_table_init or palloc pages
+    uint32_t * fd_bitmap; // follows file_arr, bit set if the fd is open
+    uint32_t fd_table_size; // number of entries in file_arr
+    uint32_t fd_first_free; // bitmap word to start looking for a free fd in
+    file_desc_t fd_table_init[FD_TABLE_INIT];
+    uint32_t fd_bitmap_init[FD_TABLE_INIT / FD_BITS_PER_WORD + 1]; // has to follow fd_table_init
     void * saved_esp;
     void * saved_ebp;
     int active;
+    int started; // has been in user space, the scheduler starts it with execute_asm otherwise
+    void * sched_esp; // where the scheduler switched away from it
+    void * sched_ebp;
+    int spawned; // started with spawn, halting makes it a zombie instead of returning to the parent
+    int zombie; // halted, kept until the parent reaps it with waitpid
+    int exit_status;
+    int waiting; // in a blocking waitpid, it cannot use its files until a child halts
+    uint32_t futex_key; // physical address of the word it sleeps on in futex_wait, 0 while it can run
+    void * futex_next; // next sleeper in its futex bucket
+    struct pcb * process; // owns the address space, fd table and args, the pcb itself unless it is a thread
+    uint32_t thread_eip; // where a thread enters user space
+    uint32_t thread_esp;
+    int32_t thread_stack; // first mmap page of a thread's user stack
     void * terminal;
     int8_t arg_buf[ARG_BUF_SIZE];
     // the length of the arg buffer *with* \0
     uint32_t arg_buf_len;
+    int8_t name[FILENAME_LEN + 1]; // command the process was started with
+    uint32_t ticks; // PIT ticks this process was running for
+    uint32_t brk; // bytes of heap from USER_HEAP_START handed out by sbrk
+    file_desc_t child_stdio[FD_STDOUT + 1]; // stdin and stdout for the next program executed, ops NULL to pass on our own
 } pcb_t;
 
+extern int pid_arr[MAX_NEXT_PID];
+
 extern int create_shell(void * t);
 extern void set_current_pcb(pcb_t * new_pcb);
+extern pcb_t * get_current_pcb();
+extern pcb_t * get_current_process();
+extern pcb_t * get_pcb(int pid);
+extern int32_t set_child_stdio(int fd, int type, file_ops_t * ops, int32_t inode);
+extern int file_users_running(file_ops_t * ops, int32_t inode);
 
 extern int sys_execute(const void * buf);
 extern void execute_asm();
 
 extern int sys_halt(int retval);
 extern void halt_asm(void * prev_ebp, void * prev_esp, int retval);
+extern void thread_start_asm(uint32_t eip, uint32_t esp);
 
 extern int sys_read(int fd, char * buff, int nbytes);
 extern int sys_write(int fd, char * buff, int nbytes);
@@ -89,4 +166,25 @@ extern int sys_getargs(char * buff, int nbytes);
 extern int sys_vidmap(char ** screen_start);
 extern int sys_set_handler(int32_t signum, void* handler_address);
 extern int sys_sigreturn();
+extern int sys_mmap(int fd, uint8_t ** start);
+extern int sys_munmap(uint8_t * start, int32_t length);
+extern int sys_lseek(int fd, int32_t offset, int whence);
+extern int sys_pread(int fd, char * buff, int nbytes, int32_t offset);
+extern int sys_stat(char * filename, stat_t * buf);
+extern int sys_fstat(int fd, stat_t * buf);
+extern int sys_getdents(int fd, void * buf, int nbytes);
+extern int sys_readv(int fd, const iovec_t * iov, int iovcnt);
+extern int sys_writev(int fd, const iovec_t * iov, int iovcnt);
+extern int sys_ioctl(int fd, int request, int arg);
+extern int sys_pipe(int * fds);
+extern int sys_spawn(const void * buf);
+extern int sys_waitpid(int pid, int * status, int options);
+extern int sys_sbrk(int32_t increment);
+extern int sys_mmap_anon(int32_t length);
+extern int sys_shm_map(const int8_t * name, int32_t size, uint8_t * addr);
+extern int sys_futex_wait(int32_t * addr, int32_t expected);
+extern int sys_futex_wake(int32_t * addr, int32_t n);
+extern int sys_thread_create(void * start, void * arg, void * ret);
+extern int sys_thread_exit(int retval);
+extern int sys_thread_join(int tid, int * status);
 #endif
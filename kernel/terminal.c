@@ -4,29 +4,58 @@
 #include "keyboard.h"
 #include "process.h"
 #include "lib.h"
+#include "devfs.h"
+#include "paging.h"
+#include "kstat.h"
+#include "palloc.h"
 
-static volatile int terminal_mode[MAX_TERMINALS];
+#define TERM_PAGES(bytes) (((bytes) + PALLOC_PAGE_SIZE - 1) / PALLOC_PAGE_SIZE)
+#define TERM_STATE_PAGES TERM_PAGES(sizeof(terminal_t))
+#define TERM_MEM_PAGES TERM_PAGES(VIDEO_MEM_SIZE)
+#define TERM_SCROLLBACK_PAGES TERM_PAGES(TERM_SCROLLBACK_ROWS * sizeof(scrollback_row_t))
 
-static volatile char buffer[MAX_TERMINALS][KB_BUFFER_SIZE]; //circular buffer array
-static volatile uint8_t buffer_start[MAX_TERMINALS]; //start of buffer
-static volatile uint8_t buffer_idx[MAX_TERMINALS]; //next place to add a char
-static volatile uint8_t buffer_full[MAX_TERMINALS]; //0 - buffer is not full, 1 - buffer is full
-static volatile int max_chars = KB_BUFFER_SIZE;
-
-static volatile int pointer_x[MAX_TERMINALS]; //next x pos to write a char
-static volatile int pointer_y[MAX_TERMINALS]; //next y pos to write a char
+/* Each terminal's state lives in a terminal_t, see terminal.h. Terminal 0 is the boot
+ * console, it is part of the kernel image so printing works before palloc is set up.
+ * The others are allocated from palloc the first time they are opened.
+ */
+static uint8_t console_mem[VIDEO_MEM_SIZE] __attribute__((aligned(4096)));
+static scrollback_row_t console_scrollback[TERM_SCROLLBACK_ROWS];
+static terminal_t console = {
+    .mem = console_mem,
+    .scrollback = console_scrollback,
+    .kb_mode = KBMODE_TERMINAL_WRITE,
+    .flags = TERM_MODE_DEFAULT
+};
+static terminal_t * terms[MAX_TERMINALS] = {&console}; //NULL until the terminal is opened
 
 static volatile int tab_width = 4; //number of spaces per tab
 static char* video_mem = (char *)VIDEO; //array of chars representing video memory
 
 static int start_row = 0; //top row to write characters to, the text to terminal driver will always print until the bottom of the screen
 
+/* VGA color for each ANSI color number */
+static uint8_t ansi_colors[VT_NUM_COLORS] = {0x0, 0x4, 0x2, 0x6, 0x1, 0x5, 0x3, 0x7};
+
+static uint32_t dirty_rows[DIRTY_WORDS]; //rows of the displayed terminal's screen memory that VGA memory is behind on
+static int shown_start = -1; //row the CRTC start address points at
+static int shown_cursor = -1; //cell the CRTC cursor is on
+static int view_dirty = 0; //the displayed terminal's view moved and has to be drawn again
+
 static volatile int displayed_terminal = 0;
 static volatile int active_buffer = 0;
 
 #define COLOR_LEN 4
 static int colors[COLOR_LEN] = {PURPLE, GREEN, CYAN, BLUE};
 
+static file_ops_t terminal_ops = {
+    .write_func = write_to_terminal,
+    .read_func = read_from_terminal,
+    .close_func = terminal_close,
+    .open_func = terminal_open,
+    .writev_func = writev_to_terminal,
+    .ioctl_func = terminal_ioctl
+};
+
 
 int32_t get_color_from_idx(int idx){
     int32_t color = GRAY;
@@ -36,59 +65,373 @@ int32_t get_color_from_idx(int idx){
     return color;
 }
 
-/**void update_cursor(int x, int y)
-{
-	uint16_t pos = y * NUM_COLS + x;
- 
-	outb(CURSOR_CMD_PORT, CURSOR_X_KEY);
-	outb(CURSOR_RW_PORT, (uint8_t) (pos & LOWER_BYTES_FITLER));
-	outb(CURSOR_CMD_PORT, CURSOR_Y_KEY);
-	outb(CURSOR_RW_PORT, (uint8_t) ((pos >> HIGH_BYTES_TO_LOW) & LOWER_BYTES_FITLER));
-}*/
+/* update_cursor
+ * 
+ * DESCRIPTION: Moves the blinking cursor of the displayed terminal.
+ * 
+ * INPUTS: x, y -- column and row on the screen
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
 void update_cursor(int x, int y)
 {
-	uint16_t pos = y * NUM_COLS + x;
+	uint16_t pos = (terms[displayed_terminal]->origin + y) * NUM_COLS + x;
  
-	outb(0x3D4, 0x0F);
-	outb(0x3D5, (uint8_t) (pos & 0xFF));
-	outb(0x3D4, 0x0E);
-	outb(0x3D5, (uint8_t) ((pos >> 8) & 0xFF));
+	outb(CRTC_CURSOR_LOW, CRTC_INDEX_PORT);
+	outb((uint8_t) (pos & 0xFF), CRTC_DATA_PORT);
+	outb(CRTC_CURSOR_HIGH, CRTC_INDEX_PORT);
+	outb((uint8_t) ((pos >> 8) & 0xFF), CRTC_DATA_PORT);
+}
+
+/* set_screen_start
+ * 
+ * DESCRIPTION: Points the VGA CRTC at the row of video memory to show at the top of the screen.
+ * 
+ * INPUTS: row -- row of video memory
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: The screen shows video memory starting at row.
+ */
+static void set_screen_start(int row){
+    uint16_t pos = row * NUM_COLS;
+
+    outb(CRTC_START_LOW, CRTC_INDEX_PORT);
+    outb((uint8_t) (pos & 0xFF), CRTC_DATA_PORT);
+    outb(CRTC_START_HIGH, CRTC_INDEX_PORT);
+    outb((uint8_t) ((pos >> 8) & 0xFF), CRTC_DATA_PORT);
+}
+
+/* mark_dirty
+ * 
+ * DESCRIPTION: Notes that rows of a terminal's screen changed. Only the displayed terminal is tracked,
+ *              a switch redraws the whole screen.
+ * 
+ * INPUTS: buf_idx -- index of the terminal
+ *         y       -- first row on the screen
+ *         n       -- number of rows
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: The rows get copied to VGA memory by the next terminal_flush.
+ */
+static void mark_dirty(int buf_idx, int y, int n){
+    int row;
+
+    if(buf_idx != displayed_terminal){
+        return;
+    }
+    for(row = terms[buf_idx]->origin + y; row < terms[buf_idx]->origin + y + n; row++){
+        dirty_rows[row >> DIRTY_WORD_SHIFT] |= 1 << (row & (DIRTY_WORD_BITS - 1));
+    }
 }
 
+/* cell
+ * 
+ * DESCRIPTION: Finds the character and attribute of a position on a terminal's screen.
+ * 
+ * INPUTS: buf_idx -- index of the terminal
+ *         x, y    -- column and row on the screen
+ * OUTPUTS: none
+ * RETURN VALUE: pointer to the cell, character in the low byte and attribute in the high byte
+ * SIDE EFFECTS: none
+ */
+static uint16_t * cell(int buf_idx, int x, int y){
+    return (uint16_t *) (terms[buf_idx]->mem + (((terms[buf_idx]->origin + y) * NUM_COLS + x) << 1));
+}
 
+/* term_attrib
+ * 
+ * DESCRIPTION: Finds the attribute new characters on a terminal get.
+ * 
+ * INPUTS: buf_idx -- index of the terminal
+ * OUTPUTS: none
+ * RETURN VALUE: the attribute set with SGR, or the terminal's color
+ * SIDE EFFECTS: none
+ */
+static uint8_t term_attrib(int buf_idx){
+    if(terms[buf_idx]->attrib & ATTRIB_SET){
+        return (uint8_t) terms[buf_idx]->attrib;
+    }
+    return get_color_from_idx(buf_idx);
+}
 
+/* make_cell
+ * 
+ * DESCRIPTION: Builds a cell showing a character in a terminal's color.
+ * 
+ * INPUTS: c       -- character
+ *         buf_idx -- index of the terminal
+ * OUTPUTS: none
+ * RETURN VALUE: the cell
+ * SIDE EFFECTS: none
+ */
+static uint16_t make_cell(char c, int buf_idx){
+    return (uint8_t) c | (term_attrib(buf_idx) << 8);
+}
+
+/* terminal_init
+ * 
+ * DESCRIPTION: Points the boot console's vidmap page at its screen memory and registers the terminal as /dev/terminal.
+ * 
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: adds the terminal to the device table
+ */
+void terminal_init(){
+    video_map_table[0].page_base_address = ((uint32_t) console.mem) >> PAGE_SHIFT; // only present while a program has it vidmapped
+    dev_register((int8_t *) "terminal", &terminal_ops);
+}
+
+/* terminal_create
+ * 
+ * DESCRIPTION: Opens a terminal. Its state, screen memory and scrollback are allocated from palloc
+ *              and its vidmap page is pointed at the screen memory. It starts out blank, in canonical
+ *              mode with echo.
+ * 
+ * INPUTS: terminal_num -- index of the terminal
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success or if the terminal is already open, -1 for a bad index or when out of memory
+ * SIDE EFFECTS: none
+ */
+int terminal_create(int terminal_num){
+    terminal_t * t;
+    uint8_t * mem;
+    scrollback_row_t * rows;
+
+    if(terminal_num < 0 || terminal_num >= MAX_TERMINALS){
+        return -1;
+    }
+    if(terms[terminal_num] != NULL){
+        return 0;
+    }
+    t = palloc(TERM_STATE_PAGES);
+    mem = palloc(TERM_MEM_PAGES);
+    rows = palloc(TERM_SCROLLBACK_PAGES);
+    if(t == NULL || mem == NULL || rows == NULL){
+        pfree(t, TERM_STATE_PAGES);
+        pfree(mem, TERM_MEM_PAGES);
+        pfree(rows, TERM_SCROLLBACK_PAGES);
+        return -1;
+    }
+
+    memset(t, 0, sizeof(terminal_t));
+    t->mem = mem;
+    t->scrollback = rows;
+    t->kb_mode = KBMODE_TERMINAL_WRITE;
+    t->flags = TERM_MODE_DEFAULT;
+    video_map_table[terminal_num].page_base_address = ((uint32_t) mem) >> PAGE_SHIFT; // only present while a program has it vidmapped
+    terms[terminal_num] = t;
+    memset_word(mem, make_cell(' ', terminal_num), VIDEO_MEM_SIZE / 2);
+    return 0;
+}
+
+/* terminal_exists
+ * 
+ * DESCRIPTION: Checks if a terminal has been opened.
+ * 
+ * INPUTS: terminal_num -- index of the terminal
+ * OUTPUTS: none
+ * RETURN VALUE: 1 if it is open, 0 if not
+ * SIDE EFFECTS: none
+ */
+int terminal_exists(int terminal_num){
+    return terminal_num >= 0 && terminal_num < MAX_TERMINALS && terms[terminal_num] != NULL;
+}
+
+/* draw_view
+ * 
+ * DESCRIPTION: Draws the part of a terminal's scrollback and screen that view_offset points at
+ *              into the rows of VGA memory on screen.
+ * 
+ * INPUTS: buf_idx -- index of the displayed terminal
+ * OUTPUTS: Writes to VGA memory.
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void draw_view(int buf_idx){
+    scrollback_row_t * packed;
+    uint16_t * dst;
+    int top = terms[buf_idx]->scrollback_count - terms[buf_idx]->view_offset; //line at the top, counting from the oldest scrollback row
+    int line, x, y;
+
+    for(y = 0; y < NUM_ROWS; y++){
+        line = top + y;
+        dst = (uint16_t *) (video_mem + (terms[buf_idx]->origin + y) * ROW_BYTES);
+        if(line < terms[buf_idx]->scrollback_count){
+            packed = &terms[buf_idx]->scrollback[(terms[buf_idx]->scrollback_head - terms[buf_idx]->scrollback_count + line + TERM_SCROLLBACK_ROWS) % TERM_SCROLLBACK_ROWS];
+            for(x = 0; x < NUM_COLS; x++){
+                dst[x] = (uint8_t) packed->text[x] | (packed->attrib << 8);
+            }
+        }else{
+            memcpy(dst, cell(buf_idx, 0, line - terms[buf_idx]->scrollback_count), ROW_BYTES);
+        }
+    }
+    kstat.term_flushed_rows += NUM_ROWS;
+}
+
+/* scrollback_push
+ * 
+ * DESCRIPTION: Saves a row that is about to scroll off a terminal's screen in its scrollback,
+ *              replacing the oldest row once the scrollback is full.
+ * 
+ * INPUTS: buf_idx -- index of the terminal
+ *         y       -- row on the screen
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: A terminal showing its scrollback keeps showing the same rows.
+ */
+static void scrollback_push(int buf_idx, int y){
+    scrollback_row_t * packed = &terms[buf_idx]->scrollback[terms[buf_idx]->scrollback_head];
+    uint16_t * src = cell(buf_idx, 0, y);
+    int x;
+
+    packed->attrib = src[0] >> 8;
+    for(x = 0; x < NUM_COLS; x++){
+        packed->text[x] = src[x];
+    }
+    terms[buf_idx]->scrollback_head = (terms[buf_idx]->scrollback_head + 1) % TERM_SCROLLBACK_ROWS;
+    if(terms[buf_idx]->scrollback_count < TERM_SCROLLBACK_ROWS){
+        terms[buf_idx]->scrollback_count += 1;
+    }
+    if(terms[buf_idx]->view_offset != 0 && terms[buf_idx]->view_offset < terms[buf_idx]->scrollback_count){
+        terms[buf_idx]->view_offset += 1;
+    }
+}
+
+/* terminal_scroll_view
+ * 
+ * DESCRIPTION: Moves the displayed terminal's view through its scrollback. Back to
+ *              0 shows the live screen again.
+ * 
+ * INPUTS: rows -- rows to move back, negative to move forward
+ * OUTPUTS: Redraws the screen.
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void terminal_scroll_view(int rows){
+    uint32_t flags;
+    int buf_idx, offset;
+
+    cli_and_save(flags);
+    buf_idx = displayed_terminal;
+    offset = terms[buf_idx]->view_offset + rows;
+    if(offset > terms[buf_idx]->scrollback_count){
+        offset = terms[buf_idx]->scrollback_count;
+    }
+    if(offset < 0){
+        offset = 0;
+    }
+    if(offset != terms[buf_idx]->view_offset){
+        terms[buf_idx]->view_offset = offset;
+        if(offset == 0){
+            mark_dirty(buf_idx, 0, NUM_ROWS);
+        }else{
+            view_dirty = 1;
+        }
+        terminal_flush();
+    }
+    restore_flags(flags);
+}
+
+/* terminal_flush
+ * 
+ * DESCRIPTION: Brings the screen up to date with the displayed terminal. Copies its dirty rows
+ *              to VGA memory and moves the CRTC start address and cursor if they changed.
+ *              Called at the end of writes, after key presses, on terminal switches and
+ *              from rtc_read, which is where a vidmapped screen reaches VGA.
+ * 
+ * INPUTS: none
+ * OUTPUTS: Writes to VGA memory and the CRTC.
+ * RETURN VALUE: none
+ * SIDE EFFECTS: Clears the dirty rows.
+ */
+void terminal_flush(){
+    uint32_t flags;
+    int buf_idx, row, cursor;
+
+    cli_and_save(flags);
+    buf_idx = displayed_terminal;
+    if(terms[buf_idx]->view_offset != 0){ //showing scrollback, the live screen waits
+        if(view_dirty){
+            draw_view(buf_idx);
+            view_dirty = 0;
+        }
+    }else{
+        if(terms[buf_idx]->vidmapped){ //the program's writes are not tracked
+            mark_dirty(buf_idx, 0, NUM_ROWS);
+        }
+        for(row = terms[buf_idx]->origin; row < terms[buf_idx]->origin + NUM_ROWS; row++){
+            if(dirty_rows[row >> DIRTY_WORD_SHIFT] & (1 << (row & (DIRTY_WORD_BITS - 1)))){
+                memcpy(video_mem + row * ROW_BYTES, terms[buf_idx]->mem + row * ROW_BYTES, ROW_BYTES);
+                kstat.term_flushed_rows++;
+            }
+        }
+    }
+    //rows off the screen only come back on it through a scroll, which marks them again
+    memset(dirty_rows, 0, sizeof(dirty_rows));
+
+    if(shown_start != terms[buf_idx]->origin){
+        shown_start = terms[buf_idx]->origin;
+        set_screen_start(shown_start);
+    }
+    if(terms[buf_idx]->view_offset != 0){ //hide the cursor right below the screen
+        cursor = (terms[buf_idx]->origin + NUM_ROWS) * NUM_COLS;
+        if(shown_cursor != cursor){
+            shown_cursor = cursor;
+            update_cursor(0, NUM_ROWS);
+        }
+    }else{
+        cursor = (terms[buf_idx]->origin + terms[buf_idx]->pointer_y) * NUM_COLS + terms[buf_idx]->pointer_x;
+        if(shown_cursor != cursor){
+            shown_cursor = cursor;
+            update_cursor(terms[buf_idx]->pointer_x, terms[buf_idx]->pointer_y);
+        }
+    }
+    kstat.term_flushes++;
+    restore_flags(flags);
+}
 
 /* scroll_buffer_down
  * 
- * DESCRIPTION: Scrolls the terminal one row down.
+ * DESCRIPTION: Scrolls the terminal's scroll region one row down. Usually this only moves the origin
+ *              down a row, the CRTC start address follows on the next flush. Once the screen
+ *              reaches the end of the screen memory it is copied back to the start.
+ *              A scroll region smaller than the screen, a fixed top row or a vidmapped screen
+ *              is scrolled by copying the rows instead.
  * 
  * INPUTS: int buf_idx -- index of buffer to scroll down
- * OUTPUTS: Moves everything (starting at the start row) in the video memory up a row, and clears the bottom row.
+ * OUTPUTS: Moves everything in the scroll region up a row, and clears its bottom row.
  * RETURN VALUE: none
  * SIDE EFFECTS: Sets the cursor's x to 0.
  */
 void scroll_buffer_down(int buf_idx){
-    int32_t i;
-    pointer_x[buf_idx] = 0;
-    char* buffer_pointer = (char *) (TERM1_VIDEO + buf_idx*TERM_VIDEO_SIZE);
-    for (i = (start_row*NUM_COLS); i < ((NUM_ROWS-1) * NUM_COLS); i++) {
-        if(displayed_terminal == buf_idx){
-            *(uint8_t *)(video_mem + (i << 1)) = *(uint8_t *)(video_mem + ((i+NUM_COLS) << 1)); //get the values from the row below and move them up
-            *(uint8_t *)(video_mem + (i << 1) + 1) = get_color_from_idx(displayed_terminal);
-        }else{
-            *(uint8_t *)(buffer_pointer + (i << 1)) = *(uint8_t *)(buffer_pointer + ((i+NUM_COLS) << 1)); //get the values from the row below and move them up
-            *(uint8_t *)(buffer_pointer + (i << 1) + 1) = get_color_from_idx(buf_idx);
-        }
+    uint32_t flags;
+    uint8_t * mem = terms[buf_idx]->mem;
+    int top = (terms[buf_idx]->vt.top > start_row) ? terms[buf_idx]->vt.top : start_row;
+    int bottom = NUM_ROWS - 1 - terms[buf_idx]->vt.bottom_margin;
+
+    terms[buf_idx]->pointer_x = 0;
+    cli_and_save(flags);
+    if(top == 0){ //the row leaves the screen
+        scrollback_push(buf_idx, 0);
     }
-    for (i = 0; i < NUM_COLS; i++){ //clear the bottom row
-        if(displayed_terminal == buf_idx){
-            *(uint8_t *)(video_mem + (((NUM_ROWS-1) * NUM_COLS + i) << 1)) = ' ';
-            *(uint8_t *)(video_mem + (((NUM_ROWS-1) * NUM_COLS + i) << 1) + 1) = get_color_from_idx(displayed_terminal);
+    if(top == 0 && bottom == NUM_ROWS - 1 && !terms[buf_idx]->vidmapped){
+        if(terms[buf_idx]->origin + NUM_ROWS < VIDEO_MEM_ROWS){
+            terms[buf_idx]->origin += 1;
         }else{
-            *(uint8_t *)(buffer_pointer + (((NUM_ROWS-1) * NUM_COLS + i) << 1)) = ' ';
-            *(uint8_t *)(buffer_pointer + (((NUM_ROWS-1) * NUM_COLS + i) << 1) + 1) = get_color_from_idx(buf_idx);
+            //no room below the screen, move everything but the top row to the start of screen memory
+            memmove(mem, mem + (terms[buf_idx]->origin + 1) * ROW_BYTES, (NUM_ROWS - 1) * ROW_BYTES);
+            terms[buf_idx]->origin = 0;
+            mark_dirty(buf_idx, 0, NUM_ROWS - 1);
         }
+    }else{
+        memmove(cell(buf_idx, 0, top), cell(buf_idx, 0, top + 1), (bottom - top) * ROW_BYTES);
+        mark_dirty(buf_idx, top, bottom - top);
     }
+    memset_word(cell(buf_idx, 0, bottom), make_cell(' ', buf_idx), NUM_COLS); //clear the bottom row
+    mark_dirty(buf_idx, bottom, 1);
+    restore_flags(flags);
 }
 /* scroll_down
  * 
@@ -101,7 +444,244 @@ void scroll_buffer_down(int buf_idx){
  */
 void scroll_down(){
     scroll_buffer_down(displayed_terminal);
-    //update_cursor(pointer_x[displayed_terminal], pointer_y[displayed_terminal]);
+    //update_cursor(terms[displayed_terminal]->pointer_x, terms[displayed_terminal]->pointer_y);
+}
+
+/* buffer_new_line
+ * 
+ * DESCRIPTION: Moves a terminal's cursor to the start of the next row, scrolling if it is on the
+ *              bottom row of the scroll region.
+ * 
+ * INPUTS: int buf_idx -- index of the terminal
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void buffer_new_line(int buf_idx){
+    if(terms[buf_idx]->pointer_y == NUM_ROWS - 1 - terms[buf_idx]->vt.bottom_margin){
+        scroll_buffer_down(buf_idx); // if we are at the bottom of the scroll region scroll down
+    }else if(terms[buf_idx]->pointer_y < NUM_ROWS - 1){
+        terms[buf_idx]->pointer_y += 1; //we are before the bottom so we can go to the next row
+    }
+    terms[buf_idx]->pointer_x = 0; //reset x to left of row
+}
+
+/* vt_erase
+ * 
+ * DESCRIPTION: Blanks the cells of a terminal's screen from one position up to another, in reading order.
+ * 
+ * INPUTS: buf_idx -- index of the terminal
+ *         from    -- first cell, counted from the top left of the screen
+ *         to      -- cell after the last one
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void vt_erase(int buf_idx, int from, int to){
+    if(to > from){
+        memset_word(cell(buf_idx, 0, 0) + from, make_cell(' ', buf_idx), to - from);
+        mark_dirty(buf_idx, from / NUM_COLS, (to - 1) / NUM_COLS - from / NUM_COLS + 1);
+    }
+}
+
+/* vt_param
+ * 
+ * DESCRIPTION: Gets a parameter of the CSI sequence being run, leaving out a parameter or passing 0 picks the default.
+ * 
+ * INPUTS: buf_idx -- index of the terminal
+ *         i       -- which parameter
+ *         def     -- default value
+ * OUTPUTS: none
+ * RETURN VALUE: the parameter
+ * SIDE EFFECTS: none
+ */
+static int vt_param(int buf_idx, int i, int def){
+    if(i < terms[buf_idx]->vt.num_params && terms[buf_idx]->vt.params[i] != 0){
+        return terms[buf_idx]->vt.params[i];
+    }
+    return def;
+}
+
+/* vt_sgr
+ * 
+ * DESCRIPTION: Applies one SGR parameter to the attribute of new characters. Supports reset (0), bold (1),
+ *              reverse (7), ANSI foreground (30-37, 39 default) and background (40-47, 49 default) colors.
+ * 
+ * INPUTS: buf_idx -- index of the terminal
+ *         param   -- the SGR parameter
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void vt_sgr(int buf_idx, int param){
+    uint8_t color = term_attrib(buf_idx);
+    uint8_t def = get_color_from_idx(buf_idx);
+
+    if(param == SGR_RESET){
+        terms[buf_idx]->attrib = 0;
+        return;
+    }
+    if(param == SGR_BOLD){
+        color |= ATTRIB_BRIGHT;
+    }else if(param == SGR_REVERSE){
+        color = (color << 4) | (color >> 4);
+    }else if(param >= SGR_FG && param < SGR_FG + VT_NUM_COLORS){
+        color = (color & ~ATTRIB_FG_COLOR) | ansi_colors[param - SGR_FG];
+    }else if(param == SGR_FG_DEFAULT){
+        color = (color & ~ATTRIB_FG) | (def & ATTRIB_FG);
+    }else if(param >= SGR_BG && param < SGR_BG + VT_NUM_COLORS){
+        color = (color & ATTRIB_FG) | (ansi_colors[param - SGR_BG] << 4);
+    }else if(param == SGR_BG_DEFAULT){
+        color = (color & ATTRIB_FG) | (def & ~ATTRIB_FG);
+    }else{
+        return;
+    }
+    terms[buf_idx]->attrib = ATTRIB_SET | color;
+}
+
+/* vt_csi
+ * 
+ * DESCRIPTION: Runs a finished CSI sequence: cursor position (H, f), cursor moves (A, B, C, D),
+ *              erase screen (J) and line (K), SGR (m) and the scroll region (r).
+ *              Other sequences are ignored.
+ * 
+ * INPUTS: buf_idx -- index of the terminal
+ *         final   -- character that ended the sequence
+ * OUTPUTS: Changes the terminal's screen or cursor.
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void vt_csi(int buf_idx, char final){
+    int x = terms[buf_idx]->pointer_x;
+    int y = terms[buf_idx]->pointer_y;
+    int pos = y * NUM_COLS + ((x < NUM_COLS) ? x : NUM_COLS - 1);
+    int top, bottom, i;
+
+    switch(final){
+        case 'H':
+        case 'f':
+            y = vt_param(buf_idx, 0, 1) - 1;
+            x = vt_param(buf_idx, 1, 1) - 1;
+            break;
+        case 'A':
+            y -= vt_param(buf_idx, 0, 1);
+            break;
+        case 'B':
+            y += vt_param(buf_idx, 0, 1);
+            break;
+        case 'C':
+            x += vt_param(buf_idx, 0, 1);
+            break;
+        case 'D':
+            x -= vt_param(buf_idx, 0, 1);
+            break;
+        case 'J':
+            switch(vt_param(buf_idx, 0, 0)){
+                case VT_ERASE_TO_END:
+                    vt_erase(buf_idx, pos, NUM_ROWS * NUM_COLS);
+                    break;
+                case VT_ERASE_TO_START:
+                    vt_erase(buf_idx, 0, pos + 1);
+                    break;
+                case VT_ERASE_ALL:
+                    vt_erase(buf_idx, 0, NUM_ROWS * NUM_COLS);
+                    break;
+            }
+            break;
+        case 'K':
+            switch(vt_param(buf_idx, 0, 0)){
+                case VT_ERASE_TO_END:
+                    vt_erase(buf_idx, pos, (y + 1) * NUM_COLS);
+                    break;
+                case VT_ERASE_TO_START:
+                    vt_erase(buf_idx, y * NUM_COLS, pos + 1);
+                    break;
+                case VT_ERASE_ALL:
+                    vt_erase(buf_idx, y * NUM_COLS, (y + 1) * NUM_COLS);
+                    break;
+            }
+            break;
+        case 'm':
+            if(terms[buf_idx]->vt.num_params == 0){
+                vt_sgr(buf_idx, SGR_RESET);
+            }
+            for(i = 0; i < terms[buf_idx]->vt.num_params; i++){
+                vt_sgr(buf_idx, terms[buf_idx]->vt.params[i]);
+            }
+            break;
+        case 'r':
+            top = vt_param(buf_idx, 0, 1) - 1;
+            bottom = vt_param(buf_idx, 1, NUM_ROWS) - 1;
+            if(top < bottom && bottom < NUM_ROWS){
+                terms[buf_idx]->vt.top = top;
+                terms[buf_idx]->vt.bottom_margin = NUM_ROWS - 1 - bottom;
+                x = 0;
+                y = 0;
+            }
+            break;
+        default:
+            break;
+    }
+    //keep the cursor on the screen
+    terms[buf_idx]->pointer_x = (x < 0) ? 0 : ((x >= NUM_COLS) ? NUM_COLS - 1 : x);
+    terms[buf_idx]->pointer_y = (y < 0) ? 0 : ((y >= NUM_ROWS) ? NUM_ROWS - 1 : y);
+}
+
+/* vt_feed
+ * 
+ * DESCRIPTION: Runs one character of an escape sequence through a terminal's parser.
+ *              ESC 7 and ESC 8 save and restore the cursor, ESC [ starts a CSI sequence
+ *              of numbers separated by ';' that ends with a letter.
+ * 
+ * INPUTS: buf_idx -- index of the terminal
+ *         c       -- the character, ESC when no sequence is going on
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void vt_feed(int buf_idx, char c){
+    vt_state_t * state = &terms[buf_idx]->vt;
+    int * param;
+
+    switch(state->state){
+        case VT_NORMAL:
+            state->state = VT_ESCAPE;
+            break;
+        case VT_ESCAPE:
+            state->state = VT_NORMAL;
+            if(c == '['){
+                state->state = VT_CSI;
+                state->num_params = 0;
+            }else if(c == '7'){
+                state->saved_x = terms[buf_idx]->pointer_x;
+                state->saved_y = terms[buf_idx]->pointer_y;
+            }else if(c == '8'){
+                terms[buf_idx]->pointer_x = state->saved_x;
+                terms[buf_idx]->pointer_y = state->saved_y;
+            }
+            break;
+        case VT_CSI:
+            if(c >= '0' && c <= '9'){
+                if(state->num_params == 0){
+                    state->params[state->num_params++] = 0;
+                }
+                param = &state->params[state->num_params - 1];
+                if(*param < VT_PARAM_MAX){
+                    *param = *param * 10 + (c - '0');
+                }
+            }else if(c == ';'){
+                if(state->num_params == 0){
+                    state->params[state->num_params++] = 0;
+                }
+                if(state->num_params < VT_MAX_PARAMS){
+                    state->params[state->num_params++] = 0;
+                }
+            }else if(c >= VT_FINAL_START && c <= VT_FINAL_END){
+                state->state = VT_NORMAL;
+                vt_csi(buf_idx, c);
+            } //'?' and other private markers are skipped
+            break;
+    }
 }
 
 /* void buffer_put_char(char c);
@@ -110,84 +690,137 @@ void scroll_down(){
  * Return Value: void
  * Function: Output a character to the console */
 void buffer_put_char(char c, int buf_idx){
-    char* buffer_pointer = (char *) (TERM1_VIDEO + buf_idx*TERM_VIDEO_SIZE);
     if(c == '\n' || c == '\r') {
-        if(pointer_y[buf_idx] == NUM_ROWS-1){
-            scroll_buffer_down(buf_idx); // if we are at the bottom of the screen scroll down
-        }else{
-            pointer_y[buf_idx] += 1;
-        }
-        pointer_x[buf_idx] = 0;
+        buffer_new_line(buf_idx);
     }else{
-        if(pointer_x[buf_idx] == NUM_COLS){ //if we are at the edge of the row
-                if(pointer_y[buf_idx] == NUM_ROWS-1){      
-                    scroll_buffer_down(buf_idx); // if we are at the bottom of the screen scroll down
-                }else{
-                    pointer_y[buf_idx] += 1; //we are at the edge of a row before the bottom so we can go to the next row
-                }
-                pointer_x[buf_idx] = 0; //reset x to left of row
-            }
-        if(buf_idx == displayed_terminal){
-            *(uint8_t *)(video_mem + ((NUM_COLS * pointer_y[displayed_terminal] + pointer_x[displayed_terminal]) << 1)) = c;
-            *(uint8_t *)(video_mem + ((NUM_COLS * pointer_y[displayed_terminal] + pointer_x[displayed_terminal]) << 1) + 1) = get_color_from_idx(displayed_terminal);
-        }else{
-            *(uint8_t *)(buffer_pointer + ((NUM_COLS * pointer_y[buf_idx] + pointer_x[buf_idx]) << 1)) = c;
-            *(uint8_t *)(buffer_pointer + ((NUM_COLS * pointer_y[buf_idx] + pointer_x[buf_idx]) << 1) + 1) = get_color_from_idx(buf_idx);
+        if(terms[buf_idx]->pointer_x == NUM_COLS){ //if we are at the edge of the row
+            buffer_new_line(buf_idx);
         }
-        pointer_x[buf_idx] += 1;
+        *cell(buf_idx, terms[buf_idx]->pointer_x, terms[buf_idx]->pointer_y) = make_cell(c, buf_idx);
+        mark_dirty(buf_idx, terms[buf_idx]->pointer_y, 1);
+        terms[buf_idx]->pointer_x += 1;
     }
 }
-/* void terminal_print_char(char c);
- * Inputs: char c = character to print
- * Return Value: void
- * Function: Output a character to the console */
-void terminal_print_char(char c){
-    buffer_put_char(c, displayed_terminal);
-}
 
-/* print_displayed_buffer_to_screen
+/* buffer_output
  * 
- * DESCRIPTION: Prints the buffer to the screen.
+ * DESCRIPTION: Writes characters to a terminal's screen for write and writev. Printable characters
+ *              are copied to the screen a row at a time as whole cells, only newlines and escape
+ *              sequences are handled on their own. The keyboard buffer and the cursor are left alone.
  * 
- * INPUTS: none
- * OUTPUTS: Prints the current buffer to the screen.
+ * INPUTS: int buf_idx -- index of the terminal
+ *         str         -- characters to write
+ *         n           -- number of characters
+ * OUTPUTS: Writes the characters to the terminal's screen.
  * RETURN VALUE: none
  * SIDE EFFECTS: none
  */
-void print_displayed_buffer_to_screen(){
-    int i = buffer_start[displayed_terminal]; //counter
-    while(i!=buffer_idx[displayed_terminal]){
-        terminal_print_char(buffer[displayed_terminal][i]);
-        i = (i+1)%KB_BUFFER_SIZE;
+static void buffer_output(int buf_idx, const char * str, int n){
+    uint16_t color;
+    uint16_t * dst;
+    int run, i;
+
+    while(n > 0){
+        if(terms[buf_idx]->vt.state != VT_NORMAL || *str == VT_ESC){
+            vt_feed(buf_idx, *str);
+            str++;
+            n--;
+            continue;
+        }
+        if(*str == '\n' || *str == '\r'){
+            buffer_new_line(buf_idx);
+            str++;
+            n--;
+            continue;
+        }
+        if(terms[buf_idx]->pointer_x == NUM_COLS){ //the row is full, continue on the next one
+            buffer_new_line(buf_idx);
+        }
+        //copy up to the end of the row, the next newline or escape sequence
+        run = NUM_COLS - terms[buf_idx]->pointer_x;
+        if(run > n){
+            run = n;
+        }
+        color = make_cell(0, buf_idx);
+        dst = cell(buf_idx, terms[buf_idx]->pointer_x, terms[buf_idx]->pointer_y);
+        for(i = 0; i < run && str[i] != '\n' && str[i] != '\r' && str[i] != VT_ESC; i++){
+            dst[i] = (uint8_t) str[i] | color;
+        }
+        mark_dirty(buf_idx, terms[buf_idx]->pointer_y, 1);
+        terms[buf_idx]->pointer_x += i;
+        str += i;
+        n -= i;
+    }
+}
+/* void terminal_print_char(char c);
+ * Inputs: char c = character to print
+ * Return Value: void
+ * Function: Output a character to the console, the screen catches up at the end of the line */
+void terminal_print_char(char c){
+    buffer_put_char(c, displayed_terminal);
+    if(c == '\n'){
+        terminal_flush();
     }
 }
+
 /* set_displayed_terminal
  * 
- * DESCRIPTION: Sets the currently displayed terminal.
+ * DESCRIPTION: Sets the currently displayed terminal. Its screen is drawn from its
+ *              screen memory at the next flush, which happens right away.
+ *              Terminals that have not been opened are ignored.
  * 
  * INPUTS: terminal_num -- index of terminal to display
  * OUTPUTS: Sets the displayed buffer to the number passed in.
  * RETURN VALUE: none
- * SIDE EFFECTS: Clears the screen, then prints the buffer to the screen.
+ * SIDE EFFECTS: Redraws the screen.
  */
 void set_displayed_terminal(int terminal_num){
-    int i;
-    if(displayed_terminal != terminal_num){
-        char* save_loc = (char*)(TERM1_VIDEO + (displayed_terminal * 0x1000));
-        char* load_loc = (char*)(TERM1_VIDEO + (terminal_num * 0x1000));
-
-        for (i = 0; i < NUM_ROWS * NUM_COLS; i++) {
-            *(uint8_t *)(save_loc + (i << 1)) = *(uint8_t *)(video_mem + (i << 1));
-            *(uint8_t *)(video_mem + (i << 1)) = *(uint8_t *)(load_loc + (i << 1));
-            *(uint8_t *)(video_mem + (i << 1) + 1) = get_color_from_idx(terminal_num);
-        }
-        
+    uint32_t flags;
+    uint32_t start_low, end_low, high;
 
+    if(displayed_terminal != terminal_num && terminal_exists(terminal_num)){
+        cli_and_save(flags);
+        asm volatile ("rdtsc" : "=a"(start_low), "=d"(high));
         displayed_terminal = terminal_num;
+        mark_dirty(terminal_num, 0, NUM_ROWS);
+        view_dirty = 1;
+        terminal_flush();
+        asm volatile ("rdtsc" : "=a"(end_low), "=d"(high));
+        kstat.term_switches++;
+        kstat.term_switch_cycles = end_low - start_low;
+        restore_flags(flags);
         // set_active_buffer (terminal_num); 
         // set_terminal(terminal_num);
     }
 }
+
+/* terminal_set_vidmapped
+ * 
+ * DESCRIPTION: Marks a terminal's screen as mapped into a program. The program expects the
+ *              screen at the start of the page, so the screen is moved back to origin 0 and
+ *              stays there until the mapping goes away.
+ * 
+ * INPUTS: terminal_num -- index of the terminal
+ *         mapped       -- 1 when the screen gets mapped, 0 when the mapping goes away
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: Scrolling the terminal copies rows while it is mapped.
+ */
+void terminal_set_vidmapped(int terminal_num, int mapped){
+    uint32_t flags;
+    uint8_t * mem;
+
+    cli_and_save(flags);
+    if(mapped && terms[terminal_num]->origin != 0){
+        mem = terms[terminal_num]->mem;
+        memmove(mem, mem + terms[terminal_num]->origin * ROW_BYTES, SCREEN_BYTES);
+        terms[terminal_num]->origin = 0;
+        mark_dirty(terminal_num, 0, NUM_ROWS);
+    }
+    terms[terminal_num]->vidmapped = mapped;
+    restore_flags(flags);
+}
+
 /* get_displayed_terminal
  * 
  * DESCRIPTION: Gets the currently displayed terminal.
@@ -230,11 +863,11 @@ int get_active_buffer(){
  * 
  * INPUTS: garbage pointer for system call compatability
  * OUTPUTS: none
- * RETURN VALUE: -1
+ * RETURN VALUE: 0
  * SIDE EFFECTS: none
  */
 int terminal_open(const unsigned char * garbage){
-    return -1;
+    return 0;
 }
 /* terminal_close
  * 
@@ -242,11 +875,11 @@ int terminal_open(const unsigned char * garbage){
  * 
  * INPUTS: fd -- int, currently unused
  * OUTPUTS: none
- * RETURN VALUE: -1
+ * RETURN VALUE: 0
  * SIDE EFFECTS: none
  */
 int terminal_close(int fd){
-    return -1;
+    return 0;
 }
 /* get_screen_x
  * 
@@ -258,7 +891,7 @@ int terminal_close(int fd){
  * SIDE EFFECTS: none
  */
 int get_screen_x(){
-    return pointer_x[displayed_terminal];
+    return terms[displayed_terminal]->pointer_x;
 }
 /* get_screen_y
  * 
@@ -270,7 +903,7 @@ int get_screen_x(){
  * SIDE EFFECTS: none
  */
 int get_screen_y(){
-    return pointer_y[displayed_terminal];
+    return terms[displayed_terminal]->pointer_y;
 }
 /* set_screen_x
  * 
@@ -282,7 +915,7 @@ int get_screen_y(){
  * SIDE EFFECTS: Sets the cursor's x value to the input.
  */
 void set_screen_x(int x){
-    pointer_x[displayed_terminal] = x;
+    terms[displayed_terminal]->pointer_x = x;
 }
 /* set_screen_y
  * 
@@ -294,7 +927,7 @@ void set_screen_x(int x){
  * SIDE EFFECTS: Sets the cursor's y value to the input.
  */
 void set_screen_y(int y){
-    pointer_y[displayed_terminal] = y;
+    terms[displayed_terminal]->pointer_y = y;
 }
 
 /* enable_write_to_screen
@@ -307,7 +940,7 @@ void set_screen_y(int y){
  * SIDE EFFECTS: Will enable the keyboard write mode.
  */
 void enable_write_to_screen(int terminal_index){
-    terminal_mode[terminal_index] = KBMODE_TERMINAL_WRITE;
+    terms[terminal_index]->kb_mode = KBMODE_TERMINAL_WRITE;
 }
 
 /* set_top_row
@@ -320,9 +953,9 @@ void enable_write_to_screen(int terminal_index){
  */
 void set_top_row(int row){
     start_row = row;
-    if(pointer_y[displayed_terminal] < row){
-        pointer_y[displayed_terminal] = row;
-        pointer_x[displayed_terminal] = 0;
+    if(terms[displayed_terminal]->pointer_y < row){
+        terms[displayed_terminal]->pointer_y = row;
+        terms[displayed_terminal]->pointer_x = 0;
     }
 }
 
@@ -336,7 +969,7 @@ void set_top_row(int row){
  * SIDE EFFECTS: Will disable the keyboard write mode.
  */
 void disable_write_to_screen(int terminal_index){
-    terminal_mode[terminal_index] = KBMODE_OFF;
+    terms[terminal_index]->kb_mode = KBMODE_OFF;
 }
 
 /* get_current_terminal_mode
@@ -349,7 +982,7 @@ void disable_write_to_screen(int terminal_index){
  * SIDE EFFECTS: none
  */
 int get_current_terminal_mode(){
-    return terminal_mode[active_buffer];
+    return terms[active_buffer]->kb_mode;
 }
 
 
@@ -366,18 +999,29 @@ void set_tab_width(int new_width){
     tab_width = new_width;
 }
 
+/* clear_screen
+ * 
+ * DESCRIPTION: Clears a terminal's screen below the top row and moves its cursor to the top left.
+ * 
+ * INPUTS: buf_idx -- index of the terminal
+ * OUTPUTS: Clears the screen.
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void clear_screen(int buf_idx){
+    memset_word(cell(buf_idx, 0, start_row), make_cell(' ', buf_idx), (NUM_ROWS - start_row) * NUM_COLS);
+    terms[buf_idx]->pointer_x = 0;
+    terms[buf_idx]->pointer_y = start_row;
+    mark_dirty(buf_idx, start_row, NUM_ROWS - start_row);
+    terminal_flush();
+}
+
 /* void clear(void); taken from lib.c
  * Inputs: none
  * Return Value: none
  * Function: Clears video memory */
 void clear() {
-    int32_t i;
-    for (i = (start_row*NUM_COLS); i < NUM_ROWS * NUM_COLS; i++) {
-        *(uint8_t *)(video_mem + (i << 1)) = ' ';
-        *(uint8_t *)(video_mem + (i << 1) + 1) = get_color_from_idx(displayed_terminal);
-    }
-    pointer_x[displayed_terminal] = 0;
-    pointer_y[displayed_terminal] = start_row;
+    clear_screen(displayed_terminal);
 }
 
 /* clear_buffer_char
@@ -387,328 +1031,423 @@ void clear() {
  * INPUTS: none
  * OUTPUTS: Clears the character at the current cursor position.
  * RETURN VALUE: none
- * SIDE EFFECTS: If the pointer_x[displayed_terminal] is off the screen, move the pointer to the next row.
+ * SIDE EFFECTS: If the terms[displayed_terminal]->pointer_x is off the screen, move the pointer to the next row.
  */
 void clear_buffer_char(int buf_index){
-    char* buffer_pointer = (char * ) (TERM1_VIDEO + buf_index*TERM_VIDEO_SIZE);
-
-    if(pointer_x[buf_index] == NUM_COLS){ //if we are at the edge of the row
-        if(pointer_y[buf_index] == NUM_ROWS-1){ 
+    if(terms[buf_index]->pointer_x == NUM_COLS){ //if we are at the edge of the row
+        if(terms[buf_index]->pointer_y == NUM_ROWS-1){ 
             return;
         }else{
-            pointer_y[buf_index] += 1; //we are at the edge of a row before the bottom so we can go to the next row
+            terms[buf_index]->pointer_y += 1; //we are at the edge of a row before the bottom so we can go to the next row
         }
-        pointer_x[buf_index] = 0; //reset x to left of row
-    }
-    if(buf_index == displayed_terminal){
-        *(uint8_t *)(video_mem + ((NUM_COLS * pointer_y[buf_index] + pointer_x[buf_index]) << 1)) = ' ';
-        *(uint8_t *)(video_mem + ((NUM_COLS * pointer_y[buf_index] + pointer_x[buf_index]) << 1) + 1) = get_color_from_idx(buf_index);
-    }else{
-        *(uint8_t *)(buffer_pointer + ((NUM_COLS * pointer_y[buf_index] + pointer_x[buf_index]) << 1)) = ' ';
-        *(uint8_t *)(buffer_pointer + ((NUM_COLS * pointer_y[buf_index] + pointer_x[buf_index]) << 1) + 1) = get_color_from_idx(buf_index);
+        terms[buf_index]->pointer_x = 0; //reset x to left of row
     }
+    *cell(buf_index, terms[buf_index]->pointer_x, terms[buf_index]->pointer_y) = make_cell(' ', buf_index);
+    mark_dirty(buf_index, terms[buf_index]->pointer_y, 1);
 }
 
-/* clear_pointer_char
+/* echo_char
  * 
- * DESCRIPTION: Clears the character at the current pointer value.
+ * DESCRIPTION: Shows a typed character on its terminal's screen.
  * 
- * INPUTS: none
- * OUTPUTS: Clears the character at the current cursor position.
+ * INPUTS: c       -- the character
+ *         buf_idx -- index of the terminal
+ * OUTPUTS: Prints the character.
  * RETURN VALUE: none
- * SIDE EFFECTS: If the pointer_x[displayed_terminal] is off the screen, move the pointer to the next row.
+ * SIDE EFFECTS: Updates the screen if the terminal is displayed.
  */
-void clear_pointer_char(){
-    clear_buffer_char(displayed_terminal);
+static void echo_char(char c, int buf_idx){
+    buffer_put_char(c, buf_idx);
+    if(buf_idx == displayed_terminal){
+        terminal_flush();
+    }
 }
 
-
-/* indexed_buffer_clear
- *
- * DESCRIPTION: Empties the buffer by setting the start index and the top index to 0. Does not actually change values in the buffer.
+/* redraw_line
+ * 
+ * DESCRIPTION: Prints the line being typed on a terminal again, after the screen was cleared.
  * 
- * INPUTS: int buf_idx -- index of buffer to clear
- * OUTPUTS: Clears the active buffer and sets the start to 0.
+ * INPUTS: buf_idx -- index of the terminal
+ * OUTPUTS: Prints the line.
  * RETURN VALUE: none
  * SIDE EFFECTS: none
  */
-void indexed_buffer_clear(int buf_idx){
-    //clear the buffer
-    buffer_start[buf_idx] = 0;
-    buffer_idx[buf_idx] = 0;
-    buffer_full[buf_idx] = 0;
+static void redraw_line(int buf_idx){
+    int i;
+
+    for(i = 0; i < terms[buf_idx]->line_len; i++){
+        buffer_put_char(terms[buf_idx]->line[i], buf_idx);
+    }
+    if(buf_idx == displayed_terminal){
+        terminal_flush();
+    }
 }
-/* buffer_clear
- *
- * DESCRIPTION: Empties the buffer by setting the start index and the top index to 0. Does not actually change values in the buffer.
+
+/* input_put
  * 
- * INPUTS: int buf_idx -- index of buffer to clear
- * OUTPUTS: Clears the active buffer and sets the start to 0.
- * RETURN VALUE: none
+ * DESCRIPTION: Adds a character to the input waiting for read.
+ * 
+ * INPUTS: c       -- the character
+ *         buf_idx -- index of the terminal
+ * OUTPUTS: none
+ * RETURN VALUE: 0 on success, -1 if the input queue is full
  * SIDE EFFECTS: none
  */
-void buffer_clear(){
-    indexed_buffer_clear(displayed_terminal);
+static int input_put(char c, int buf_idx){
+    if(terms[buf_idx]->input_count == TERM_INPUT_SIZE){
+        kstat.keys_dropped++;
+        return -1;
+    }
+    terms[buf_idx]->input[(terms[buf_idx]->input_head + terms[buf_idx]->input_count) & (TERM_INPUT_SIZE - 1)] = c;
+    terms[buf_idx]->input_count++;
+    if(c == '\n'){
+        terms[buf_idx]->input_lines++;
+    }
+    return 0;
 }
 
 /* buffer_push
  * 
- * DESCRIPTION: Pushes a character into the active buffer. 
- *          If the buffer is in read mode, does not push if the buffer is full. 
- *          Otherwise, it just moves the start of the buffer circularly when the buffer is full.
+ * DESCRIPTION: Adds a character to the line being typed and echoes it. Room for the newline is
+ *              always kept, characters past that are dropped.
  * 
  * INPUTS: c -- character to push
  *         buf_idx -- buffer index
- * OUTPUTS: Prints the character pushed onto the buffer if the active buffer is the displayed one.
+ * OUTPUTS: Prints the character if echo is on.
  * RETURN VALUE: none
  * SIDE EFFECTS: none
  */
 void buffer_push(char c, int buf_idx){
-    if(terminal_mode[buf_idx]==KBMODE_SYS_READ && (buffer_idx[buf_idx] >= KB_BUFFER_SIZE || buffer_idx[buf_idx] >= max_chars)){
+    if(terms[buf_idx]->line_len >= KB_BUFFER_SIZE - 1){
         return;
     }
-    if(buffer_idx[buf_idx] >= KB_BUFFER_SIZE){
-        buffer_idx[buf_idx] = (buffer_idx[buf_idx])%KB_BUFFER_SIZE;
-    }
-    if(buffer_full[buf_idx]){
-        if(terminal_mode[buf_idx] != KBMODE_SYS_READ){ //using read_terminal has a limit of 128
-            buffer_start[buf_idx] = (buffer_start[buf_idx] + 1)%KB_BUFFER_SIZE;
-        }
-    }
-    buffer[buf_idx][buffer_idx[buf_idx]] = c;
-    if(buf_idx == displayed_terminal){
-        terminal_print_char(c);
-    }else{
-        buffer_put_char(c, buf_idx);
+    terms[buf_idx]->line[terms[buf_idx]->line_len] = c;
+    terms[buf_idx]->line_len += 1;
+    if(terms[buf_idx]->flags & TERM_ECHO){
+        echo_char(c, buf_idx);
     }
-    if(buffer_idx[buf_idx] == (KB_BUFFER_SIZE + buffer_start[buf_idx]-1)%KB_BUFFER_SIZE){ //if buffer is at the end of the buffer
-        buffer_full[buf_idx] = 1;
-    }
-    buffer_idx[buf_idx] = buffer_idx[buf_idx] + 1;
 }
 
 /* buffer_pop
  * 
- * DESCRIPTION: Pops a character off the active buffer.
- *              If the buffer is empty, does nothing.
- *              This function also clears the most recent character from the terminal and moves the cursor appropriately.
+ * DESCRIPTION: Removes the last character of the line being typed.
+ *              If the line is empty, does nothing.
+ *              With echo on, this also clears the character from the screen and moves the cursor back.
  * 
  * INPUTS: int buf_idx -- index of buffer to pop from
- * OUTPUTS: Clears the character off the terminal and moves the cursor if the active buffer is the displayed buffer.
+ * OUTPUTS: Clears the character off the terminal.
  * RETURN VALUE: none
  * SIDE EFFECTS: none
  */
 void buffer_pop(int buf_idx){
-    if (!buffer_full[buf_idx] && buffer_idx[buf_idx] == buffer_start[buf_idx]){ //if there is nothing in the buffer do nothing
+    if(terms[buf_idx]->line_len == 0){ //if there is nothing in the buffer do nothing
+        return;
+    }
+    terms[buf_idx]->line_len -= 1;
+    if(!(terms[buf_idx]->flags & TERM_ECHO)){
         return;
     }
-    buffer_full[buf_idx] = 0; 
-    /* if the buffer was full, it will not be anymore since we will always be either at the start of the screen
-     * or removing a character.
-     */
-    buffer_idx[buf_idx] = (KB_BUFFER_SIZE+buffer_idx[buf_idx]-1)%KB_BUFFER_SIZE;
-    char c = buffer[buf_idx][buffer_idx[buf_idx]];
-    if (c=='\n' || c=='\r'){ //if we are deleting a new line character
-        if(pointer_y[buf_idx] == start_row){
-            //this should not even be possible
-            return;
-        }
-        pointer_y[buf_idx] -= 1;
-        pointer_x[buf_idx] = NUM_COLS; //set pointer to the last space on the previous row
 
-        c = *(uint8_t *)(video_mem + ((NUM_COLS * pointer_y[buf_idx] + pointer_x[buf_idx]-1) << 1)); //get the char at the end of the row
-        while(c == ' '){ //trunacate all the spaces
-            pointer_x[buf_idx] -= 1; //if the character before the cursor position is empty, move the cursor there
-            if(pointer_x[buf_idx]==0){
+    if(terms[buf_idx]->pointer_x > 0){ //delete the character one before the pointer
+        terms[buf_idx]->pointer_x -= 1;
+    }else if(terms[buf_idx]->pointer_y > start_row){ //otherwise, go back to the end of the last row
+        terms[buf_idx]->pointer_y -= 1;
+        terms[buf_idx]->pointer_x = NUM_COLS-1;
+    }else{
+        return;
+    }
+    clear_buffer_char(buf_idx);
+    if(buf_idx == displayed_terminal){
+        terminal_flush();
+    }
+}
+
+/* raw_key
+ * 
+ * DESCRIPTION: Handles a key press on a terminal in raw mode. The byte the key stands for goes
+ *              straight to the input for read, ctrl + letter gives the control character.
+ * 
+ * INPUTS: ev -- the key press
+ * OUTPUTS: Prints the character if echo is on.
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void raw_key(const key_event_t * ev){
+    int buf_idx = ev->tag;
+    char c = key_event_char(ev);
+
+    if(c == 0){
+        switch(ev->value){
+            case BACKSPACE_PRESSED:
+                c = ASCII_BACKSPACE;
+                break;
+            case TAB_PRESSED:
+                c = '\t';
                 break;
+            case ESC_KEY_PRESSED:
+                c = VT_ESC;
+                break;
+            default:
+                return;
+        }
+    }else if(ev->mods & KEY_MOD_CTRL){
+        c &= CTRL_KEY_MASK;
+    }
+    if(input_put(c, buf_idx) == 0 && (terms[buf_idx]->flags & TERM_ECHO) && (c >= ' ' || c == '\n')){
+        echo_char(c, buf_idx);
+    }
+}
+
+/* canonical_key
+ * 
+ * DESCRIPTION: Handles a key press on a terminal in canonical mode. Characters are added to the
+ *              line, backspace removes one and enter hands the line to read. Ctrl + L clears
+ *              the screen and prints the line again.
+ * 
+ * INPUTS: ev -- the key press
+ * OUTPUTS: Prints the key's effect if echo is on.
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void canonical_key(const key_event_t * ev){
+    int buf_idx = ev->tag;
+    char c = key_event_char(ev);
+    int i; //counter
+
+    if(ev->mods & KEY_MOD_CTRL){ //handle ctrl + letter functions
+        if(c == 'l' || c == 'L'){
+            /*clear screen and put cursor to top*/
+            clear_screen(buf_idx);
+            if(terms[buf_idx]->flags & TERM_ECHO){
+                redraw_line(buf_idx);
             }
-            c = *(uint8_t *)(video_mem + ((NUM_COLS * pointer_y[buf_idx] + pointer_x[buf_idx]-1) << 1));
         }
         return;
     }
-
-    if(pointer_x[active_buffer] > 0){ //if we are not deleting a new row char and we're not at the left edge of the screen
-        //delete the character one before the pointer_x[displayed_terminal]
-        //move pointer_x[displayed_terminal] one to the left
-        pointer_x[active_buffer] -= 1;
-        if(displayed_terminal == active_buffer){
-            clear_pointer_char();
-        }else{
-            clear_buffer_char(active_buffer);
+    if(c == '\n'){
+        //the line goes to read whole, so keep it until there is room for all of it
+        if(TERM_INPUT_SIZE - terms[buf_idx]->input_count < terms[buf_idx]->line_len + 1){
+            kstat.keys_dropped++;
+            return;
         }
-        if(pointer_x[active_buffer] == 0 && pointer_y[active_buffer] == start_row){
-            buffer_idx[active_buffer] = buffer_start[active_buffer];
+        for(i = 0; i < terms[buf_idx]->line_len; i++){
+            input_put(terms[buf_idx]->line[i], buf_idx);
+        }
+        input_put('\n', buf_idx);
+        terms[buf_idx]->line_len = 0;
+        if(terms[buf_idx]->flags & TERM_ECHO){
+            echo_char('\n', buf_idx);
         }
         return;
-    }else{ //otherwise, go back to the end of the last row
-        if(pointer_y[active_buffer] == start_row){
-            //this should not even be possible
-            return;
+    }
+    if(c != 0){
+        buffer_push(c, buf_idx);
+        return;
+    }
+    switch(ev->value){ //if character is not alphanumeric or a valid symbol check for these
+        case BACKSPACE_PRESSED:
+            buffer_pop(buf_idx);//delete last_char of buffer
+            break;
+        case TAB_PRESSED:
+            for(i=0; i<tab_width; i++){ //add tab_width number of spaces to buffer
+                if(terms[buf_idx]->pointer_x == NUM_COLS){ //unless we are at the end of the row
+                    break;
+                }
+                buffer_push(' ', buf_idx);
+            }
+            break;
+    }
+}
+
+/* terminal_input
+ * 
+ * DESCRIPTION: Hands the key presses queued by the keyboard interrupt to the line discipline of
+ *              the terminal each one was typed into. Called while read waits for input.
+ * 
+ * INPUTS: none
+ * OUTPUTS: Echoes typed characters.
+ * RETURN VALUE: none
+ * SIDE EFFECTS: Interrupts are off while the queue is emptied, so there is only one consumer.
+ */
+void terminal_input(){
+    key_event_t ev;
+    uint32_t flags;
+
+    cli_and_save(flags);
+    while(key_queue_get(&ev) == 0){
+        if(terms[ev.tag]->kb_mode == KBMODE_OFF){ //the keyboard is switched off for this terminal
+            continue;
         }
-        pointer_y[active_buffer] -= 1;
-        pointer_x[active_buffer] = NUM_COLS-1; 
-        if(displayed_terminal == active_buffer){
-            clear_pointer_char();
+        if(terms[ev.tag]->flags & TERM_CANON){
+            canonical_key(&ev);
         }else{
-            clear_buffer_char(active_buffer);
+            raw_key(&ev);
         }
-        return;
     }
+    restore_flags(flags);
+}
 
+/* fn_key_terminal
+ * 
+ * DESCRIPTION: Finds the terminal a function key switches to with Alt.
+ * 
+ * INPUTS: value -- Keyboard scan value.
+ * OUTPUTS: none
+ * RETURN VALUE: index of the terminal, -1 if the key is not F1 to F12
+ * SIDE EFFECTS: none
+ */
+static int fn_key_terminal(uint8_t value){
+    if(value >= FN1 && value <= FN10){
+        return value - FN1;
+    }
+    if(value == F11 || value == F12){
+        return FN10 - FN1 + 1 + (value - F11);
+    }
+    return -1;
 }
 
 /* terminal_driver
  * 
  * DESCRIPTION: Driver to run the terminal. Gets called whenever there is a keyboard interrupt.
  *              First, it calls the read_key_press function to read a character from the keyboard.
- *              Then, based on what mode the terminal is set to, will either print the character or process the key pressed.
+ *              Keys that control the screen are handled right away, everything else is queued
+ *              for the displayed terminal and handled by terminal_input.
  * 
  * INPUTS: none
- * OUTPUTS: Prints a character if in a writing mode and the character from the keyboard is valid to print.
+ * OUTPUTS: none
  * RETURN VALUE: none
  * SIDE EFFECTS: none
  */
 void terminal_driver(){
-    int i = 0; //counter
-    int prev_active_buffer = active_buffer; //save the current active buffer
-    active_buffer = displayed_terminal; //set the active buffer to the displayed terminal
-
     uint8_t value = read_key_press(); //need this to send EOI to PIC
-    
-    char c = get_char(value);
-
-    if(alt_is_held()){
-        switch(value){
-            case FN1:
-                if(displayed_terminal != TERMINAL_1){
-                    set_displayed_terminal(TERMINAL_1);
-                }
-                active_buffer = prev_active_buffer; //restore active buffer
-                return;
-            case FN2:
-                if(displayed_terminal != TERMINAL_2){
-                    set_displayed_terminal(TERMINAL_2);
-                }
-                active_buffer = prev_active_buffer; //restore active buffer
-                return;
-            case FN3:
-                if(displayed_terminal != TERMINAL_3){
-                    set_displayed_terminal(TERMINAL_3);
+    int fn_terminal;
 
-                }
-                active_buffer = prev_active_buffer; //restore active buffer
-                return;
-            default:
-                break;
-        }
+    if(value & KEY_RELEASED){
+        return;
     }
-
-    if(terminal_mode[active_buffer] == KBMODE_SYS_READ && 
-                        value == ENTER_PRESSED){ //press enter to exist read mode
-        /*Add the new line character to the end of the buffer and print it to the terminal.*/
-        buffer[active_buffer][buffer_idx[active_buffer]] = '\n';
-        buffer_idx[active_buffer] += 1;
-        terminal_print_char('\n');
-        terminal_mode[active_buffer] = KBMODE_SYS_READ_FINISHED;
-
-        active_buffer = prev_active_buffer; //restore active buffer
+    if(shift_is_held() && (value == PAGE_UP_PRESSED || value == PAGE_DOWN_PRESSED)){
+        terminal_scroll_view((value == PAGE_UP_PRESSED) ? NUM_ROWS - 1 : 1 - NUM_ROWS); //keep a row of the old page on screen
         return;
     }
+    if(terms[displayed_terminal]->view_offset != 0 && (get_char(value) != 0 || value == ENTER_PRESSED || value == BACKSPACE_PRESSED || value == TAB_PRESSED)){
+        terminal_scroll_view(-terms[displayed_terminal]->view_offset); //typing goes back to the live screen
+    }
 
-    if(terminal_mode[active_buffer] == KBMODE_OFF || terminal_mode[active_buffer] == KBMODE_SYS_WRITE){ 
-        //if the terminal is busy or the keyboard writing is switched off, do not do anything with this value
-        active_buffer = prev_active_buffer; //restore active buffer
+    fn_terminal = fn_key_terminal(value);
+    if(alt_is_held() && fn_terminal != -1){
+        //the terminal is opened the first time it is shown
+        if(displayed_terminal != fn_terminal && open_terminal(fn_terminal) == 0){
+            set_displayed_terminal(fn_terminal);
+        }
         return;
     }
-    if(ctrl_is_held()){ //handle ctrl + letter functions
-        switch(c){
-            case 'l': //ctrl + l
-                /*clear screen and put cursor to top*/
-                clear();
-                if(terminal_mode[active_buffer]==KBMODE_TERMINAL_WRITE){
-                    //clear the buffer if we are not in read mode
-                    indexed_buffer_clear(active_buffer);
-                }else if(terminal_mode[active_buffer] == KBMODE_SYS_READ){
-                    print_displayed_buffer_to_screen();
-                }
-                break;
-            case 'L': //ctrl + L
-                /*clear screen and put cursor to top*/
-                clear();
-                if(terminal_mode[active_buffer]==KBMODE_TERMINAL_WRITE){
-                    //clear the buffer if we are not in read mode
-                    indexed_buffer_clear(active_buffer);
-                }else if(terminal_mode[active_buffer] == KBMODE_SYS_READ){
-                    print_displayed_buffer_to_screen();
-                }
-                break;
-            default:
-                break;
-        }
-    }else{ //ctrl is not held
-        if(c!=0){
-            buffer_push(c, active_buffer);
-            active_buffer = prev_active_buffer; //restore active buffer
-            return;
-        }else{ //if character is not alphanumeric or a valid symbol check for these
-            switch(value){
-                case BACKSPACE_PRESSED:
-                    buffer_pop(active_buffer);//delete last_char of buffer
-                    break;
-                case TAB_PRESSED:
-                    for(i=0; i<tab_width; i++){ //add tab_width number of spaces to buffer
-                        if(pointer_x[active_buffer] == NUM_COLS){ //unless we are at the end of the row
-                            break;
-                        }else{
-                            buffer_push(' ', active_buffer);
-                        }
-                    }
-                    break;
-            }
-        } //end of other key press checks
-    } //end of ctrl is not held
 
-    active_buffer = prev_active_buffer; //restore active buffer
+    kstat.keys++;
+    if(key_queue_put(value, displayed_terminal) == -1){
+        kstat.keys_dropped++;
+    }
 }
 
 /* read_from_terminal
  * 
- * DESCRIPTION: This function will read a line from the user through the terminal and write it to the location in memory.
- *              Will try to write (num_chars + 1) characters since the last character is always '\n'.
+ * DESCRIPTION: Reads typed input. In canonical mode this waits for a whole line and stops after
+ *              its '\n', in raw mode it waits for at least one character. With TERM_NONBLOCK
+ *              it does not wait. Input typed before the read is kept for it.
  * 
  * INPUTS: buf          -- pointer to where to write the characters to
- *         num_chars    -- max number of chars to write to the terminal (limited to one buffers length [127 + '\n'], otherwise [num_chars + '\n'])
- * OUTPUTS: Writes the terminal buffer to the location in memory.
+ *         num_chars    -- max number of chars to write, the rest of a longer line is left for the next read
+ * OUTPUTS: Writes the input to the location in memory.
  * RETURN VALUE: number of bytes transferred
- * SIDE EFFECTS: Currently also writes the '\n' at the end of the buffer. Also clears the buffer.
+ * SIDE EFFECTS: none
  */
 int read_from_terminal(int fd, void* buf, int num_chars){
     int read_buffer = active_buffer;
-    int prev_mode = terminal_mode[read_buffer]; //save the previous keyboard mode
-    int i; //counter
+    uint32_t flags;
+    char c;
+    int i = 0; //counter
     if(buf==0){ //check for null_pointers
         return 0;
     }
 
-    buffer_start[read_buffer]=0;
-    buffer_idx[read_buffer]=0;
+    terminal_flush(); //show a prompt written without a newline
+    while(1){
+        terminal_input();
+        if((terms[read_buffer]->flags & TERM_CANON) ? terms[read_buffer]->input_lines > 0 : terms[read_buffer]->input_count > 0){
+            break;
+        }
+        if(terms[read_buffer]->flags & TERM_NONBLOCK){
+            return 0;
+        }
+        process_yield(); //let the other processes run until a line is typed
+    }
 
-    terminal_mode[read_buffer] = KBMODE_SYS_READ;
-    if(num_chars > KB_BUFFER_SIZE-1){
-        num_chars = KB_BUFFER_SIZE-1;
+    cli_and_save(flags);
+    while(i < num_chars && terms[read_buffer]->input_count > 0){
+        c = terms[read_buffer]->input[terms[read_buffer]->input_head];
+        terms[read_buffer]->input_head = (terms[read_buffer]->input_head + 1) & (TERM_INPUT_SIZE - 1);
+        terms[read_buffer]->input_count--;
+        ((char *) buf)[i++] = c;
+        if(c == '\n'){
+            terms[read_buffer]->input_lines--;
+            if(terms[read_buffer]->flags & TERM_CANON){ //one line per read
+                break;
+            }
+        }
     }
-    max_chars = num_chars;
-    while(terminal_mode[read_buffer] == KBMODE_SYS_READ){;}
-    for(i=0; i<buffer_idx[read_buffer]; i++){
-        ((char *) buf)[i] = buffer[read_buffer][i];
-        if(buffer[read_buffer][i] == '\n'){
-            break;
+    restore_flags(flags);
+    return i;
+}
+
+/* terminal_set_mode
+ * 
+ * DESCRIPTION: Sets the line discipline flags of a terminal. A line that was being typed
+ *              when canonical mode is turned off is handed to read as it is.
+ * 
+ * INPUTS: terminal_num -- index of the terminal
+ *         mode         -- TERM_* flags
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void terminal_set_mode(int terminal_num, int mode){
+    uint32_t flags;
+    int i;
+
+    cli_and_save(flags);
+    if((terms[terminal_num]->flags & TERM_CANON) && !(mode & TERM_CANON)){
+        for(i = 0; i < terms[terminal_num]->line_len; i++){
+            input_put(terms[terminal_num]->line[i], terminal_num);
         }
+        terms[terminal_num]->line_len = 0;
+    }
+    terms[terminal_num]->flags = mode;
+    restore_flags(flags);
+}
+
+/* terminal_ioctl
+ * 
+ * DESCRIPTION: Gets or sets the line discipline flags of the terminal of the running program.
+ * 
+ * INPUTS: fd      -- unused
+ *         request -- TERM_GET_MODE or TERM_SET_MODE
+ *         arg     -- TERM_* flags for TERM_SET_MODE
+ * OUTPUTS: none
+ * RETURN VALUE: the flags for TERM_GET_MODE, 0 for TERM_SET_MODE, -1 for anything else
+ * SIDE EFFECTS: none
+ */
+int terminal_ioctl(int fd, int request, int arg){
+    switch(request){
+        case TERM_GET_MODE:
+            return terms[active_buffer]->flags;
+        case TERM_SET_MODE:
+            if(arg & ~TERM_MODE_MASK){
+                return -1;
+            }
+            terminal_set_mode(active_buffer, arg);
+            return 0;
+        default:
+            return -1;
     }
-    max_chars = KB_BUFFER_SIZE;
-    terminal_mode[read_buffer] = prev_mode;
-    indexed_buffer_clear(read_buffer);
-    return i+1;
 }
 
 /* write_to_terminal
@@ -719,26 +1458,60 @@ int read_from_terminal(int fd, void* buf, int num_chars){
  * INPUTS: string_to_write -- pointer to the location to start reading characters from
  *         n_chars         -- number of characters to write to the terminal
  * OUTPUTS: Outputs the characters to the terminal.
- * RETURN VALUE: none
- * SIDE EFFECTS: Clears the current buffer.
+ * RETURN VALUE: 0, -1 for a NULL buffer
+ * SIDE EFFECTS: none
  */
 int write_to_terminal(int fd, const void* string_to_write, int n_chars){
-    int write_buffer = active_buffer;
-    int prev_mode = terminal_mode[write_buffer];
-    int i = 0; //counter
+    iovec_t iov;
 
     if(string_to_write==0){ //check for null_pointers
         return -1;
     }
 
-    terminal_mode[write_buffer] = KBMODE_SYS_WRITE;
-    buffer_start[write_buffer]=0;
-    buffer_idx[write_buffer]=0;
-    for(i=0; i<n_chars; i++){
-        buffer_push(((char * )string_to_write)[i], write_buffer);
+    iov.base = (void *) string_to_write;
+    iov.len = n_chars;
+    if (writev_to_terminal(fd, &iov, 1) == -1) {
+        return -1;
     }
-    terminal_mode[write_buffer] = prev_mode;
-    indexed_buffer_clear(write_buffer);
-
     return 0;
 }
+
+/* writev_to_terminal
+ * 
+ * DESCRIPTION: Writes several buffers to the terminal one after the other.
+ *              Output does not go through the keyboard buffer, so a line the
+ *              user is typing is kept, and the cursor is moved once at the end.
+ * 
+ * INPUTS: iov    -- the buffers
+ *         iovcnt -- number of buffers
+ * OUTPUTS: Outputs the characters to the terminal.
+ * RETURN VALUE: total number of characters written, -1 for a NULL buffer
+ * SIDE EFFECTS: none
+ */
+int writev_to_terminal(int fd, const iovec_t* iov, int iovcnt){
+    int write_buffer = active_buffer;
+    int total = 0;
+    uint32_t start_low, end_low, high;
+    int i; //counter
+
+    for(i=0; i<iovcnt; i++){ //check for null_pointers before writing anything
+        if(iov[i].base==0){
+            return -1;
+        }
+    }
+
+    asm volatile ("rdtsc" : "=a"(start_low), "=d"(high));
+    for(i=0; i<iovcnt; i++){
+        buffer_output(write_buffer, (const char *) iov[i].base, iov[i].len);
+        total += iov[i].len;
+    }
+    if(write_buffer == displayed_terminal){
+        terminal_flush();
+    }
+    asm volatile ("rdtsc" : "=a"(end_low), "=d"(high));
+
+    kstat.term_writes++;
+    kstat.term_chars += total;
+    kstat.term_cycles += end_low - start_low;
+    return total;
+}
@@ -1,22 +1,37 @@
+#include "file_driver.h"
+
 #ifndef _TERMINAL_H
 #define _TERMINAL_H
 
-#define KB_BUFFER_SIZE 128
+#define KB_BUFFER_SIZE 128 // longest line that can be typed, with its newline
 
 /* Define Keyboard Modes */
 #define KBMODE_OFF -1
 #define KBMODE_TERMINAL_WRITE 0
-#define KBMODE_SYS_READ 1
-#define KBMODE_SYS_WRITE 2
-#define KBMODE_SYS_READ_FINISHED 3
+
+/* line discipline flags, changed with ioctl */
+#define TERM_CANON 0x1 // read waits for a whole line, which can be edited while it is typed
+#define TERM_ECHO 0x2 // typed characters show up on the screen
+#define TERM_NONBLOCK 0x4 // read returns 0 instead of waiting for input
+#define TERM_MODE_MASK (TERM_CANON | TERM_ECHO | TERM_NONBLOCK)
+#define TERM_MODE_DEFAULT (TERM_CANON | TERM_ECHO)
+
+/* terminal ioctl requests */
+#define TERM_GET_MODE 0
+#define TERM_SET_MODE 1
+
+#define TERM_INPUT_SIZE 512 // typed input waiting to be read, a power of two
+#define CTRL_KEY_MASK 0x1F // ctrl + letter in raw mode
+#define ASCII_BACKSPACE 0x08
 
 #define VIDEO       0xB8000
-#define TERM1_VIDEO       0xB9000
-#define TERM2_VIDEO       0xBA000
-#define TERM3_VIDEO       0xBB000
-#define TERM_VIDEO_SIZE   0x01000
+#define VIDEO_MEM_SIZE    0x8000 // text mode video memory runs from VIDEO to 0xBFFFF
+#define TERM_VIDEO_SIZE   0x01000 // one screen fits in the page a program vidmaps
 #define NUM_COLS    80
 #define NUM_ROWS    25
+#define ROW_BYTES   (NUM_COLS * 2)
+#define SCREEN_BYTES    (NUM_ROWS * ROW_BYTES)
+#define VIDEO_MEM_ROWS  (VIDEO_MEM_SIZE / ROW_BYTES)
 #define ATTRIB    0x7
 #define GRAY      0x7
 #define BLUE      0x1
@@ -24,7 +39,109 @@
 #define CYAN      0x3
 #define PURPLE    0x5
 
-#define MAX_TERMINALS 3
+#define MAX_TERMINALS 12 // one for each of Alt+F1 to Alt+F12
+
+/* VT100 escape sequences understood by write */
+#define VT_ESC 0x1B
+#define VT_NORMAL 0 // plain text
+#define VT_ESCAPE 1 // after ESC
+#define VT_CSI 2 // after ESC [
+#define VT_MAX_PARAMS 8
+#define VT_PARAM_MAX 1000 // stop growing a parameter past this
+#define VT_FINAL_START 0x40 // characters that end a CSI sequence
+#define VT_FINAL_END 0x7E
+#define VT_ERASE_TO_END 0 // J and K modes
+#define VT_ERASE_TO_START 1
+#define VT_ERASE_ALL 2
+#define VT_NUM_COLORS 8
+
+#define SGR_RESET 0
+#define SGR_BOLD 1
+#define SGR_REVERSE 7
+#define SGR_FG 30
+#define SGR_FG_DEFAULT 39
+#define SGR_BG 40
+#define SGR_BG_DEFAULT 49
+
+#define ATTRIB_SET 0x100 // an SGR attribute replaces the terminal's color
+#define ATTRIB_FG 0x0F
+#define ATTRIB_FG_COLOR 0x07
+#define ATTRIB_BRIGHT 0x08
+
+typedef struct vt_state {
+    int state;
+    int params[VT_MAX_PARAMS];
+    int num_params;
+    int top; // first row of the scroll region
+    int bottom_margin; // rows below the scroll region
+    int saved_x; // cursor saved by ESC 7
+    int saved_y;
+} vt_state_t;
+
+#define TERM_SCROLLBACK_ROWS 1000 // rows kept per terminal after they scroll off the screen
+
+/* a row of scrollback, the characters keep the color of the first one */
+typedef struct __attribute__((packed)) scrollback_row {
+    uint8_t attrib;
+    char text[NUM_COLS];
+} scrollback_row_t;
+
+/* A terminal. It is drawn into its screen memory, laid out like VGA text
+ * memory. origin is the row of screen memory shown at the top of the
+ * screen, so scrolling moves it down a row instead of copying the screen.
+ * Rows of the displayed terminal that changed are copied to the same rows
+ * of VGA memory by terminal_flush, which also points the CRTC at origin.
+ *
+ * Rows that scrolled off the top of the screen go into a ring of packed
+ * rows, the newest is right before scrollback_head. view_offset is how
+ * many rows back from the live screen the terminal is being shown.
+ *
+ * Key presses are handed to the line discipline by terminal_input. In
+ * canonical mode a line is edited in line and moved to input once enter
+ * is pressed, in raw mode every key goes to input.
+ */
+typedef struct terminal {
+    int pointer_x; // next x pos to write a char
+    int pointer_y; // next y pos to write a char
+    uint8_t * mem; // VIDEO_MEM_SIZE bytes of screen memory
+    int origin;
+    int vidmapped; // a program writes to the screen directly, keep it at origin 0
+    vt_state_t vt; // escape sequence parser, colors and scroll region set through write
+    uint16_t attrib; // ATTRIB_SET and the attribute chosen with SGR, 0 for the terminal's color
+
+    scrollback_row_t * scrollback; // TERM_SCROLLBACK_ROWS rows
+    int scrollback_head;
+    int scrollback_count;
+    int view_offset;
+
+    int kb_mode; // KBMODE_*
+    int flags; // TERM_* line discipline flags
+    char line[KB_BUFFER_SIZE]; // line being typed
+    int line_len;
+    char input[TERM_INPUT_SIZE]; // circular queue of typed input for read
+    int input_head; // next character to read
+    int input_count; // characters waiting
+    int input_lines; // newlines waiting
+} terminal_t;
+
+/* dirty bitmap over the rows of screen memory */
+#define DIRTY_WORD_BITS 32
+#define DIRTY_WORD_SHIFT 5
+#define DIRTY_WORDS ((VIDEO_MEM_ROWS + DIRTY_WORD_BITS - 1) / DIRTY_WORD_BITS)
+
+/* VGA CRTC registers */
+#define CRTC_INDEX_PORT 0x3D4
+#define CRTC_DATA_PORT  0x3D5
+#define CRTC_START_HIGH 0x0C // first cell of video memory shown on screen
+#define CRTC_START_LOW  0x0D
+#define CRTC_CURSOR_HIGH    0x0E
+#define CRTC_CURSOR_LOW     0x0F
+
+void terminal_init();
+int terminal_create(int terminal_num);
+int terminal_exists(int terminal_num);
+void terminal_flush();
+void terminal_scroll_view(int rows);
 
 void enable_write_to_screen(int terminal_index);
 void disable_write_to_screen(int terminal_index);
@@ -37,18 +154,22 @@ int get_screen_x();
 int get_screen_y();
 
 void terminal_print_char(char c);
-void buffer_clear();
 
 int terminal_open(const unsigned char * garbage);
 int terminal_close(int fd);
 int read_from_terminal(int fd, void* buf, int num_bytes);
 int write_to_terminal(int fd, const void* string_to_write, int n_chars);
+int writev_to_terminal(int fd, const iovec_t* iov, int iovcnt);
 
 void clear();
 void terminal_driver();
+void terminal_input();
+int terminal_ioctl(int fd, int request, int arg);
+void terminal_set_mode(int terminal_num, int mode);
 
 void set_displayed_terminal(int terminal_num);
 int get_displayed_terminal();
+void terminal_set_vidmapped(int terminal_num, int mapped);
 void set_active_buffer(int buffer_num);
 int get_active_buffer();
 
@@ -9,6 +9,16 @@
 #include "syscall.h"
 #include "process.h"
 #include "networking.h"
+#include "devfs.h"
+#include "procfs.h"
+#include "bcache.h"
+#include "kstat.h"
+#include "palloc.h"
+#include "paging.h"
+#include "pty.h"
+#include "pipe.h"
+#include "shm.h"
+#include "futex.h"
 
 // #define MANUAL_TEST
 
@@ -27,6 +37,10 @@
 
 #define DEREF_TEST_STRIDE 64
 
+#define HWSCROLL_LINES 250 // more than fit in video memory, so the screen wraps around
+#define TERMOUT_LEN 90 // "ab\n" and a line that wraps onto a second row
+#define SCROLLBACK_LINES 60
+
 #define RTC_TESTS_NONE 0
 #define RTC_TESTS_CP1 1
 #define RTC_TESTS_FREQ 2
@@ -610,6 +624,1120 @@ int networking_start_test() {
 	return PASS;
 }
 
+/* devfs TEST
+*  checks that the null, zero and urandom devices are registered and
+	behave as bulk sources and sinks, and that unknown names fail
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: None
+*/
+int devfs_test() {
+	TEST_HEADER;
+	char buf[TEST_BUF_SIZE];
+	file_ops_t * ops;
+	int i, nonzero = 0;
+
+	if (dev_lookup_path((int8_t*) "/dev/does_not_exist") != NULL) {
+		return FAIL;
+	}
+
+	ops = dev_lookup_path((int8_t*) "/dev/zero");
+	memset(buf, 0xAB, TEST_BUF_SIZE);
+	if (ops == NULL || ops->read_func(0, buf, TEST_BUF_SIZE) != TEST_BUF_SIZE) {
+		return FAIL;
+	}
+	for (i = 0; i < TEST_BUF_SIZE; i++) {
+		if (buf[i] != 0) {
+			return FAIL;
+		}
+	}
+
+	ops = dev_lookup_path((int8_t*) "/dev/null");
+	if (ops == NULL || ops->read_func(0, buf, TEST_BUF_SIZE) != 0 ||
+		ops->write_func(0, buf, TEST_BUF_SIZE) != TEST_BUF_SIZE) {
+		return FAIL;
+	}
+
+	ops = dev_lookup_path((int8_t*) "/dev/urandom");
+	if (ops == NULL || ops->read_func(0, buf, TEST_BUF_SIZE - 1) != TEST_BUF_SIZE - 1) {
+		return FAIL;
+	}
+	for (i = 0; i < TEST_BUF_SIZE - 1; i++) {
+		nonzero |= buf[i];
+	}
+	if (!nonzero) {
+		return FAIL;
+	}
+
+	if (dev_lookup_path((int8_t*) "/dev/rtc") == NULL || dev_lookup_path((int8_t*) "/dev/terminal") == NULL) {
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* procfs TEST
+*  checks that /proc files resolve, that their text can be read in pieces,
+	that a read from the start takes a new snapshot once a counter moved
+	and that the directory lists every entry
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: None
+*/
+int procfs_test() {
+	TEST_HEADER;
+	char buf[TEST_BUF_SIZE];
+	char again[TEST_BUF_SIZE];
+	file_ops_t * ops;
+	file_object_t file;
+	int read, entries = 0;
+
+	if (proc_lookup_path((int8_t*) "/proc/does_not_exist") != NULL) {
+		return FAIL;
+	}
+
+	ops = proc_lookup_path((int8_t*) "/proc/stat");
+	if (ops == NULL || -1 == (file.inode = ops->open_func((uint8_t*) "/proc/stat"))) {
+		return FAIL;
+	}
+	file.curr_offset = 0;
+	if (ops->read_func((int32_t) &file, buf, 5) != 5 || strncmp(buf, "ticks", 5)) {
+		return FAIL;
+	}
+	// the rest of the snapshot comes back in later reads, then end of file
+	while ((read = ops->read_func((int32_t) &file, buf, TEST_BUF_SIZE)) > 0);
+	if (read != 0 || ops->write_func((int32_t) &file, buf, 1) != -1) {
+		return FAIL;
+	}
+
+	// a counter that moved shows up when the file is read again
+	file.curr_offset = 0;
+	read = ops->read_func((int32_t) &file, buf, TEST_BUF_SIZE);
+	kstat.context_switches++;
+	file.curr_offset = 0;
+	if (read != ops->read_func((int32_t) &file, again, TEST_BUF_SIZE) || strncmp(buf, again, read) == 0) {
+		kstat.context_switches--;
+		return FAIL;
+	}
+	kstat.context_switches--;
+
+	ops = proc_lookup_path((int8_t*) "/proc");
+	if (ops == NULL) {
+		return FAIL;
+	}
+	file.inode = 0;
+	file.curr_offset = 0;
+	while (ops->read_func((int32_t) &file, buf, TEST_BUF_SIZE) > 0) {
+		entries++;
+	}
+	if (entries != 5) {
+		return FAIL;
+	}
+	return PASS;
+}
+
+static block_request_t * fake_blk_reqs;
+static int fake_blk_count;
+static int fake_blk_fails; // waits left that fail every request
+
+/* fake block device, requests stay pending until the wait */
+static int32_t fake_blk_submit(block_dev_t * dev, block_request_t * reqs, int count) {
+	fake_blk_reqs = reqs;
+	fake_blk_count = count;
+	return 0;
+}
+
+static void fake_blk_wait(block_dev_t * dev) {
+	int i;
+	for (i = 0; i < fake_blk_count; i++) {
+		fake_blk_reqs[i].status = (fake_blk_fails > 0) ? BLOCK_ERROR : BLOCK_DONE;
+	}
+	if (fake_blk_fails > 0) {
+		fake_blk_fails--;
+	}
+	fake_blk_count = 0;
+}
+
+/* READAHEAD TEST
+*  fails a read-ahead, then checks that reading the block again caches it
+	so the next read is a hit
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Leaves the block of a fake device in the cache
+*/
+int readahead_test() {
+	TEST_HEADER;
+	static block_dev_t fake = {
+		.name = "fake",
+		.num_sectors = 64 * BCACHE_BLOCK_SECTORS,
+		.submit_func = fake_blk_submit,
+		.wait_func = fake_blk_wait
+	};
+	uint32_t block = 5;
+	bcache_buf_t * first;
+	bcache_buf_t * second;
+	uint32_t hits;
+
+	fake_blk_fails = 1;
+	bcache_readahead(&fake, &block, 1);
+	if (NULL == (first = bcache_get(&fake, block))) { // the read-ahead fails, the read does not
+		return FAIL;
+	}
+	bcache_release(first);
+	hits = kstat.bcache_hits;
+	second = bcache_get(&fake, block);
+	bcache_release(second);
+	if (second != first || kstat.bcache_hits != hits + 1) {
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* bcache TEST
+*  reads the first block of the first disk twice and checks that the
+	second read is served from the same cache buffer
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: None
+*/
+int bcache_test() {
+	TEST_HEADER;
+	block_dev_t * dev = block_get(0);
+	bcache_buf_t * first;
+	bcache_buf_t * second;
+	uint32_t hits;
+
+	if (dev == NULL) {
+		printf("no disk attached\n");
+		return PASS;
+	}
+	if (NULL == (first = bcache_get(dev, 0))) {
+		return FAIL;
+	}
+	hits = kstat.bcache_hits;
+	second = bcache_get(dev, 0);
+	bcache_release(first);
+	bcache_release(second);
+	if (second != first || kstat.bcache_hits != hits + 1) {
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* block batch TEST
+*  submits adjacent and non-adjacent reads to the first disk as one batch
+	and compares them with a plain synchronous read
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: None
+*/
+int block_batch_test() {
+	TEST_HEADER;
+	block_dev_t * dev = block_get(0);
+	block_request_t reqs[3];
+	uint8_t batch[3][BLOCK_SECTOR_SIZE];
+	uint8_t plain[4 * BLOCK_SECTOR_SIZE];
+	uint32_t lbas[3] = {0, 1, 3}; // first two merge, the third is a separate command
+	int i, j;
+
+	if (dev == NULL) {
+		printf("no disk attached\n");
+		return PASS;
+	}
+	for (i = 0; i < 3; i++) {
+		reqs[i].lba = lbas[i];
+		reqs[i].count = 1;
+		reqs[i].buf = batch[i];
+		reqs[i].write = 0;
+	}
+	if (block_submit(dev, reqs, 3)) {
+		return FAIL;
+	}
+	block_wait(dev);
+	if (block_read(dev, 0, 4, plain)) {
+		return FAIL;
+	}
+	for (i = 0; i < 3; i++) {
+		if (reqs[i].status != BLOCK_DONE) {
+			return FAIL;
+		}
+		for (j = 0; j < BLOCK_SECTOR_SIZE; j++) {
+			if (batch[i][j] != plain[lbas[i] * BLOCK_SECTOR_SIZE + j]) {
+				return FAIL;
+			}
+		}
+	}
+	return PASS;
+}
+
+/* mmap TEST
+*  checks that the block addresses used for mappings hold the same bytes
+	read_data copies out of frame0.txt
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: None
+*/
+int mmap_test() {
+	TEST_HEADER;
+	dentry_t dentry;
+	uint8_t buf[TEST_BUF_SIZE];
+	uint32_t addr;
+	int i, read;
+
+	if (read_dentry_by_name((uint8_t*) "frame0.txt", &dentry)) {
+		return FAIL;
+	}
+	if (read_block_addr(dentry.inode_num, 0, &addr)) {
+		printf("filesystem is not mappable\n");
+		return PASS;
+	}
+	if ((addr & (FS_BLOCK_SIZE - 1)) || 0 >= (read = read_data(dentry.inode_num, 0, buf, TEST_BUF_SIZE))) {
+		return FAIL;
+	}
+	for (i = 0; i < read; i++) {
+		if (buf[i] != ((uint8_t*) addr)[i]) {
+			return FAIL;
+		}
+	}
+	// past the end of the file there is nothing to map
+	if (read_block_addr(dentry.inode_num, read_file_length(dentry.inode_num) / FS_BLOCK_SIZE + 1, &addr) != -1) {
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* file length TEST
+*  checks that the size stat reports for a file matches the number of
+	bytes read_data returns before end of file, and that reading at an
+	offset returns the same bytes as reading through to it
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: None
+*/
+int file_length_test() {
+	TEST_HEADER;
+	dentry_t dentry;
+	uint8_t buf[TEST_BUF_SIZE];
+	uint8_t second_chunk[TEST_BUF_SIZE];
+	int32_t length, read, total = 0;
+
+	if (read_dentry_by_name((uint8_t*) "frame1.txt", &dentry)) {
+		return FAIL;
+	}
+	if (-1 == (length = read_file_length(dentry.inode_num)) || read_file_length(-1) != -1) {
+		return FAIL;
+	}
+	while (0 < (read = read_data(dentry.inode_num, total, buf, TEST_BUF_SIZE))) {
+		if (total == TEST_BUF_SIZE) {
+			memcpy(second_chunk, buf, TEST_BUF_SIZE);
+		}
+		total += read;
+	}
+	if (total != length || length < 2 * TEST_BUF_SIZE) {
+		return FAIL;
+	}
+	// jump straight to the second chunk
+	if (read_data(dentry.inode_num, TEST_BUF_SIZE, buf, TEST_BUF_SIZE) != TEST_BUF_SIZE) {
+		return FAIL;
+	}
+	return strncmp((int8_t*) buf, (int8_t*) second_chunk, TEST_BUF_SIZE) ? FAIL : PASS;
+}
+
+/* palloc TEST
+*  allocates runs of pages, checks they are in the pool, don't overlap,
+	are writable and that freed pages are handed out again, and that no
+	page of the pool is in the NIC memory
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: None
+*/
+int palloc_test() {
+	TEST_HEADER;
+	uint8_t * one;
+	uint8_t * run;
+	uint8_t * again;
+	uint32_t used = kstat.pages_used;
+	int result = PASS;
+
+	if (NULL == (one = palloc(1)) || NULL == (run = palloc(3))) {
+		return FAIL;
+	}
+	if ((uint32_t) one < PALLOC_START || (uint32_t) run + 3 * PALLOC_PAGE_SIZE > PALLOC_END) {
+		return FAIL;
+	}
+	if (run < one + PALLOC_PAGE_SIZE && one < run + 3 * PALLOC_PAGE_SIZE) {
+		return FAIL;
+	}
+	memset(run, 0xAB, 3 * PALLOC_PAGE_SIZE);
+	memset(one, 0, PALLOC_PAGE_SIZE);
+	if (run[3 * PALLOC_PAGE_SIZE - 1] != 0xAB || kstat.pages_used != used + 4) {
+		return FAIL;
+	}
+	// first fit gives back the page that was freed
+	pfree(one, 1);
+	again = palloc(1);
+	pfree(again, 1);
+	pfree(run, 3);
+	if (again != one || kstat.pages_used != used || palloc(PALLOC_NUM_PAGES + 1) != NULL) {
+		return FAIL;
+	}
+
+	// no page of the pool is in the memory the NIC DMAs into, each page
+	// taken holds the one taken before it so they can be given back
+	run = NULL;
+	while (NULL != (one = palloc(1))) {
+		if ((uint32_t) one < PALLOC_START || (uint32_t) one + PALLOC_PAGE_SIZE > NIC_MEM_START) {
+			result = FAIL;
+		}
+		*(uint8_t **) one = run;
+		run = one;
+	}
+	while (run != NULL) {
+		one = *(uint8_t **) run;
+		pfree(run, 1);
+		run = one;
+	}
+	if (kstat.pages_used != used) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* getdents TEST
+*  reads the directory in small batches and checks every entry comes back
+	once, in order, with the size of regular files filled in
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: None
+*/
+int getdents_test() {
+	TEST_HEADER;
+	file_object_t dir;
+	dentry_t dentry;
+	dirent_t * dirent;
+	uint8_t buf[TEST_BUF_SIZE * 2];
+	int32_t read, pos, index = 0;
+
+	dir.inode = get_dir_inode();
+	dir.curr_offset = 0;
+	// too small for even one entry
+	if (dir_getdents((int32_t) &dir, buf, sizeof(dirent_t)) != -1 || dir.curr_offset != 0) {
+		return FAIL;
+	}
+	while (0 < (read = dir_getdents((int32_t) &dir, buf, sizeof(buf)))) {
+		for (pos = 0; pos < read; pos += sizeof(dirent_t) + dirent->name_len) {
+			dirent = (dirent_t *) (buf + pos);
+			if (read_dentry_by_index(index++, &dentry) || dirent->type != dentry.filetype) {
+				return FAIL;
+			}
+			if (strncmp((int8_t *) (dirent + 1), (int8_t *) dentry.filename, dirent->name_len)) {
+				return FAIL;
+			}
+			if (dentry.filetype == FILE_TYPE_FILE && dirent->size != read_file_length(dentry.inode_num)) {
+				return FAIL;
+			}
+		}
+	}
+	// everything was listed
+	return (read == 0 && read_dentry_by_index(index, &dentry) == -1) ? PASS : FAIL;
+}
+
+/* readv TEST
+*  reads a file into two buffers with one fs_readv and checks they hold
+	the same bytes as one read_data of the whole range
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: None
+*/
+int readv_test() {
+	TEST_HEADER;
+	dentry_t dentry;
+	file_object_t file;
+	iovec_t iov[2];
+	uint8_t first[TEST_BUF_SIZE / 2];
+	uint8_t second[TEST_BUF_SIZE / 2];
+	uint8_t whole[TEST_BUF_SIZE];
+
+	if (read_dentry_by_name((uint8_t*) "frame0.txt", &dentry)) {
+		return FAIL;
+	}
+	if (read_data(dentry.inode_num, 0, whole, TEST_BUF_SIZE) != TEST_BUF_SIZE) {
+		return FAIL;
+	}
+	file.inode = dentry.inode_num;
+	file.curr_offset = 0;
+	iov[0].base = first;
+	iov[0].len = sizeof(first);
+	iov[1].base = second;
+	iov[1].len = sizeof(second);
+	if (fs_readv((int32_t) &file, iov, 2) != TEST_BUF_SIZE || file.curr_offset != TEST_BUF_SIZE) {
+		return FAIL;
+	}
+	if (strncmp((int8_t*) first, (int8_t*) whole, sizeof(first)) ||
+		strncmp((int8_t*) second, (int8_t*) whole + sizeof(first), sizeof(second))) {
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* screen_start
+*  reads the first cell of video memory shown on screen from the CRTC
+*  Inputs: None
+*  Outputs: cell index
+*  Side Effects: None
+*/
+static uint16_t screen_start() {
+	uint16_t start;
+	outb(CRTC_START_HIGH, CRTC_INDEX_PORT);
+	start = inb(CRTC_DATA_PORT) << 8;
+	outb(CRTC_START_LOW, CRTC_INDEX_PORT);
+	start |= inb(CRTC_DATA_PORT);
+	return start;
+}
+
+/* hardware scroll TEST
+*  writes enough lines to scroll through all of video memory and checks
+	the screen the CRTC start address points at ends with the last line
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Scrolls the screen
+*/
+int hwscroll_test() {
+	TEST_HEADER;
+	char line[2];
+	uint16_t start;
+	uint16_t* row;
+	int i;
+
+	line[1] = '\n';
+	for (i = 0; i < HWSCROLL_LINES; i++) {
+		line[0] = 'a' + (i % 26);
+		write_to_terminal(1, line, 2);
+	}
+	if (get_screen_y() != NUM_ROWS - 1) {
+		return FAIL;
+	}
+	start = screen_start();
+	if (start % NUM_COLS != 0 || start + NUM_ROWS * NUM_COLS > VIDEO_MEM_SIZE / 2) {
+		return FAIL;
+	}
+	// the last line sits right above the empty row the cursor is on
+	row = (uint16_t*) VIDEO_START + start + (NUM_ROWS - 2) * NUM_COLS;
+	if ((char) row[0] != line[0] || (char) row[NUM_COLS] != ' ') {
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* terminal output TEST
+*  writes a short line and one longer than a row and checks every
+	character landed in its cell and the cursor ends up after them
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Clears the screen
+*/
+int termout_test() {
+	TEST_HEADER;
+	char text[TERMOUT_LEN];
+	uint16_t* screen;
+	int i;
+
+	text[0] = 'a';
+	text[1] = 'b';
+	text[2] = '\n';
+	for (i = 3; i < TERMOUT_LEN; i++) {
+		text[i] = 'x';
+	}
+	clear();
+	if (write_to_terminal(1, text, TERMOUT_LEN) != 0) {
+		return FAIL;
+	}
+	// 'ab' on the first row, then a full row of x and the rest on the next
+	if (get_screen_y() != 2 || get_screen_x() != TERMOUT_LEN - 3 - NUM_COLS) {
+		return FAIL;
+	}
+	screen = (uint16_t*) VIDEO_START + screen_start();
+	if ((char) screen[0] != 'a' || (char) screen[1] != 'b' || (char) screen[2] != ' ') {
+		return FAIL;
+	}
+	for (i = NUM_COLS; i < 2 * NUM_COLS + get_screen_x(); i++) {
+		if ((char) screen[i] != 'x') {
+			return FAIL;
+		}
+	}
+	return ((char) screen[i] == ' ') ? PASS : FAIL;
+}
+
+/* terminal switch TEST
+*  writes to the displayed terminal, switches away, writes more and
+	switches back, checking only the displayed terminal is in VGA memory
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Clears the screen, switches terminals
+*/
+int switch_test() {
+	TEST_HEADER;
+	uint32_t switches = kstat.term_switches;
+	uint16_t* screen;
+
+	clear();
+	write_to_terminal(1, "ab", 2);
+	terminal_create(TERMINAL_2);
+	set_displayed_terminal(TERMINAL_2);
+	// the test writes to the terminal it started on, now in the background
+	write_to_terminal(1, "cd", 2);
+	screen = (uint16_t*) VIDEO_START + screen_start();
+	if ((char) screen[0] == 'a' || (char) screen[2] == 'c') {
+		set_displayed_terminal(TERMINAL_1);
+		return FAIL;
+	}
+	set_displayed_terminal(TERMINAL_1);
+	screen = (uint16_t*) VIDEO_START + screen_start();
+	if ((char) screen[0] != 'a' || (char) screen[1] != 'b' ||
+		(char) screen[2] != 'c' || (char) screen[3] != 'd') {
+		return FAIL;
+	}
+	return (kstat.term_switches == switches + 2) ? PASS : FAIL;
+}
+
+/* terminal flush TEST
+*  checks a write that changes one row copies just that row to VGA
+	memory, once, at the end of the write
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Clears the screen
+*/
+int flush_test() {
+	TEST_HEADER;
+	uint32_t flushes, rows;
+	uint16_t* screen;
+
+	clear();
+	flushes = kstat.term_flushes;
+	rows = kstat.term_flushed_rows;
+	write_to_terminal(1, "abc", 3);
+	if (kstat.term_flushes != flushes + 1 || kstat.term_flushed_rows != rows + 1) {
+		return FAIL;
+	}
+	screen = (uint16_t*) VIDEO_START + screen_start();
+	if ((char) screen[0] != 'a' || (char) screen[1] != 'b' || (char) screen[2] != 'c') {
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* scrollback TEST
+*  writes more lines than fit on the screen, pages back and checks an
+	older line is shown at the top, then pages forward to the live screen
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Scrolls the screen
+*/
+int scrollback_test() {
+	TEST_HEADER;
+	char line[2];
+	uint16_t* screen;
+	int i;
+
+	line[1] = '\n';
+	for (i = 0; i < SCROLLBACK_LINES; i++) {
+		line[0] = 'A' + (i % 26);
+		write_to_terminal(1, line, 2);
+	}
+	// the live screen starts NUM_ROWS - 1 lines before the end, the cursor row is empty
+	terminal_scroll_view(NUM_ROWS);
+	screen = (uint16_t*) VIDEO_START + screen_start();
+	if ((char) screen[0] != 'A' + ((SCROLLBACK_LINES - 2 * NUM_ROWS + 1) % 26)) {
+		terminal_scroll_view(-NUM_ROWS);
+		return FAIL;
+	}
+	terminal_scroll_view(-NUM_ROWS);
+	screen = (uint16_t*) VIDEO_START + screen_start();
+	return ((char) screen[0] == 'A' + ((SCROLLBACK_LINES - NUM_ROWS + 1) % 26)) ? PASS : FAIL;
+}
+
+/* VT100 TEST
+*  moves the cursor with an escape sequence and writes characters with
+	and without an SGR color, checks where they end up and their attributes
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Clears the screen
+*/
+int vt100_test() {
+	TEST_HEADER;
+	char seq[] = "\x1b[2J\x1b[3;5Hx\x1b[1;31my\x1b[0mz";
+	uint16_t* row;
+
+	write_to_terminal(1, seq, strlen(seq));
+	row = (uint16_t*) VIDEO_START + screen_start() + 2 * NUM_COLS;
+	if ((char) row[4] != 'x' || (char) row[5] != 'y' || (char) row[6] != 'z' || (char) row[3] != ' ') {
+		return FAIL;
+	}
+	// bright red on the terminal's background, then back to its color
+	if ((row[5] >> 8) != (((row[4] >> 8) & 0xF0) | 0x0C) || row[6] >> 8 != row[4] >> 8) {
+		return FAIL;
+	}
+	return PASS;
+}
+
+/* line discipline TEST
+*  queues key presses like the keyboard interrupt does before read is called,
+	checks a canonical read gets the typed line and a raw read gets single keys
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Echoes the typed line
+*/
+int ldisc_test() {
+	TEST_HEADER;
+	char buf[IN_BUF_SIZE];
+	int result = PASS;
+	int tag = get_active_buffer();
+
+	key_queue_put(0x23, tag); // h
+	key_queue_put(0x17, tag); // i
+	key_queue_put(ENTER_PRESSED, tag);
+	key_queue_put(0x1E, tag); // a, typed ahead of the next read
+	if (read_from_terminal(0, buf, IN_BUF_SIZE) != 3 || strncmp(buf, "hi\n", 3) != 0) {
+		result = FAIL;
+	}
+	terminal_ioctl(0, TERM_SET_MODE, TERM_NONBLOCK);
+	if (terminal_ioctl(0, TERM_GET_MODE, 0) != TERM_NONBLOCK) {
+		result = FAIL;
+	}
+	// the unfinished line is handed over, then there is nothing left
+	if (read_from_terminal(0, buf, IN_BUF_SIZE) != 1 || buf[0] != 'a') {
+		result = FAIL;
+	}
+	if (read_from_terminal(0, buf, IN_BUF_SIZE) != 0) {
+		result = FAIL;
+	}
+	terminal_ioctl(0, TERM_SET_MODE, TERM_MODE_DEFAULT);
+	return result;
+}
+
+/* terminal spawn TEST
+*  opens the last terminal like Alt+F12 does and checks its screen memory
+	comes from the page pool and is what its vidmap page points at
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Opens the last terminal
+*/
+int spawn_test() {
+	TEST_HEADER;
+	uint32_t page;
+
+	if (terminal_create(MAX_TERMINALS) != -1 || terminal_exists(MAX_TERMINALS)) {
+		return FAIL;
+	}
+	if (terminal_create(MAX_TERMINALS - 1) != 0 || !terminal_exists(MAX_TERMINALS - 1)) {
+		return FAIL;
+	}
+	page = video_map_table[MAX_TERMINALS - 1].page_base_address << PAGE_SHIFT;
+	if (page < PALLOC_START || page >= PALLOC_END) {
+		return FAIL;
+	}
+	// a new terminal starts out blank
+	return ((char) *(uint16_t*) page == ' ') ? PASS : FAIL;
+}
+
+/* pty TEST
+*  drives the slave side from the master side through /dev/ptmx and checks
+	lines come out one per read and end of file once the master is closed
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Allocates and frees a pty
+*/
+int pty_test() {
+	TEST_HEADER;
+	file_ops_t * ops;
+	file_object_t master;
+	char buf[IN_BUF_SIZE];
+	int result = PASS;
+
+	ops = dev_lookup_path((int8_t*) "/dev/ptmx");
+	if (ops == NULL || ops->ioctl_func == NULL) {
+		return FAIL;
+	}
+	master.inode = ops->open_func((uint8_t*) "/dev/ptmx");
+	if (master.inode == -1 || ops->ioctl_func((int32_t) &master, PTY_GET_NUM, 0) != master.inode) {
+		return FAIL;
+	}
+
+	// the slave reads a line at a time like a canonical terminal
+	if (ops->write_func((int32_t) &master, "ls\ncat", 6) != 6) {
+		result = FAIL;
+	}
+	if (pty_stdin_ops.read_func((int32_t) &master, buf, IN_BUF_SIZE) != 3 || strncmp(buf, "ls\n", 3)) {
+		result = FAIL;
+	}
+	if (pty_stdout_ops.write_func((int32_t) &master, "out", 3) != 3) {
+		result = FAIL;
+	}
+	pty_stdout_ops.dup_func((int32_t) &master);
+	if (ops->read_func((int32_t) &master, buf, IN_BUF_SIZE) != 3 || strncmp(buf, "out", 3)) {
+		result = FAIL;
+	}
+	pty_stdout_ops.close_func((int32_t) &master);
+
+	// with the master closed the rest of the line comes out, then end of file
+	pty_stdin_ops.dup_func((int32_t) &master);
+	ops->close_func((int32_t) &master);
+	if (pty_stdin_ops.read_func((int32_t) &master, buf, IN_BUF_SIZE) != 3 || strncmp(buf, "cat", 3)) {
+		result = FAIL;
+	}
+	if (pty_stdin_ops.read_func((int32_t) &master, buf, IN_BUF_SIZE) != 0) {
+		result = FAIL;
+	}
+	pty_stdin_ops.close_func((int32_t) &master);
+	return result;
+}
+
+/* pipe TEST
+*  pushes data through a pipe past the end of its page queue and checks a read
+	sees end of file once every write end is closed
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Allocates and frees a pipe
+*/
+int pipe_test() {
+	TEST_HEADER;
+	file_object_t end;
+	uint8_t * buf;
+	int i;
+	int result = PASS;
+
+	if ((buf = palloc(PIPE_BUF_PAGES)) == NULL) {
+		return FAIL;
+	}
+	if ((end.inode = pipe_create()) == -1) {
+		pfree(buf, PIPE_BUF_PAGES);
+		return FAIL;
+	}
+	for (i = 0; i < PIPE_BUF_SIZE; i++) {
+		buf[i] = (uint8_t) i;
+	}
+
+	// no process can read, so a write stops when the pipe is full
+	if (pipe_write((int32_t) &end, buf, PIPE_BUF_SIZE) != PIPE_BUF_SIZE || pipe_write((int32_t) &end, buf, 1) != 0) {
+		result = FAIL;
+	}
+	if (pipe_read((int32_t) &end, buf, PIPE_BUF_SIZE / 2) != PIPE_BUF_SIZE / 2) {
+		result = FAIL;
+	}
+	// this one wraps around the end of the page queue
+	if (pipe_write((int32_t) &end, buf, PIPE_BUF_SIZE / 2) != PIPE_BUF_SIZE / 2) {
+		result = FAIL;
+	}
+	if (pipe_read((int32_t) &end, buf, PIPE_BUF_SIZE) != PIPE_BUF_SIZE) {
+		result = FAIL;
+	}
+	for (i = 0; i < PIPE_BUF_SIZE; i++) {
+		if (buf[i] != (uint8_t) (i + PIPE_BUF_SIZE / 2)) {
+			result = FAIL;
+			break;
+		}
+	}
+
+	// a second writer keeps the pipe open after the first one closes
+	pipe_write_dup((int32_t) &end);
+	pipe_write_close((int32_t) &end);
+	if (pipe_write((int32_t) &end, "x", 1) != 1 || pipe_read((int32_t) &end, buf, 2) != 1) {
+		result = FAIL;
+	}
+	pipe_write_close((int32_t) &end);
+	if (pipe_read((int32_t) &end, buf, 1) != 0) {
+		result = FAIL;
+	}
+	pipe_read_close((int32_t) &end);
+	if (pipe_read((int32_t) &end, buf, 1) != -1) { // the pipe is free again
+		result = FAIL;
+	}
+	pfree(buf, PIPE_BUF_PAGES);
+	return result;
+}
+
+/* page gift TEST
+*  moves a page the process owns out of an mmap table, checks only owned
+	pages can be taken and that the address gets a zeroed page again
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Uses the mmap table of the last pid
+*/
+int gift_test() {
+	TEST_HEADER;
+	int32_t pid = NUM_MMAP_TABLES - 1;
+	uint8_t * page;
+	int result = PASS;
+
+	if ((page = palloc(1)) == NULL) {
+		return FAIL;
+	}
+	clear_mmap_table(pid);
+	mmap_map_page(pid, 0, (uint32_t) page, 1, PTE_ANON);
+	mmap_map_page(pid, 1, (uint32_t) page, 0, 0);
+	if (mmap_find_free(pid, 2) != 2) {
+		result = FAIL;
+	}
+	if (mmap_take_page(pid, 1) != 0) { // not owned, stays mapped
+		result = FAIL;
+	}
+	if (mmap_take_page(pid, 0) != (uint32_t) page || mmap_take_page(pid, 0) != 0) {
+		result = FAIL;
+	}
+	if (mmap_find_free(pid, 1) != 2) { // still reserved for demand zero
+		result = FAIL;
+	}
+	if (mmap_fault(pid, USER_MMAP_START) != 0 || !mmap_tables[pid][0].present ||
+		mmap_tables[pid][0].page_base_address == (uint32_t) page >> PAGE_SHIFT) {
+		result = FAIL;
+	}
+	clear_mmap_table(pid); // frees the new page, the taken one is ours
+	pfree(page, 1);
+	return result;
+}
+
+/* WAITPID TEST
+*  reaps a spawned child once it is a zombie, WNOHANG does not wait for one
+	that is still running
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Uses the pcbs of the last two pids
+*/
+int waitpid_test() {
+	TEST_HEADER;
+	int32_t parent_pid = MAX_NEXT_PID - 2;
+	int32_t child_pid = MAX_NEXT_PID - 1;
+	pcb_t * parent;
+	pcb_t * child;
+	int result = PASS;
+
+	if (pid_arr[parent_pid] || pid_arr[child_pid]) {
+		return FAIL;
+	}
+	pid_arr[parent_pid] = 1;
+	pid_arr[child_pid] = 1;
+	parent = get_pcb(parent_pid);
+	child = get_pcb(child_pid);
+	parent->pid = parent_pid;
+	parent->process = parent;
+	parent->spawned = 0;
+	parent->waiting = 0;
+	child->pid = child_pid;
+	child->active = 0;
+	child->spawned = 1;
+	child->zombie = 0;
+	child->parent_pcb_ptr = parent;
+	set_current_pcb(parent);
+
+	if (sys_waitpid(-1, NULL, WNOHANG) != 0) { // still running
+		result = FAIL;
+	}
+	if (sys_waitpid(parent_pid, NULL, WNOHANG) != -1) { // not a child
+		result = FAIL;
+	}
+	child->zombie = 1;
+	if (sys_waitpid(child_pid, NULL, WNOHANG) != child_pid || pid_arr[child_pid]) {
+		result = FAIL;
+	}
+	if (sys_waitpid(-1, NULL, 0) != -1) { // nothing left to wait for
+		result = FAIL;
+	}
+
+	set_current_pcb(NULL);
+	pid_arr[parent_pid] = 0;
+	pid_arr[child_pid] = 0;
+	return result;
+}
+
+/* HEAP TEST
+*  reserves demand-zero heap pages, checks the first access gets a zeroed
+	page, that munmap ranges can't reach into the heap and unmapping
+	gives it back
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Uses the mmap table of the last pid
+*/
+int heap_test() {
+	TEST_HEADER;
+	int32_t pid = NUM_MMAP_TABLES - 1;
+	uint32_t addr = USER_HEAP_START + PAGE_SIZE;
+	uint32_t pages_used = kstat.pages_used;
+	page_table_entry_t * pte = &mmap_tables[pid][NUM_ENTRIES + 1];
+	uint8_t * page;
+	int result = PASS;
+	int i;
+
+	clear_mmap_table(pid);
+	mmap_reserve_zero(pid, NUM_ENTRIES, 2);
+	if (!mmap_range_writable(pid, USER_HEAP_START, 2 * PAGE_SIZE) ||
+		mmap_range_writable(pid, USER_HEAP_START, 2 * PAGE_SIZE + 1)) {
+		result = FAIL;
+	}
+	if (mmap_find_free(pid, 1) != 0) { // mmap does not take heap pages
+		result = FAIL;
+	}
+	mmap_reserve_zero(pid, NUM_ENTRIES - 1, 1);
+	if (!mmap_range_mapped(pid, NUM_ENTRIES - 1, 1) || mmap_range_mapped(pid, NUM_ENTRIES - 1, 2) ||
+		mmap_range_mapped(pid, NUM_ENTRIES - 2, 2)) { // munmap stops at the heap and at holes
+		result = FAIL;
+	}
+	if (pte->present || mmap_fault(pid, addr + 5) != 0 || mmap_fault(pid, addr + 5) != -1) {
+		result = FAIL;
+	}
+	if (!pte->present || !pte->read_write || !(pte->avail & PTE_ANON)) {
+		result = FAIL;
+	} else {
+		page = (uint8_t *) (pte->page_base_address << PAGE_SHIFT);
+		for (i = 0; i < PAGE_SIZE; i++) {
+			if (page[i] != 0) {
+				result = FAIL;
+				break;
+			}
+		}
+	}
+	if (mmap_fault(pid, addr + PAGE_SIZE) != -1) { // not reserved
+		result = FAIL;
+	}
+	clear_mmap_table(pid);
+	if (kstat.pages_used != pages_used) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* SHARED MEMORY TEST
+*  maps one segment into two processes and checks they share its pages and
+	it is freed once both are unmapped
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Uses the mmap tables of the last two pids
+*/
+int shm_test() {
+	TEST_HEADER;
+	int32_t a = NUM_MMAP_TABLES - 1;
+	int32_t b = NUM_MMAP_TABLES - 2;
+	uint32_t pages_used = kstat.pages_used;
+	int result = PASS;
+
+	clear_mmap_table(a);
+	clear_mmap_table(b);
+	if (shm_map(a, "shm_test", 2, -1) != 0 || shm_map(b, "shm_test", 0, 5) != 5) {
+		result = FAIL;
+	}
+	if (mmap_tables[a][1].page_base_address != mmap_tables[b][6].page_base_address ||
+		!(mmap_tables[b][6].avail & PTE_SHARED) || !mmap_tables[b][6].read_write) {
+		result = FAIL;
+	}
+	if (shm_map(b, "shm_test", 3, -1) != -1) { // bigger than the segment
+		result = FAIL;
+	}
+	if (shm_map(b, "shm_test", 1, 6) != -1) { // pages already in use
+		result = FAIL;
+	}
+	clear_mmap_table(a);
+	if (kstat.pages_used == pages_used) { // b still has it
+		result = FAIL;
+	}
+	clear_mmap_table(b);
+	if (kstat.pages_used != pages_used) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* FUTEX TEST
+*  queues sleepers on two words of one bucket and checks a wake only takes
+	the ones of its word, oldest first
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: None
+*/
+int futex_test() {
+	TEST_HEADER;
+	static pcb_t sleepers[3];
+	uint32_t key = (uint32_t) &kstat;
+	uint32_t other = key + FUTEX_BUCKETS * sizeof(int32_t); // same bucket
+	int result = PASS;
+
+	if (virt_to_phys(key) != key) { // the kernel is identity mapped
+		result = FAIL;
+	}
+	futex_queue(&sleepers[0], key);
+	futex_queue(&sleepers[1], other);
+	futex_queue(&sleepers[2], key);
+	if (futex_wake_key(key, 1) != 1 || sleepers[0].futex_key != 0 || sleepers[2].futex_key != key) {
+		result = FAIL;
+	}
+	if (futex_wake_key(key, 5) != 1 || sleepers[2].futex_key != 0 || sleepers[1].futex_key != other) {
+		result = FAIL;
+	}
+	if (futex_wake_key(other, 5) != 1 || futex_wake_key(other, 5) != 0) {
+		result = FAIL;
+	}
+	return result;
+}
+
+/* THREAD TEST
+*  joins a thread that exited, only threads of the caller's process can be
+	joined, and a thread ended while asleep leaves its futex queue
+*  Inputs: None
+*  Outputs: PASS/FAIL
+*  Side Effects: Uses the pcbs of the last two pids
+*/
+int thread_test() {
+	TEST_HEADER;
+	static pcb_t sleeper;
+	int32_t leader_pid = MAX_NEXT_PID - 2;
+	int32_t thread_pid = MAX_NEXT_PID - 1;
+	uint32_t key = (uint32_t) &kstat;
+	pcb_t * leader;
+	pcb_t * thread;
+	int result = PASS;
+
+	if (pid_arr[leader_pid] || pid_arr[thread_pid]) {
+		return FAIL;
+	}
+	pid_arr[leader_pid] = 1;
+	pid_arr[thread_pid] = 1;
+	leader = get_pcb(leader_pid);
+	thread = get_pcb(thread_pid);
+	leader->pid = leader_pid;
+	leader->process = leader;
+	thread->pid = thread_pid;
+	thread->process = leader;
+	thread->active = 1;
+	thread->zombie = 0;
+	set_current_pcb(thread);
+
+	if (get_current_process() != leader) {
+		result = FAIL;
+	}
+	if (sys_thread_join(thread_pid, NULL) != -1 || sys_thread_join(leader_pid, NULL) != -1) { // itself, not a thread
+		result = FAIL;
+	}
+	set_current_pcb(leader);
+	thread->active = 0;
+	thread->zombie = 1;
+	thread->exit_status = 7;
+	if (sys_thread_join(thread_pid, NULL) != 0 || pid_arr[thread_pid]) {
+		result = FAIL;
+	}
+	if (sys_thread_join(thread_pid, NULL) != -1) { // reaped already
+		result = FAIL;
+	}
+
+	futex_queue(thread, key);
+	futex_queue(&sleeper, key);
+	futex_cancel(thread);
+	if (thread->futex_key != 0 || futex_wake_key(key, 5) != 1 || sleeper.futex_key != 0) {
+		result = FAIL;
+	}
+
+	set_current_pcb(NULL);
+	pid_arr[leader_pid] = 0;
+	pid_arr[thread_pid] = 0;
+	return result;
+}
+
 /* Checkpoint 4 tests */
 /* Checkpoint 5 tests */
 
@@ -696,6 +1824,58 @@ void launch_tests(){
 			TEST_OUTPUT("cp3_garbage_value_test", cp3_garbage_value_test());
 		} else if (strncmp(in_buffer, "networking_start_test", 5) == 0) {
 			TEST_OUTPUT("networking_start_test", networking_start_test());
+		} else if (strncmp(in_buffer, "devfs_test", 5) == 0) {
+			TEST_OUTPUT("devfs_test", devfs_test());
+		} else if (strncmp(in_buffer, "procfs_test", 5) == 0) {
+			TEST_OUTPUT("procfs_test", procfs_test());
+		} else if (strncmp(in_buffer, "bcache_test", 6) == 0) {
+			TEST_OUTPUT("bcache_test", bcache_test());
+		} else if (strncmp(in_buffer, "block_batch_test", 6) == 0) {
+			TEST_OUTPUT("block_batch_test", block_batch_test());
+		} else if (strncmp(in_buffer, "mmap_test", 4) == 0) {
+			TEST_OUTPUT("mmap_test", mmap_test());
+		} else if (strncmp(in_buffer, "file_length_test", 6) == 0) {
+			TEST_OUTPUT("file_length_test", file_length_test());
+		} else if (strncmp(in_buffer, "palloc_test", 6) == 0) {
+			TEST_OUTPUT("palloc_test", palloc_test());
+		} else if (strncmp(in_buffer, "getdents_test", 6) == 0) {
+			TEST_OUTPUT("getdents_test", getdents_test());
+		} else if (strncmp(in_buffer, "readv_test", 5) == 0) {
+			TEST_OUTPUT("readv_test", readv_test());
+		} else if (strncmp(in_buffer, "hwscroll_test", 2) == 0) {
+			TEST_OUTPUT("hwscroll_test", hwscroll_test());
+		} else if (strncmp(in_buffer, "termout_test", 5) == 0) {
+			TEST_OUTPUT("termout_test", termout_test());
+		} else if (strncmp(in_buffer, "switch_test", 3) == 0) {
+			TEST_OUTPUT("switch_test", switch_test());
+		} else if (strncmp(in_buffer, "flush_test", 3) == 0) {
+			TEST_OUTPUT("flush_test", flush_test());
+		} else if (strncmp(in_buffer, "scrollback_test", 3) == 0) {
+			TEST_OUTPUT("scrollback_test", scrollback_test());
+		} else if (strncmp(in_buffer, "vt100_test", 2) == 0) {
+			TEST_OUTPUT("vt100_test", vt100_test());
+		} else if (strncmp(in_buffer, "ldisc_test", 2) == 0) {
+			TEST_OUTPUT("ldisc_test", ldisc_test());
+		} else if (strncmp(in_buffer, "spawn_test", 2) == 0) {
+			TEST_OUTPUT("spawn_test", spawn_test());
+		} else if (strncmp(in_buffer, "pty_test", 2) == 0) {
+			TEST_OUTPUT("pty_test", pty_test());
+		} else if (strncmp(in_buffer, "pipe_test", 2) == 0) {
+			TEST_OUTPUT("pipe_test", pipe_test());
+		} else if (strncmp(in_buffer, "gift_test", 2) == 0) {
+			TEST_OUTPUT("gift_test", gift_test());
+		} else if (strncmp(in_buffer, "waitpid_test", 2) == 0) {
+			TEST_OUTPUT("waitpid_test", waitpid_test());
+		} else if (strncmp(in_buffer, "heap_test", 2) == 0) {
+			TEST_OUTPUT("heap_test", heap_test());
+		} else if (strncmp(in_buffer, "shm_test", 2) == 0) {
+			TEST_OUTPUT("shm_test", shm_test());
+		} else if (strncmp(in_buffer, "futex_test", 2) == 0) {
+			TEST_OUTPUT("futex_test", futex_test());
+		} else if (strncmp(in_buffer, "thread_test", 2) == 0) {
+			TEST_OUTPUT("thread_test", thread_test());
+		} else if (strncmp(in_buffer, "readahead_test", 3) == 0) {
+			TEST_OUTPUT("readahead_test", readahead_test());
 		}
 		else{
 			printf("Invalid input.\n");
@@ -0,0 +1,285 @@
+#include "virtio_blk.h"
+#include "block.h"
+#include "pci.h"
+#include "outl.h"
+#include "kstat.h"
+#include "types.h"
+#include "lib.h"
+
+#define LIST_END -1
+
+static uint8_t ring_mem[VIRTIO_BLK_RING_MEM] __attribute__ ((aligned (VRING_ALIGN)));
+static virtio_blk_slot_t slots[VIRTIO_BLK_MAX_INFLIGHT] __attribute__ ((aligned (sizeof(vring_desc_t))));
+
+static uint16_t io_base;
+static uint32_t queue_size;
+static vring_desc_t * ring_desc;
+static volatile vring_avail_t * ring_avail;
+static volatile vring_used_t * ring_used;
+
+static uint16_t avail_idx = 0; // next avail ring entry, published on kick
+static uint16_t used_idx = 0; // next used ring entry to reap
+static int free_slot = LIST_END;
+static int unkicked = 0; // requests added since the last notify
+static int inflight = 0; // requests the device has not answered yet
+
+static block_dev_t vblk_dev;
+
+/* barrier
+ *
+ * DESCRIPTION: Keeps the compiler from reordering ring accesses. x86 keeps
+ *              stores in order, so the device sees them in program order.
+ */
+static inline void barrier() {
+    asm volatile ("" : : : "memory");
+}
+
+/* rdtsc_low
+ *
+ * DESCRIPTION: Reads the low half of the time stamp counter
+ */
+static inline uint32_t rdtsc_low() {
+    uint32_t low, high;
+    asm volatile ("rdtsc" : "=a"(low), "=d"(high));
+    return low;
+}
+
+/* virtio_blk_kick
+ *
+ * DESCRIPTION: Publishes every request added since the last kick and
+ *              notifies the device once for all of them, unless the device
+ *              said it is still processing the ring and needs no notify
+ *
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void virtio_blk_kick() {
+    if (unkicked == 0) {
+        return;
+    }
+    barrier();
+    ring_avail->idx = avail_idx;
+    barrier();
+    if (!(ring_used->flags & VRING_USED_F_NO_NOTIFY)) {
+        outw(0, io_base + VIRTIO_REG_QUEUE_NOTIFY);
+        kstat.vblk_kicks++;
+    }
+    unkicked = 0;
+}
+
+/* virtio_blk_reap
+ *
+ * DESCRIPTION: Completes every request the device put on the used ring
+ *
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: frees the slots of finished requests
+ */
+static void virtio_blk_reap() {
+    virtio_blk_slot_t * slot;
+    uint32_t id;
+    int32_t status;
+    int i;
+
+    while (used_idx != ring_used->idx) {
+        barrier();
+        id = ring_used->ring[used_idx % queue_size].id;
+        used_idx++;
+        if (id >= VIRTIO_BLK_MAX_INFLIGHT) {
+            continue;
+        }
+        slot = &slots[id];
+
+        status = (slot->status == VIRTIO_BLK_S_OK) ? BLOCK_DONE : BLOCK_ERROR;
+        for (i = 0; i < slot->count; i++) {
+            slot->reqs[i].status = status;
+        }
+        kstat.vblk_completions++;
+        kstat.vblk_latency_cycles += rdtsc_low() - slot->start_tsc;
+        kstat.vblk_queue_depth = --inflight;
+
+        slot->next_free = free_slot;
+        free_slot = id;
+    }
+}
+
+/* virtio_blk_submit
+ *
+ * DESCRIPTION: Block layer submit function. Requests for adjacent sectors
+ *              are merged into one virtio request, every virtio request
+ *              uses one ring entry through an indirect table, and the whole
+ *              batch is handed to the device with a single notify.
+ *
+ * INPUTS: dev: the block device
+ *         reqs: requests to transfer
+ *         count: number of requests
+ * OUTPUTS: none
+ * RETURN VALUE: 0
+ * SIDE EFFECTS: requests complete later, see virtio_blk_wait
+ */
+static int32_t virtio_blk_submit(block_dev_t * dev, block_request_t * reqs, int count) {
+    virtio_blk_slot_t * slot;
+    uint32_t flags;
+    int first, n, i, id;
+
+    cli_and_save(flags);
+    for (first = 0; first < count; first += n) {
+        for (n = 1; first + n < count && n < VIRTIO_BLK_MAX_SEGS; n++) {
+            block_request_t * prev = &reqs[first + n - 1];
+            block_request_t * next = &reqs[first + n];
+            if (next->write != prev->write || next->lba != prev->lba + prev->count) {
+                break;
+            }
+        }
+
+        while (free_slot == LIST_END) { // ring is full, let the device catch up
+            virtio_blk_kick();
+            virtio_blk_reap();
+        }
+        id = free_slot;
+        slot = &slots[id];
+        free_slot = slot->next_free;
+
+        slot->reqs = reqs + first;
+        slot->count = n;
+        slot->status = VIRTIO_BLK_S_OK + 1; // anything but OK until the device answers
+        slot->hdr.type = reqs[first].write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+        slot->hdr.ioprio = 0;
+        slot->hdr.sector = reqs[first].lba;
+
+        slot->table[0].addr = (uint32_t) &slot->hdr; // kernel memory is identity mapped
+        slot->table[0].len = sizeof(virtio_blk_req_hdr_t);
+        slot->table[0].flags = VRING_DESC_F_NEXT;
+        slot->table[0].next = 1;
+        for (i = 0; i < n; i++) {
+            slot->table[i + 1].addr = (uint32_t) reqs[first + i].buf;
+            slot->table[i + 1].len = reqs[first + i].count << BLOCK_SECTOR_SHIFT;
+            slot->table[i + 1].flags = VRING_DESC_F_NEXT | (reqs[first].write ? 0 : VRING_DESC_F_WRITE);
+            slot->table[i + 1].next = i + 2;
+        }
+        slot->table[n + 1].addr = (uint32_t) &slot->status;
+        slot->table[n + 1].len = sizeof(uint8_t);
+        slot->table[n + 1].flags = VRING_DESC_F_WRITE;
+        slot->table[n + 1].next = 0;
+
+        ring_desc[id].addr = (uint32_t) slot->table;
+        ring_desc[id].len = (n + 2) * sizeof(vring_desc_t);
+        ring_desc[id].flags = VRING_DESC_F_INDIRECT;
+        ring_desc[id].next = 0;
+
+        ring_avail->ring[avail_idx % queue_size] = id;
+        avail_idx++;
+        unkicked++;
+
+        slot->start_tsc = rdtsc_low();
+        kstat.vblk_requests++;
+        kstat.vblk_queue_depth = ++inflight;
+        if (inflight > kstat.vblk_max_queue_depth) {
+            kstat.vblk_max_queue_depth = inflight;
+        }
+    }
+    virtio_blk_kick();
+    restore_flags(flags);
+    return 0;
+}
+
+/* virtio_blk_wait
+ *
+ * DESCRIPTION: Block layer wait function, polls the used ring until the
+ *              device has answered every request
+ *
+ * INPUTS: dev: the block device
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: completes requests
+ */
+static void virtio_blk_wait(block_dev_t * dev) {
+    uint32_t flags;
+
+    cli_and_save(flags);
+    virtio_blk_kick();
+    while (inflight > 0) {
+        virtio_blk_reap();
+    }
+    restore_flags(flags);
+}
+
+/* virtio_blk_init
+ *
+ * DESCRIPTION: Finds a virtio block device, sets up its request queue and
+ *              registers it as a block device (vda). Completions are polled,
+ *              so the device is asked not to interrupt.
+ *
+ * INPUTS: none
+ * OUTPUTS: prints the size of the disk
+ * RETURN VALUE: none
+ * SIDE EFFECTS: registers a block device
+ */
+void virtio_blk_init() {
+    uint8_t device, func;
+    uint32_t bar0, features, desc_size, used_offset, capacity_high;
+    int i;
+
+    if (pci_find_id(VIRTIO_VENDOR_ID, VIRTIO_BLK_DEVICE_ID, &device, &func)) {
+        return;
+    }
+    bar0 = read_pci_conf(0, device, func, PCI_BAR0);
+    if (!(bar0 & PCI_BAR_IO_SPACE)) {
+        return;
+    }
+    write_pci_conf(0, device, func, PCI_COMMAND,
+        read_pci_conf(0, device, func, PCI_COMMAND) | PCI_COMMAND_IO | PCI_COMMAND_BUS_MASTER);
+    io_base = bar0 & PCI_BAR_IO_MASK;
+
+    outb(0, io_base + VIRTIO_REG_STATUS); // reset
+    outb(VIRTIO_STATUS_ACK, io_base + VIRTIO_REG_STATUS);
+    outb(VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER, io_base + VIRTIO_REG_STATUS);
+
+    features = inl(io_base + VIRTIO_REG_DEVICE_FEATURES);
+    if (!(features & VIRTIO_F_INDIRECT_DESC)) {
+        outb(VIRTIO_STATUS_FAILED, io_base + VIRTIO_REG_STATUS);
+        return;
+    }
+    outl_asm(VIRTIO_F_INDIRECT_DESC, io_base + VIRTIO_REG_GUEST_FEATURES);
+
+    // the legacy ring layout is descriptors, avail ring, then the used ring
+    // on the next VRING_ALIGN boundary, all at the size the device chose
+    outw(0, io_base + VIRTIO_REG_QUEUE_SELECT);
+    queue_size = inw(io_base + VIRTIO_REG_QUEUE_SIZE);
+    desc_size = queue_size * sizeof(vring_desc_t);
+    used_offset = (desc_size + sizeof(vring_avail_t) + queue_size * sizeof(uint16_t) + VRING_ALIGN - 1) & ~(VRING_ALIGN - 1);
+    if (queue_size == 0 || used_offset + sizeof(vring_used_t) + queue_size * sizeof(vring_used_elem_t) > VIRTIO_BLK_RING_MEM) {
+        outb(VIRTIO_STATUS_FAILED, io_base + VIRTIO_REG_STATUS);
+        return;
+    }
+    memset(ring_mem, 0, VIRTIO_BLK_RING_MEM);
+    ring_desc = (vring_desc_t *) ring_mem;
+    ring_avail = (vring_avail_t *) (ring_mem + desc_size);
+    ring_used = (vring_used_t *) (ring_mem + used_offset);
+    ring_avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+
+    free_slot = LIST_END;
+    for (i = VIRTIO_BLK_MAX_INFLIGHT - 1; i >= 0; i--) {
+        if (i < queue_size) {
+            slots[i].next_free = free_slot;
+            free_slot = i;
+        }
+    }
+    outl_asm((uint32_t) ring_mem >> VRING_PAGE_SHIFT, io_base + VIRTIO_REG_QUEUE_PFN);
+    outb(VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK, io_base + VIRTIO_REG_STATUS);
+
+    strncpy(vblk_dev.name, "vda", BLOCK_NAME_LEN);
+    vblk_dev.num_sectors = inl(io_base + VIRTIO_BLK_REG_CAPACITY);
+    capacity_high = inl(io_base + VIRTIO_BLK_REG_CAPACITY + sizeof(uint32_t));
+    if (capacity_high) { // sectors are 32 bit in the block layer
+        vblk_dev.num_sectors = 0xFFFFFFFF;
+    }
+    vblk_dev.submit_func = virtio_blk_submit;
+    vblk_dev.wait_func = virtio_blk_wait;
+    vblk_dev.priv = NULL;
+    block_register(&vblk_dev);
+    printf("%s: %d sectors, queue size %d\n", vblk_dev.name, vblk_dev.num_sectors, queue_size);
+}
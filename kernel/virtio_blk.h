@@ -0,0 +1,89 @@
+#include "types.h"
+#include "block.h"
+
+#ifndef VIRTIO_BLK_H
+#define VIRTIO_BLK_H
+
+#define VIRTIO_VENDOR_ID 0x1AF4
+#define VIRTIO_BLK_DEVICE_ID 0x1001 // transitional (legacy interface) block device
+
+/* legacy virtio registers, offsets from the I/O BAR0 */
+#define VIRTIO_REG_DEVICE_FEATURES 0x00
+#define VIRTIO_REG_GUEST_FEATURES 0x04
+#define VIRTIO_REG_QUEUE_PFN 0x08
+#define VIRTIO_REG_QUEUE_SIZE 0x0C
+#define VIRTIO_REG_QUEUE_SELECT 0x0E
+#define VIRTIO_REG_QUEUE_NOTIFY 0x10
+#define VIRTIO_REG_STATUS 0x12
+#define VIRTIO_REG_ISR 0x13
+#define VIRTIO_BLK_REG_CAPACITY 0x14 // 64 bit, in 512 byte sectors
+
+#define VIRTIO_STATUS_ACK 0x01
+#define VIRTIO_STATUS_DRIVER 0x02
+#define VIRTIO_STATUS_DRIVER_OK 0x04
+#define VIRTIO_STATUS_FAILED 0x80
+
+#define VIRTIO_F_INDIRECT_DESC (1 << 28)
+
+#define VRING_DESC_F_NEXT 0x1
+#define VRING_DESC_F_WRITE 0x2 // device writes the buffer
+#define VRING_DESC_F_INDIRECT 0x4
+#define VRING_AVAIL_F_NO_INTERRUPT 0x1
+#define VRING_USED_F_NO_NOTIFY 0x1
+
+#define VRING_ALIGN 4096
+#define VRING_PAGE_SHIFT 12
+#define VIRTIO_BLK_RING_MEM 0x4000 // fits a legacy queue of up to 256 entries
+
+#define VIRTIO_BLK_T_IN 0
+#define VIRTIO_BLK_T_OUT 1
+#define VIRTIO_BLK_S_OK 0
+
+#define VIRTIO_BLK_MAX_INFLIGHT 32 // requests on the ring at once
+#define VIRTIO_BLK_MAX_SEGS 32 // block requests merged into one virtio request
+
+typedef struct __attribute__ ((packed)) vring_desc {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} vring_desc_t;
+
+typedef struct __attribute__ ((packed)) vring_avail {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} vring_avail_t;
+
+typedef struct __attribute__ ((packed)) vring_used_elem {
+    uint32_t id;
+    uint32_t len;
+} vring_used_elem_t;
+
+typedef struct __attribute__ ((packed)) vring_used {
+    uint16_t flags;
+    uint16_t idx;
+    vring_used_elem_t ring[];
+} vring_used_t;
+
+typedef struct __attribute__ ((packed)) virtio_blk_req_hdr {
+    uint32_t type;
+    uint32_t ioprio;
+    uint64_t sector;
+} virtio_blk_req_hdr_t;
+
+/* one virtio request. It takes a single ring descriptor that points to
+ * table: header, one entry per merged block request, status byte */
+typedef struct virtio_blk_slot {
+    vring_desc_t table[VIRTIO_BLK_MAX_SEGS + 2];
+    virtio_blk_req_hdr_t hdr;
+    volatile uint8_t status;
+    block_request_t * reqs;
+    int count;
+    uint32_t start_tsc; // low half of the TSC at submission
+    int next_free;
+} virtio_blk_slot_t;
+
+void virtio_blk_init();
+
+#endif // VIRTIO_BLK_H
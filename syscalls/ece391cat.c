@@ -7,6 +7,7 @@ int main ()
 {
     int32_t fd, cnt;
     uint8_t buf[1024];
+    uint8_t* map;
 
     if (0 != ece391_getargs (buf, 1024)) {
         ece391_fdputs (1, (uint8_t*)"could not read arguments\n");
@@ -18,6 +19,10 @@ int main ()
 	return 2;
     }
 
+    /* a mapped file goes out in a single write */
+    if (-1 != (cnt = ece391_mmap (fd, &map)))
+	return (cnt == ece391_write (1, map, cnt)) ? 0 : 3;
+
     while (0 != (cnt = ece391_read (fd, buf, 1024))) {
         if (-1 == cnt) {
 	    ece391_fdputs (1, (uint8_t*)"file read failed\n");
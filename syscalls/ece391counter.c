@@ -9,6 +9,7 @@ int main ()
 {
     uint32_t i, cnt, max = 0;
     uint8_t buf[BUFSIZE];
+    struct ece391_iovec line[2];
 
     ece391_fdputs(1, (uint8_t*)"Enter the Test Number: (0): 100, (1): 10000, (2): 100000\n");
     if (-1 == (cnt = ece391_read(0, buf, BUFSIZE-1)) ) {
@@ -34,10 +35,15 @@ int main ()
         }
     }
 
+    /* the number and its newline go out in one writev */
+    line[0].base = buf;
+    line[1].base = "\n";
+    line[1].len = 1;
     for (i = 0; i < max; i++) {
         ece391_itoa(i+1, buf, 10);
-        ece391_fdputs(1, buf);
-        ece391_fdputs(1, (uint8_t*)"\n");
+        line[0].len = ece391_strlen(buf);
+        if (-1 == ece391_writev(1, line, 2))
+            return 3;
     }
 
     return 0;
@@ -6,17 +6,51 @@
 #define BUFSIZE 1024
 #define SBUFSIZE 33
 
+/* scan the file in place through a read-only mapping */
+void
+scan_mapping (const char* s, const char* fname, const uint8_t* map, int32_t size)
+{
+    int32_t line_start, line_end, check, s_len;
+
+    s_len = ece391_strlen ((uint8_t*)s);
+    for (line_start = 0; line_start < size; line_start = line_end + 1) {
+	line_end = line_start;
+	while (line_end < size && '\n' != map[line_end])
+	    line_end++;
+	/* the mapping can't be written, so matches stop at the line end */
+	for (check = line_start; check + s_len <= line_end; check++) {
+	    if (s[0] == map[check] && 
+		0 == ece391_strncmp (map + check, (uint8_t*)s, s_len)) {
+		ece391_fdputs (1, (uint8_t*)fname);
+		ece391_fdputs (1, (uint8_t*)":");
+		ece391_write (1, map + line_start, line_end - line_start);
+		ece391_fdputs (1, (uint8_t*)"\n");
+		break;
+	    }
+	}
+    }
+}
+
+/* print a matching line, prefixed by the file it is in */
+void
+put_match (const char* fname, const uint8_t* line)
+{
+    if (0 != fname) {
+	ece391_fdputs (1, (uint8_t*)fname);
+	ece391_fdputs (1, (uint8_t*)":");
+    }
+    ece391_fdputs (1, line);
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+/* scan what can be read from fd, fname is NULL for stdin */
 int32_t
-do_one_file (const char* s, const char* fname) 
+scan_fd (const char* s, const char* fname, int32_t fd)
 {
-    int32_t fd, cnt, last, line_start, line_end, check, s_len;
+    int32_t cnt, last, line_start, line_end, check, s_len;
     uint8_t data[BUFSIZE+1];
 
     s_len = ece391_strlen ((uint8_t*)s);
-    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
-        ece391_fdputs (1, (uint8_t*)"file open failed\n");
-        return -1;
-    }
     last = 0;
     while (1) {
         cnt = ece391_read (fd, data + last, BUFSIZE - last);
@@ -30,7 +64,10 @@ do_one_file (const char* s, const char* fname)
 	    line_end = line_start;
 	    while (line_end < last && '\n' != data[line_end])
 		line_end++;
-	    if ('\n' != data[line_end] && 0 != cnt && line_start != 0) {
+	    /* a pipe can hand over part of a line, wait for the rest
+	       unless the line fills the whole buffer */
+	    if ('\n' != data[line_end] && 0 != cnt &&
+		(line_start != 0 || last < BUFSIZE)) {
 		/* copy from line_start to last down to 0 and fix last */
 		data[line_end] = '\0';
 		ece391_strcpy (data, data + line_start);
@@ -42,10 +79,7 @@ do_one_file (const char* s, const char* fname)
 	    for (check = line_start; check < line_end; check++) {
 		if (s[0] == data[check] && 
 		    0 == ece391_strncmp ((uint8_t*)(data + check), (uint8_t*)s, s_len)) {
-		    ece391_fdputs (1, (uint8_t*)fname);
-		    ece391_fdputs (1, (uint8_t*)":");
-		    ece391_fdputs (1, data + line_start);
-		    ece391_fdputs (1, (uint8_t*)"\n");
+		    put_match (fname, data + line_start);
 		    break;
 		}
 	    }
@@ -58,6 +92,27 @@ do_one_file (const char* s, const char* fname)
 	if (0 == cnt)
 	    break;
     }
+    return 0;
+}
+
+int32_t
+do_one_file (const char* s, const char* fname) 
+{
+    int32_t fd, cnt;
+    uint8_t* map;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
+        ece391_fdputs (1, (uint8_t*)"file open failed\n");
+        return -1;
+    }
+    if (-1 != (cnt = ece391_mmap (fd, &map))) {
+        scan_mapping (s, fname, map, cnt);
+        ece391_munmap (map, cnt);
+        return ece391_close (fd);
+    }
+    /* not mappable (e.g. the filesystem is on disk), copy it in instead */
+    if (-1 == scan_fd (s, fname, fd))
+        return -1;
     if (-1 == ece391_close (fd)) {
         ece391_fdputs (1, (uint8_t*)"file close failed\n");
         return -1;
@@ -70,12 +125,17 @@ int main ()
     int32_t fd, cnt;
     uint8_t buf[SBUFSIZE];
     uint8_t search[BUFSIZE];
+    struct ece391_stat st;
 
     if (0 != ece391_getargs (search, BUFSIZE)) {
         ece391_fdputs (1, (uint8_t*)"could not read argument\n");
         return 3;
     }
 
+    /* at the end of a pipeline search what comes in instead of the files */
+    if (0 == ece391_fstat (0, &st) && FILE_TYPE_PIPE == st.type)
+        return (0 == scan_fd ((char*)search, 0, 0)) ? 0 : 3;
+
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
 	return 2;
@@ -3,25 +3,66 @@
 #include "ece391support.h"
 #include "ece391syscall.h"
 
-#define SBUFSIZE 33
+#define DENTS_BUFSIZE 1024
+#define NAME_WIDTH 33
+#define LINE_SIZE 64
+
+static const uint8_t* type_names[] = {
+    (uint8_t*)"rtc", (uint8_t*)"dir", (uint8_t*)"file", (uint8_t*)"dev", (uint8_t*)"proc"
+};
+#define NUM_TYPE_NAMES (sizeof(type_names) / sizeof(type_names[0]))
+
+/* Format one entry as "name  type  size\n" into line, return its length */
+static int32_t format_entry (const struct ece391_dirent* dirent, uint8_t* line)
+{
+    int32_t len = 0;
+    uint8_t num[LINE_SIZE];
+    const uint8_t* s;
+
+    for (s = (const uint8_t*)(dirent + 1); len < dirent->name_len; len++)
+        line[len] = s[len];
+    do {
+        line[len++] = ' ';
+    } while (len < NAME_WIDTH);
+
+    s = (dirent->type < NUM_TYPE_NAMES) ? type_names[dirent->type] : (uint8_t*)"?";
+    while ('\0' != *s)
+        line[len++] = *s++;
+
+    if (FILE_TYPE_FILE == dirent->type) {
+        line[len++] = ' ';
+        for (s = ece391_itoa (dirent->size, num, 10); '\0' != *s; s++)
+            line[len++] = *s;
+    }
+    line[len++] = '\n';
+    return len;
+}
 
 int main ()
 {
-    int32_t fd, cnt;
-    uint8_t buf[SBUFSIZE];
+    int32_t fd, cnt, pos, out_len;
+    uint8_t buf[DENTS_BUFSIZE];
+    uint8_t out[(DENTS_BUFSIZE / sizeof(struct ece391_dirent)) * LINE_SIZE];
+    struct ece391_dirent* dirent;
 
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
         return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
+    /* every getdents returns a batch of entries, print each batch with
+       a single write */
+    while (0 != (cnt = ece391_getdents (fd, buf, DENTS_BUFSIZE))) {
         if (-1 == cnt) {
 	        ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	        return 3;
 	    }
-	    buf[cnt] = '\n';
-	    if (-1 == ece391_write (1, buf, cnt + 1))
+        out_len = 0;
+        for (pos = 0; pos < cnt; pos += sizeof(struct ece391_dirent) + dirent->name_len) {
+            dirent = (struct ece391_dirent*)(buf + pos);
+            out_len += format_entry (dirent, out + out_len);
+        }
+	    if (-1 == ece391_write (1, out, out_len))
 	        return 3;
     }
 
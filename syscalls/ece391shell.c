@@ -4,6 +4,110 @@
 #include "ece391syscall.h"
 
 #define BUFSIZE 1024
+#define MAX_STAGES 8
+
+/* 
+ * run "a | b | c", each stage reads what the one before it wrote. The
+ * stages are spawned so they run at the same time, a pipe only has to hold
+ * what the next stage has not read yet. A trailing '&' leaves the job
+ * running in the background, its stages are reaped before later prompts.
+ * A single command in the foreground is executed like before.
+ */
+int32_t
+run_pipeline (uint8_t* buf)
+{
+    uint8_t* stage[MAX_STAGES];
+    int32_t pid[MAX_STAGES];
+    int32_t nstages, i, end, rval, status;
+    int32_t background = 0;
+    int32_t fds[2];
+    int32_t in = -1;
+    uint8_t num[12];
+
+    end = ece391_strlen (buf);
+    while (end > 0 && ' ' == buf[end - 1])
+	buf[--end] = '\0';
+    if (end > 0 && '&' == buf[end - 1]) {
+	buf[--end] = '\0';
+	background = 1;
+    }
+
+    nstages = 1;
+    stage[0] = buf;
+    for (i = 0; '\0' != buf[i]; i++) {
+	if ('|' != buf[i])
+	    continue;
+	if (MAX_STAGES == nstages)
+	    return -1;
+	buf[i] = '\0';
+	stage[nstages++] = buf + i + 1;
+    }
+    /* the spaces around a '|' are not part of the arguments */
+    for (i = 0; i < nstages; i++) {
+	end = ece391_strlen (stage[i]);
+	while (end > 0 && ' ' == stage[i][end - 1])
+	    stage[i][--end] = '\0';
+    }
+
+    if (1 == nstages && !background)
+	return ece391_execute (stage[0]);
+
+    for (i = 0; i < nstages; i++) {
+	pid[i] = -1;
+	fds[0] = fds[1] = -1;
+	if (i < nstages - 1) {
+	    if (-1 == ece391_pipe (fds)) {
+		ece391_fdputs (1, (uint8_t*)"pipe failed\n");
+		break;
+	    }
+	    ece391_ioctl (fds[1], PIPE_ATTACH, 0);
+	}
+	if (-1 != in)
+	    ece391_ioctl (in, PIPE_ATTACH, 0);
+	pid[i] = ece391_spawn (stage[i]);
+	/* the shell keeps no end open, a stage sees end of file once the one before it halts */
+	if (-1 != in)
+	    ece391_close (in);
+	if (-1 != fds[1])
+	    ece391_close (fds[1]);
+	in = fds[0];
+    }
+    if (-1 != in)
+	ece391_close (in);
+
+    rval = (i == nstages && -1 != pid[nstages - 1]) ? 0 : -1;
+    if (background) {
+	for (i = 0; i < nstages; i++) {
+	    if (-1 == pid[i])
+		continue;
+	    ece391_fdputs (1, (uint8_t*)"[");
+	    ece391_fdputs (1, ece391_itoa (pid[i], num, 10));
+	    ece391_fdputs (1, (uint8_t*)"]\n");
+	}
+	return rval;
+    }
+    for (i = 0; i < nstages; i++) {
+	if (-1 == pid[i] || -1 == ece391_waitpid (pid[i], &status, 0))
+	    continue;
+	if (i == nstages - 1)
+	    rval = status;
+    }
+    return rval;
+}
+
+/* report the background jobs that have halted since the last prompt */
+void
+reap_jobs ()
+{
+    int32_t pid, status;
+    uint8_t num[12];
+
+    while (0 < (pid = ece391_waitpid (-1, &status, WNOHANG))) {
+	ece391_fdputs (1, (uint8_t*)"[");
+	ece391_fdputs (1, ece391_itoa (pid, num, 10));
+	ece391_fdputs (1, (uint8_t*)"] done\n");
+    }
+}
 
 int main ()
 {
@@ -12,6 +116,7 @@ int main ()
     ece391_fdputs (1, (uint8_t*)"Starting 391 Shell\n");
 
     while (1) {
+	reap_jobs ();
         ece391_fdputs (1, (uint8_t*)"391OS> ");
 	if (-1 == (cnt = ece391_read (0, buf, BUFSIZE-1))) {
 	    ece391_fdputs (1, (uint8_t*)"read from keyboard failed\n");
@@ -24,7 +129,7 @@ int main ()
 	    return 0;
 	if ('\0' == buf[0])
 	    continue;
-	rval = ece391_execute (buf);
+	rval = run_pipeline (buf);
 	if (-1 == rval)
 	    ece391_fdputs (1, (uint8_t*)"no such command\n");
 	else if (256 == rval)
@@ -102,3 +102,154 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+
+/*
+ * malloc: blocks of up to 2 KB come from one free list per power of two
+ * size class. An empty list is refilled with a whole page from sbrk cut
+ * into blocks of its class, so most calls only pop or push a list, like a
+ * thread cache that never has to go to a shared heap. Freed small blocks
+ * stay on their list. Larger blocks get their own anonymous mapping that
+ * free gives back to the kernel. Every block starts with a header holding
+ * its size, which keeps the memory after it 8 byte aligned. The threads of
+ * a process share the lists under one mutex.
+ */
+#define MALLOC_HEADER 8
+#define MALLOC_MIN_SHIFT 4        /* smallest class is 16 bytes, header included */
+#define MALLOC_CLASSES 8          /* 16 bytes to 2 KB */
+#define MALLOC_MAX_SMALL (1 << (MALLOC_MIN_SHIFT + MALLOC_CLASSES - 1))
+#define MALLOC_REFILL 4096
+
+static uint8_t* malloc_free_lists[MALLOC_CLASSES];
+static int32_t malloc_lock;
+
+/* Size class of a block of "total" bytes, header included */
+static int32_t malloc_class(uint32_t total)
+{
+    int32_t c = 0;
+
+    while ((1U << (c + MALLOC_MIN_SHIFT)) < total)
+        c++;
+    return c;
+}
+
+/* Allocate "size" bytes, 0 if there is no memory left */
+void* ece391_malloc(uint32_t size)
+{
+    uint32_t total = size + MALLOC_HEADER;
+    uint32_t bsize;
+    int32_t c, i;
+    uint8_t* block;
+
+    if (0 == size || total < size)
+        return 0;
+    if (total > MALLOC_MAX_SMALL) {
+        block = ece391_mmap_anon(total);
+        if ((void*)-1 == block)
+            return 0;
+        *(uint32_t*)block = total;
+        return block + MALLOC_HEADER;
+    }
+
+    c = malloc_class(total);
+    ece391_mutex_lock(&malloc_lock);
+    if (0 == malloc_free_lists[c]) {
+        bsize = 1U << (c + MALLOC_MIN_SHIFT);
+        block = ece391_sbrk(MALLOC_REFILL);
+        if ((void*)-1 == block) {
+            ece391_mutex_unlock(&malloc_lock);
+            return 0;
+        }
+        /* pushed from the end so blocks are handed out in address order */
+        for (i = MALLOC_REFILL - bsize; i >= 0; i -= bsize) {
+            *(uint8_t**)(block + i) = malloc_free_lists[c];
+            malloc_free_lists[c] = block + i;
+        }
+    }
+    block = malloc_free_lists[c];
+    malloc_free_lists[c] = *(uint8_t**)block;
+    ece391_mutex_unlock(&malloc_lock);
+    *(uint32_t*)block = 1U << (c + MALLOC_MIN_SHIFT);
+    return block + MALLOC_HEADER;
+}
+
+/* Allocate "n" zeroed elements of "size" bytes, 0 if there is no memory left */
+void* ece391_calloc(uint32_t n, uint32_t size)
+{
+    uint8_t* p;
+    uint32_t i;
+
+    if (0 != size && n > 0xFFFFFFFF / size)
+        return 0;
+    if (0 == (p = ece391_malloc(n * size)))
+        return 0;
+    for (i = 0; i < n * size; i++)
+        p[i] = 0;
+    return p;
+}
+
+/* Free a block from ece391_malloc or ece391_calloc, 0 is ignored */
+void ece391_free(void* ptr)
+{
+    uint8_t* block;
+    uint32_t total;
+    int32_t c;
+
+    if (0 == ptr)
+        return;
+    block = (uint8_t*)ptr - MALLOC_HEADER;
+    total = *(uint32_t*)block;
+    if (total > MALLOC_MAX_SMALL) {
+        ece391_munmap(block, total);
+        return;
+    }
+    c = malloc_class(total);
+    ece391_mutex_lock(&malloc_lock);
+    *(uint8_t**)block = malloc_free_lists[c];
+    malloc_free_lists[c] = block;
+    ece391_mutex_unlock(&malloc_lock);
+}
+
+/*
+ * mutex on a futex word: 0 free, 1 locked, 2 locked and someone may be
+ * asleep on it. Taking a free mutex and releasing one nobody waits for
+ * are a single atomic instruction without a system call.
+ */
+static int32_t atomic_cmpxchg(int32_t* p, int32_t old, int32_t new)
+{
+    int32_t prev;
+
+    asm volatile ("lock; cmpxchgl %2, %1"
+                  : "=a" (prev), "+m" (*p)
+                  : "r" (new), "0" (old)
+                  : "memory");
+    return prev;
+}
+
+static int32_t atomic_xchg(int32_t* p, int32_t val)
+{
+    asm volatile ("xchgl %0, %1"
+                  : "+r" (val), "+m" (*p)
+                  :
+                  : "memory");
+    return val;
+}
+
+void ece391_mutex_lock(int32_t* m)
+{
+    int32_t c;
+
+    if (0 == (c = atomic_cmpxchg(m, 0, 1)))
+        return;
+    if (2 != c)
+        c = atomic_xchg(m, 2);
+    while (0 != c) {
+        ece391_futex_wait(m, 2);
+        c = atomic_xchg(m, 2);
+    }
+}
+
+void ece391_mutex_unlock(int32_t* m)
+{
+    if (2 == atomic_xchg(m, 0))
+        ece391_futex_wake(m, 1);
+}
@@ -5,6 +5,76 @@
 
 /* All calls return >= 0 on success or -1 on failure. */
 
+/* lseek whence values */
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+
+/* file types reported by stat */
+#define FILE_TYPE_RTC 0
+#define FILE_TYPE_DIR 1
+#define FILE_TYPE_FILE 2
+#define FILE_TYPE_DEV 3
+#define FILE_TYPE_PROC 4
+#define FILE_TYPE_PIPE 5
+
+struct ece391_stat {
+    uint32_t size;  /* bytes, 0 for devices and proc files */
+    uint32_t type;  /* one of the FILE_TYPE values */
+    uint32_t inode; /* filesystem inode, 0 if there is none */
+};
+
+/* one record filled in by getdents, name_len bytes of name follow the
+ * header without a '\0', then the next record */
+struct ece391_dirent {
+    uint32_t inode;   /* filesystem inode, 0 if there is none */
+    uint32_t size;    /* bytes, 0 for anything but regular files */
+    uint8_t type;     /* one of the FILE_TYPE values */
+    uint8_t name_len;
+} __attribute__ ((packed));
+
+/* terminal ioctl requests and the line discipline flags they get and set */
+#define TERM_GET_MODE 0
+#define TERM_SET_MODE 1
+#define TERM_CANON 0x1    /* read returns whole lines, which can be edited while typed */
+#define TERM_ECHO 0x2     /* typed characters are shown */
+#define TERM_NONBLOCK 0x4 /* read returns 0 when nothing was typed */
+
+/* pty master ioctl requests, every open of /dev/ptmx gets a new pty */
+#define PTY_GET_NUM 0
+#define PTY_ATTACH 1      /* the next program executed gets the slave as stdin and stdout */
+
+/* pipe ioctl requests, pipe() fills in the read end and then the write end */
+#define PIPE_ATTACH 0     /* the next program executed gets the read end as stdin or the write end as stdout */
+#define PIPE_GIFT 1       /* write end, arg 1: whole pages from mmap move into the pipe, the writer's copy reads as zeros after the write */
+
+/* sbrk and mmap_anon return (void*)-1 on failure. Their memory reads as
+ * zero, a page only gets memory when it is first touched */
+
+/* shm_map maps the named shared memory segment, made with "size" bytes
+ * if it does not exist yet, at "addr" or where the kernel picks if it is
+ * 0. It returns (void*)-1 on failure, munmap detaches it. A segment is
+ * freed once no process has it mapped. */
+
+/* futex_wait sleeps while *addr == expected until futex_wake is called on
+ * the same word, from any process that maps it. It returns -1 right away
+ * if the word already changed. futex_wake returns how many it woke. */
+
+/* thread_create runs start(arg) in a new thread of the process, with its
+ * own 64 KB stack in the mmap region. It shares everything else, malloc
+ * included. The thread ends when start returns or calls thread_exit,
+ * thread_join waits for it and gets its status. A thread calling halt only
+ * ends itself, the first thread halting ends them all. */
+
+/* waitpid options, waitpid(-1, ...) takes any child the caller spawned */
+#define WNOHANG 1         /* return 0 if no child has halted yet instead of waiting */
+
+/* one buffer of a readv or writev, at most 32 per call */
+struct ece391_iovec {
+    void* base;
+    int32_t len;
+};
+
 /*  
  * Note that the system call for halt will have to make sure that only
  * the low byte of EBX (the status argument) is returned to the calling
@@ -21,6 +91,27 @@ extern int32_t ece391_getargs (uint8_t* buf, int32_t nbytes);
 extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
+extern int32_t ece391_mmap (int32_t fd, uint8_t** start);
+extern int32_t ece391_munmap (uint8_t* start, int32_t length);
+extern int32_t ece391_lseek (int32_t fd, int32_t offset, int32_t whence);
+extern int32_t ece391_pread (int32_t fd, void* buf, int32_t nbytes, int32_t offset);
+extern int32_t ece391_stat (const uint8_t* filename, struct ece391_stat* buf);
+extern int32_t ece391_fstat (int32_t fd, struct ece391_stat* buf);
+extern int32_t ece391_getdents (int32_t fd, void* buf, int32_t nbytes);
+extern int32_t ece391_readv (int32_t fd, const struct ece391_iovec* iov, int32_t iovcnt);
+extern int32_t ece391_writev (int32_t fd, const struct ece391_iovec* iov, int32_t iovcnt);
+extern int32_t ece391_ioctl (int32_t fd, int32_t request, int32_t arg);
+extern int32_t ece391_pipe (int32_t fds[2]);
+extern int32_t ece391_spawn (const uint8_t* command);
+extern int32_t ece391_waitpid (int32_t pid, int32_t* status, int32_t options);
+extern void* ece391_sbrk (int32_t increment);
+extern void* ece391_mmap_anon (int32_t length);
+extern void* ece391_shm_map (const uint8_t* name, int32_t size, void* addr);
+extern int32_t ece391_futex_wait (int32_t* addr, int32_t expected);
+extern int32_t ece391_futex_wake (int32_t* addr, int32_t n);
+extern int32_t ece391_thread_create (int32_t (*start)(void* arg), void* arg);
+extern int32_t ece391_thread_exit (int32_t status);
+extern int32_t ece391_thread_join (int32_t tid, int32_t* status);
 
 enum signums {
 	DIV_ZERO = 0,
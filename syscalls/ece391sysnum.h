@@ -11,5 +11,26 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_MMAP  11
+#define SYS_MUNMAP  12
+#define SYS_LSEEK  13
+#define SYS_PREAD  14
+#define SYS_STAT  15
+#define SYS_FSTAT  16
+#define SYS_GETDENTS  17
+#define SYS_READV  18
+#define SYS_WRITEV  19
+#define SYS_IOCTL  20
+#define SYS_PIPE  21
+#define SYS_SPAWN  22
+#define SYS_WAITPID  23
+#define SYS_SBRK  24
+#define SYS_MMAP_ANON  25
+#define SYS_SHM_MAP  26
+#define SYS_FUTEX_WAIT  27
+#define SYS_FUTEX_WAKE  28
+#define SYS_THREAD_CREATE  29
+#define SYS_THREAD_EXIT  30
+#define SYS_THREAD_JOIN  31
 
 #endif /* ECE391SYSNUM_H */